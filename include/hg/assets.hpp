@@ -2,6 +2,7 @@
 
 #include "hg/inttypes.hpp"
 #include "hg/strings.hpp"
+#include "hg/atom.hpp"
 #include "hg/binary.hpp"
 #include "hg/map.hpp"
 #include "hg/pool.hpp"
@@ -25,6 +26,10 @@ struct AssetData {
      * The unique path for caching
      */
     String path{};
+    /**
+     * The interned path, the asset's key in its manager
+     */
+    Atom key{};
 };
 
 /**
@@ -35,7 +40,7 @@ struct AssetManager {
     /**
      * The asset lookup
      */
-    Map<StringView, AssetData<T>*> map{};
+    Map<Atom, AssetData<T>*> map{};
     /**
      * The asset pool
      */
@@ -90,8 +95,8 @@ struct Asset {
     {
         if (data != nullptr && --data->refCount == 0)
         {
-            if (data->path != "")
-                assets<T>.map.remove(data->path);
+            if (data->key != nullAtom)
+                assets<T>.map.remove(data->key);
 
             assets<T>.pool.free(data);
         }
@@ -191,10 +196,10 @@ Asset<T> newAsset()
 }
 
 /**
- * Load an asset (or create a new reference)
+ * Load an asset (or create a new reference) from an interned path
  */
 template<typename T>
-Asset<T> load(StringView path)
+Asset<T> load(Atom path)
 {
     AssetData<T>** asset = assets<T>.map.get(path);
     if (asset != nullptr)
@@ -202,13 +207,24 @@ Asset<T> load(StringView path)
 
     AssetData<T>* data = assets<T>.pool.alloc();
 
-    data->path = String::create(path);
-    assets<T>.map.add(data->path, data);
+    data->path = String::create(atomString(path));
+    data->key = path;
+    if (path != nullAtom)
+        assets<T>.map.add(path, data);
 
     assetLoadImpl(data);
     return data;
 }
 
+/**
+ * Load an asset (or create a new reference)
+ */
+template<typename T>
+Asset<T> load(StringView path)
+{
+    return load<T>(atom(path));
+}
+
 /**
  * Hot reload an asset
  */
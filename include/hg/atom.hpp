@@ -0,0 +1,122 @@
+#pragma once
+
+#include "hg/inttypes.hpp"
+#include "hg/strings.hpp"
+#include "hg/hash.hpp"
+
+#include <type_traits>
+
+namespace hg {
+
+/**
+ * An interned string
+ *
+ * Atoms are compact ids into a global, thread safe intern table, so equal
+ * strings always produce the same atom, comparison is a single integer
+ * compare, and the string's hash is computed once when it is interned.
+ * Interned strings live until the program exits.
+ */
+struct Atom {
+    /**
+     * The index of the string in the intern table, 0 is the empty string
+     */
+    u32 id = 0;
+};
+
+/**
+ * The null atom, the empty string
+ */
+static constexpr Atom nullAtom = Atom{};
+
+/**
+ * Compare atoms
+ */
+constexpr bool operator==(Atom lhs, Atom rhs)
+{
+    return lhs.id == rhs.id;
+}
+
+/**
+ * Compare atoms
+ */
+constexpr bool operator!=(Atom lhs, Atom rhs)
+{
+    return lhs.id != rhs.id;
+}
+
+/**
+ * Hash map hashing for atoms
+ */
+template<>
+constexpr u64 hash(Atom atom)
+{
+    return hash(atom.id);
+}
+
+/**
+ * The string hash used by the intern table, FNV-1a
+ *
+ * Note, this is constexpr so literals can be hashed at compile time
+ */
+constexpr u64 atomHash(StringView str)
+{
+    u64 ret = 0xcbf29ce484222325ull;
+    for (u64 i = 0; i < str.length; ++i)
+    {
+        ret ^= static_cast<u8>(str[i]);
+        ret *= 0x100000001b3ull;
+    }
+    return ret;
+}
+
+/**
+ * Intern a string
+ *
+ * Returns
+ * - The string's atom, nullAtom if the string is empty
+ */
+Atom atom(StringView str);
+
+/**
+ * Intern a string whose atomHash is already known, e.g. from HG_ATOM
+ *
+ * Parameters
+ * - str The string to intern
+ * - strHash atomHash(str)
+ *
+ * Returns
+ * - The string's atom, nullAtom if the string is empty
+ */
+Atom atom(StringView str, u64 strHash);
+
+/**
+ * Find a string's atom without interning it
+ *
+ * Returns
+ * - The string's atom, nullAtom if it was never interned
+ */
+Atom atomFind(StringView str);
+
+/**
+ * Get the interned string of an atom
+ *
+ * Note, the view is valid until the program exits
+ */
+StringView atomString(Atom atom);
+
+/**
+ * Get the precomputed atomHash of an atom's string
+ */
+u64 atomHash(Atom atom);
+
+/**
+ * Returns the number of interned strings, including the empty string
+ */
+u32 atomCount();
+
+/**
+ * Intern a string literal, hashing it at compile time
+ */
+#define HG_ATOM(str) ::hg::atom(str, std::integral_constant<u64, ::hg::atomHash(str)>::value)
+
+} // namespace hg
@@ -3,6 +3,8 @@
 #include "hg/macros.hpp"
 #include "hg/inttypes.hpp"
 #include "hg/memory.hpp"
+#include "hg/strings.hpp"
+#include "hg/maybe.hpp"
 
 #include <cstring>
 
@@ -246,4 +248,75 @@ struct Binary {
     Binary& operator=(const Binary&) = delete;
 };
 
+/**
+ * A file mapped into memory read only, pages are only loaded when touched
+ */
+struct MappedBinary {
+    /**
+     * The mapped data
+     */
+    const void* data = nullptr;
+    /**
+     * The size of the data in bytes
+     */
+    u64 size = 0;
+    /**
+     * The platform's mapping object, if it has one
+     */
+    void* mapping = nullptr;
+
+    /**
+     * Construct empty
+     */
+    MappedBinary() noexcept = default;
+
+    /**
+     * Map a file into memory
+     *
+     * Parameters
+     * - path The path of the file to map
+     * Returns
+     * - The mapped file, or nothing if it could not be mapped
+     */
+    static Maybe<MappedBinary> map(StringView path);
+
+    /**
+     * Unmap the file
+     */
+    ~MappedBinary() noexcept;
+
+    /**
+     * Implicitly convert to BinaryView
+     */
+    constexpr operator BinaryView() const
+    {
+        return {data, size};
+    }
+
+    /**
+     * Move construct
+     */
+    MappedBinary(MappedBinary&& other) noexcept
+        : data{std::exchange(other.data, nullptr)}
+        , size{std::exchange(other.size, 0)}
+        , mapping{std::exchange(other.mapping, nullptr)}
+    {}
+
+    /**
+     * Move assign
+     */
+    MappedBinary& operator=(MappedBinary&& other) noexcept
+    {
+        if (this != &other)
+        {
+            this->~MappedBinary();
+            new (this) MappedBinary{std::move(other)};
+        }
+        return *this;
+    }
+
+    MappedBinary(const MappedBinary&) = delete;
+    MappedBinary& operator=(const MappedBinary&) = delete;
+};
+
 } // namespace hg
@@ -0,0 +1,529 @@
+#pragma once
+
+#include "hg/macros.hpp"
+#include "hg/inttypes.hpp"
+#include "hg/array.hpp"
+#include "hg/hash.hpp"
+#include "hg/map.hpp"
+#include "hg/concurrency.hpp"
+
+#include <utility>
+
+namespace hg {
+
+/**
+ * A least recently used cache
+ *
+ * Keys are looked up through a Map into a node array, and nodes are linked
+ * in an intrusive list from most to least recently used, so get, put and
+ * touch are O(1). When the total cost exceeds the capacity, the least
+ * recently used entries are evicted.
+ */
+template<typename K, typename V>
+struct LruCache {
+    /**
+     * A cached entry
+     */
+    struct Node {
+        /**
+         * The key
+         */
+        K key{};
+        /**
+         * The cached value
+         */
+        V val{};
+        /**
+         * The cost counted against the capacity
+         */
+        u64 cost = 0;
+        /**
+         * The next more recently used node, or -1
+         */
+        u32 prev = (u32)-1;
+        /**
+         * The next less recently used node, or -1
+         */
+        u32 next = (u32)-1;
+    };
+
+    /**
+     * The index of each key's node
+     */
+    Map<K, u32> lookup{};
+    /**
+     * The entries, including vacant nodes
+     */
+    Array<Node> nodes{};
+    /**
+     * The vacant nodes
+     */
+    Array<u32> vacant{};
+    /**
+     * The most recently used node, or -1
+     */
+    u32 head = (u32)-1;
+    /**
+     * The least recently used node, or -1
+     */
+    u32 tail = (u32)-1;
+    /**
+     * The max total cost
+     */
+    u64 capacity = 0;
+    /**
+     * The current total cost
+     */
+    u64 size = 0;
+    /**
+     * The cost of an entry, or nullptr to count each entry as 1
+     */
+    u64 (*cost)(const K& key, const V& val) = nullptr;
+    /**
+     * Called with each entry before it is evicted, may be nullptr
+     */
+    void (*onEvict)(void* data, K* key, V* val) = nullptr;
+    /**
+     * The data passed to onEvict
+     */
+    void* evictData = nullptr;
+
+    /**
+     * Construct empty
+     */
+    LruCache() noexcept = default;
+
+    /**
+     * Construct with a capacity
+     *
+     * Parameters
+     * - capacityVal The max total cost, in entries if costFn is nullptr
+     * - costFn The cost of an entry, e.g. its size in bytes
+     */
+    LruCache(u64 capacityVal, u64 (*costFn)(const K& key, const V& val) = nullptr)
+        : capacity{capacityVal}, cost{costFn}
+    {}
+
+    /**
+     * Returns the number of entries
+     */
+    u64 count() const
+    {
+        return lookup.count;
+    }
+
+    /**
+     * Remove all entries without calling onEvict
+     */
+    void reset()
+    {
+        lookup.reset();
+        nodes.reset();
+        vacant.reset();
+        head = (u32)-1;
+        tail = (u32)-1;
+        size = 0;
+    }
+
+    /**
+     * Returns whether a key is cached, without touching it
+     */
+    bool has(const K& key)
+    {
+        return lookup.has(key);
+    }
+
+    /**
+     * Get a cached value and mark it most recently used
+     *
+     * Returns
+     * - The value, or nullptr if not cached
+     */
+    V* get(const K& key)
+    {
+        u32* idx = lookup.get(key);
+        if (idx == nullptr)
+            return nullptr;
+
+        moveToFront(*idx);
+        return &nodes[*idx].val;
+    }
+
+    /**
+     * Get a cached value without changing its recency
+     *
+     * Returns
+     * - The value, or nullptr if not cached
+     */
+    V* peek(const K& key)
+    {
+        u32* idx = lookup.get(key);
+        return idx != nullptr ? &nodes[*idx].val : nullptr;
+    }
+
+    /**
+     * Mark a key most recently used
+     *
+     * Returns
+     * - Whether the key was cached
+     */
+    bool touch(const K& key)
+    {
+        u32* idx = lookup.get(key);
+        if (idx == nullptr)
+            return false;
+
+        moveToFront(*idx);
+        return true;
+    }
+
+    /**
+     * Insert or replace a value, mark it most recently used, and evict least
+     * recently used entries until the cache is within capacity
+     *
+     * Note, the returned value is never evicted by this put, even if its cost
+     * alone exceeds the capacity
+     *
+     * Returns
+     * - The cached value
+     */
+    V* put(const K& key, V val)
+    {
+        u32 idx;
+        u32* found = lookup.get(key);
+        if (found != nullptr)
+        {
+            idx = *found;
+            size -= nodes[idx].cost;
+            nodes[idx].val = std::move(val);
+            moveToFront(idx);
+        }
+        else
+        {
+            if (vacant.count > 0)
+            {
+                idx = vacant.pop();
+            }
+            else
+            {
+                idx = static_cast<u32>(nodes.count);
+                nodes.push();
+            }
+            nodes[idx].key = key;
+            nodes[idx].val = std::move(val);
+            lookup.add(key, idx);
+            linkFront(idx);
+        }
+
+        Node& node = nodes[idx];
+        node.cost = cost != nullptr ? cost(node.key, node.val) : 1;
+        size += node.cost;
+
+        while (size > capacity && tail != idx)
+        {
+            evict(tail);
+        }
+        return &nodes[idx].val;
+    }
+
+    /**
+     * Remove a key without calling onEvict
+     *
+     * Parameters
+     * - key The key to remove
+     * - val A pointer to store the value, if found
+     *
+     * Returns
+     * - Whether the key was cached
+     */
+    bool remove(const K& key, V* val = nullptr)
+    {
+        u32 idx;
+        if (!lookup.remove(key, &idx))
+            return false;
+
+        if (val != nullptr)
+            *val = std::move(nodes[idx].val);
+        release(idx);
+        return true;
+    }
+
+    /**
+     * Evict least recently used entries until the total cost is within a
+     * budget, calling onEvict for each
+     */
+    void trim(u64 budget)
+    {
+        while (size > budget && tail != (u32)-1)
+        {
+            evict(tail);
+        }
+    }
+
+    /**
+     * Calls a function for each entry from most to least recently used
+     */
+    template<typename F> requires std::is_invocable_r_v<void, F, K*, V*>
+    void forEach(F fn)
+    {
+        for (u32 idx = head; idx != (u32)-1; idx = nodes[idx].next)
+        {
+            fn(&nodes[idx].key, &nodes[idx].val);
+        }
+    }
+
+    /**
+     * Evict an entry, calling onEvict, generally only used internally
+     */
+    void evict(u32 idx)
+    {
+        if (onEvict != nullptr)
+            onEvict(evictData, &nodes[idx].key, &nodes[idx].val);
+
+        lookup.remove(nodes[idx].key);
+        release(idx);
+    }
+
+    /**
+     * Unlink a node and make it vacant, generally only used internally
+     */
+    void release(u32 idx)
+    {
+        unlink(idx);
+        size -= nodes[idx].cost;
+        nodes[idx].key = K{};
+        nodes[idx].val = V{};
+        nodes[idx].cost = 0;
+        vacant.push(idx);
+    }
+
+    /**
+     * Link a node as most recently used, generally only used internally
+     */
+    void linkFront(u32 idx)
+    {
+        nodes[idx].prev = (u32)-1;
+        nodes[idx].next = head;
+        if (head != (u32)-1)
+            nodes[head].prev = idx;
+        head = idx;
+        if (tail == (u32)-1)
+            tail = idx;
+    }
+
+    /**
+     * Unlink a node from the recency list, generally only used internally
+     */
+    void unlink(u32 idx)
+    {
+        Node& node = nodes[idx];
+        if (node.prev != (u32)-1)
+            nodes[node.prev].next = node.next;
+        else
+            head = node.next;
+
+        if (node.next != (u32)-1)
+            nodes[node.next].prev = node.prev;
+        else
+            tail = node.prev;
+
+        node.prev = (u32)-1;
+        node.next = (u32)-1;
+    }
+
+    /**
+     * Make a node most recently used, generally only used internally
+     */
+    void moveToFront(u32 idx)
+    {
+        if (idx != head)
+        {
+            unlink(idx);
+            linkFront(idx);
+        }
+    }
+
+    /**
+     * Move construct
+     */
+    LruCache(LruCache&& other) noexcept
+        : lookup{std::move(other.lookup)}
+        , nodes{std::move(other.nodes)}
+        , vacant{std::move(other.vacant)}
+        , head{std::exchange(other.head, (u32)-1)}
+        , tail{std::exchange(other.tail, (u32)-1)}
+        , capacity{std::exchange(other.capacity, 0)}
+        , size{std::exchange(other.size, 0)}
+        , cost{std::exchange(other.cost, nullptr)}
+        , onEvict{std::exchange(other.onEvict, nullptr)}
+        , evictData{std::exchange(other.evictData, nullptr)}
+    {}
+
+    /**
+     * Move assign
+     */
+    LruCache& operator=(LruCache&& other) noexcept
+    {
+        if (this != &other)
+        {
+            this->~LruCache();
+            new (this) LruCache{std::move(other)};
+        }
+        return *this;
+    }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+};
+
+/**
+ * A thread safe least recently used cache, split into independently locked
+ * shards by key hash so jobs on different shards don't contend
+ *
+ * Note, values are copied out, since a pointer into a shard is only valid
+ * while its lock is held
+ */
+template<typename K, typename V, u32 N = 16>
+struct LruCacheSharded {
+    /**
+     * The number of shards
+     */
+    static constexpr u32 shardCount = N;
+
+    /**
+     * The shards, each with a share of the capacity
+     */
+    LruCache<K, V> shards[N];
+    /**
+     * The lock for each shard
+     */
+    SpinLock locks[N];
+
+    /**
+     * Construct empty
+     */
+    LruCacheSharded() noexcept = default;
+
+    /**
+     * Construct with a total capacity split evenly between shards
+     *
+     * Parameters
+     * - capacity The max total cost, in entries if costFn is nullptr
+     * - costFn The cost of an entry, e.g. its size in bytes
+     * - onEvict Called with each entry before it is evicted, while the
+     *   shard is locked, may be nullptr
+     * - evictData The data passed to onEvict
+     */
+    LruCacheSharded(
+        u64 capacity,
+        u64 (*costFn)(const K& key, const V& val) = nullptr,
+        void (*onEvict)(void* data, K* key, V* val) = nullptr,
+        void* evictData = nullptr)
+    {
+        for (u32 i = 0; i < N; ++i)
+        {
+            shards[i] = LruCache<K, V>{(capacity + N - 1) / N, costFn};
+            shards[i].onEvict = onEvict;
+            shards[i].evictData = evictData;
+        }
+    }
+
+    /**
+     * Returns the shard a key belongs to
+     */
+    u32 shardOf(const K& key) const
+    {
+        // The map uses the low bits of the hash, so mix in the high bits to
+        // keep shards from correlating with probe positions
+        u64 h = hash(key) * 0x9e3779b97f4a7c15ull;
+        return static_cast<u32>((h >> 32) % N);
+    }
+
+    /**
+     * Returns the number of entries across all shards
+     */
+    u64 count()
+    {
+        u64 total = 0;
+        for (u32 i = 0; i < N; ++i)
+        {
+            SpinLockScope lock{&locks[i]};
+            total += shards[i].count();
+        }
+        return total;
+    }
+
+    /**
+     * Copy out a cached value and mark it most recently used
+     *
+     * Returns
+     * - Whether the key was cached
+     */
+    bool get(const K& key, V* val)
+    {
+        u32 s = shardOf(key);
+        SpinLockScope lock{&locks[s]};
+        V* found = shards[s].get(key);
+        if (found == nullptr)
+            return false;
+
+        if (val != nullptr)
+            *val = *found;
+        return true;
+    }
+
+    /**
+     * Mark a key most recently used
+     *
+     * Returns
+     * - Whether the key was cached
+     */
+    bool touch(const K& key)
+    {
+        u32 s = shardOf(key);
+        SpinLockScope lock{&locks[s]};
+        return shards[s].touch(key);
+    }
+
+    /**
+     * Insert or replace a value, evicting from the key's shard as needed
+     */
+    void put(const K& key, V val)
+    {
+        u32 s = shardOf(key);
+        SpinLockScope lock{&locks[s]};
+        shards[s].put(key, std::move(val));
+    }
+
+    /**
+     * Remove a key without calling onEvict
+     *
+     * Returns
+     * - Whether the key was cached
+     */
+    bool remove(const K& key, V* val = nullptr)
+    {
+        u32 s = shardOf(key);
+        SpinLockScope lock{&locks[s]};
+        return shards[s].remove(key, val);
+    }
+
+    /**
+     * Remove all entries without calling onEvict
+     */
+    void reset()
+    {
+        for (u32 i = 0; i < N; ++i)
+        {
+            SpinLockScope lock{&locks[i]};
+            shards[i].reset();
+        }
+    }
+
+    LruCacheSharded(LruCacheSharded&&) = delete;
+    LruCacheSharded& operator=(LruCacheSharded&&) = delete;
+    LruCacheSharded(const LruCacheSharded&) = delete;
+    LruCacheSharded& operator=(const LruCacheSharded&) = delete;
+};
+
+} // namespace hg
@@ -4,8 +4,15 @@
 #include "hg/concurrency.hpp"
 #include "hg/product.hpp"
 #include "hg/pool.hpp"
+#include "hg/map.hpp"
+#include "hg/atom.hpp"
 #include "hg/serialization.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+
 namespace hg {
 
 /**
@@ -48,6 +55,297 @@ constexpr u64 hash(Entity e)
     return hash(e.handle.id);
 }
 
+/**
+ * The number of bits of an entity index within an EcsSparse page
+ */
+static constexpr u32 ecsPageBits = 10;
+
+/**
+ * The number of indices in an EcsSparse page
+ */
+static constexpr u32 ecsPageSize = 1 << ecsPageBits;
+
+/**
+ * An EcsSparse page with every index -1
+ */
+struct EcsEmptyPage {
+    /**
+     * The indices
+     */
+    u32 vals[ecsPageSize];
+
+    /**
+     * Construct filled with -1
+     */
+    constexpr EcsEmptyPage()
+        : vals{}
+    {
+        for (u32& val : vals)
+        {
+            val = (u32)-1;
+        }
+    }
+};
+
+/**
+ * A paged sparse array of component indices, indexed by entity index
+ *
+ * Pages of 1024 indices (4 KB) are allocated on the first write to them.
+ * Pages that were never written point to one shared read-only page of -1,
+ * so a lookup is a bounds check and two loads, with no branch on whether
+ * the page exists. A component type held by a few high index entities then
+ * costs a page per entity instead of 4 bytes per possible entity.
+ */
+struct EcsSparse {
+    /**
+     * The number of bits of an index within a page
+     */
+    static constexpr u32 pageBits = ecsPageBits;
+    /**
+     * The number of indices in a page
+     */
+    static constexpr u32 pageSize = ecsPageSize;
+
+    /**
+     * The shared page for pages that were never written
+     *
+     * Note, it is never written to, so it can live in read-only memory
+     */
+    static constexpr EcsEmptyPage emptyPage{};
+
+    /**
+     * pages[idx >> pageBits] is the page holding idx, or the empty page
+     */
+    Array<u32*> pages{};
+    /**
+     * The number of pages allocated, not counting the empty page
+     */
+    u64 allocated = 0;
+
+    /**
+     * Construct empty
+     */
+    EcsSparse() noexcept = default;
+
+    /**
+     * Free all pages
+     */
+    ~EcsSparse() noexcept
+    {
+        reset();
+    }
+
+    /**
+     * Free all pages
+     */
+    void reset()
+    {
+        for (u32* page : pages)
+        {
+            if (page != emptyPage.vals)
+                heapFree(page, pageSize);
+        }
+        pages.reset();
+        allocated = 0;
+    }
+
+    /**
+     * Get the value at an index, -1 if never set
+     */
+    u32 get(u32 idx) const
+    {
+        u32 page = idx >> pageBits;
+        return page < pages.count ? pages[page][idx & (pageSize - 1)] : (u32)-1;
+    }
+
+    /**
+     * Get the value at an index without checking that its page exists
+     *
+     * Note, the index must have been set before
+     */
+    u32 at(u32 idx) const
+    {
+        return pages.vals[idx >> pageBits][idx & (pageSize - 1)];
+    }
+
+    /**
+     * Set the value at an index, allocating its page if needed
+     */
+    void set(u32 idx, u32 val)
+    {
+        u32 page = idx >> pageBits;
+        if (page >= pages.count)
+        {
+            u64 oldCount = pages.count;
+            pages.resize(page + 1);
+            for (u64 i = oldCount; i < pages.count; ++i)
+            {
+                pages[i] = const_cast<u32*>(emptyPage.vals);
+            }
+        }
+
+        if (pages[page] == emptyPage.vals)
+        {
+            pages[page] = heapAlloc<u32>(pageSize);
+            memcpy(pages[page], emptyPage.vals, sizeof(emptyPage.vals));
+            ++allocated;
+        }
+
+        pages[page][idx & (pageSize - 1)] = val;
+    }
+
+    /**
+     * Returns the bytes of memory used by the pages and the page table
+     */
+    u64 memoryUsage() const
+    {
+        return allocated * pageSize * sizeof(u32) + pages.capacity * sizeof(u32*);
+    }
+
+    /**
+     * Move constructor
+     */
+    EcsSparse(EcsSparse&& other) noexcept
+        : pages{std::exchange(other.pages, {})}
+        , allocated{std::exchange(other.allocated, 0)}
+    {}
+
+    /**
+     * Move assignment
+     */
+    EcsSparse& operator=(EcsSparse&& other) noexcept
+    {
+        if (this != &other)
+        {
+            this->~EcsSparse();
+            new (this) EcsSparse{std::move(other)};
+        }
+        return *this;
+    }
+
+    EcsSparse(const EcsSparse&) = delete;
+    EcsSparse& operator=(const EcsSparse&) = delete;
+};
+
+/**
+ * The most entities in a chunk of forEachChunk, and per task in the parallel
+ * queries
+ */
+static constexpr u32 ecsChunkSize = 1024;
+
+/**
+ * Iterates in parallel over chunks of indices, generally only used
+ * internally by the parallel queries
+ *
+ * Parameters
+ * - count The number of indices, from 0
+ * - fn The function to call with the begin and end of each chunk
+ */
+template<typename F>
+void ecsForChunksPar(u64 count, F fn)
+{
+    forPar(0, (count + ecsChunkSize - 1) / ecsChunkSize, [&](u64 chunk)
+    {
+        u64 begin = chunk * ecsChunkSize;
+        fn(begin, std::min(begin + ecsChunkSize, count));
+    });
+}
+
+/**
+ * Whether a component type is a tag, may be overridden
+ *
+ * Tags are empty marker types, such as Enemy or Selected. Every instance is
+ * the same, so tags are stored as only their entities, without a component
+ * array, and their queries are the entities themselves, from
+ * Ecs::getEntities.
+ */
+template<typename T>
+constexpr bool ecsTag = std::is_empty_v<T>;
+
+/**
+ * The component storage of a tag type, generally only used internally by
+ * EcsComponent
+ *
+ * Counts the components in place of an Array, every component is the one
+ * shared instance.
+ */
+template<typename T>
+struct EcsTagArray {
+    /**
+     * The instance every component refers to
+     */
+    static inline T tag{};
+    /**
+     * The instances in the spans of a chunk
+     */
+    static inline T placeholders[ecsChunkSize]{};
+
+    /**
+     * The number of components
+     */
+    u64 count = 0;
+
+    /**
+     * Add a component
+     *
+     * Returns
+     * - The shared instance
+     */
+    template<typename... Args>
+    T& push(Args&&... args)
+    {
+        (static_cast<void>(args), ...);
+        ++count;
+        return tag;
+    }
+
+    /**
+     * Remove a component, the last takes its place
+     */
+    void removeSwap(u64 idx)
+    {
+        HG_ASSERT(idx < count);
+        static_cast<void>(idx);
+        --count;
+    }
+
+    /**
+     * Nothing is allocated
+     */
+    void reserve(u64 capacity)
+    {
+        static_cast<void>(capacity);
+    }
+
+    /**
+     * Remove all components
+     */
+    void reset()
+    {
+        count = 0;
+    }
+
+    /**
+     * Get a component
+     */
+    T& operator[](u64 idx)
+    {
+        HG_ASSERT(idx < count);
+        static_cast<void>(idx);
+        return tag;
+    }
+
+    /**
+     * Get a component (const)
+     */
+    const T& operator[](u64 idx) const
+    {
+        HG_ASSERT(idx < count);
+        static_cast<void>(idx);
+        return tag;
+    }
+};
+
 /**
  * A component in an entity component system
  */
@@ -59,17 +357,41 @@ struct EcsComponent {
     using Type = T;
 
     /**
-     * indices[e.handle.idx()] is the index into components, or -1 if none
+     * indices.get(e.handle.idx()) is the index into components, or -1 if none
      */
-    Array<u32> indices{};
+    EcsSparse indices{};
     /**
      * entities[idx] is the entity that owns that index
      */
     Array<Entity> entities{};
     /**
-     * The component data
+     * The component data, only counted for tags
+     */
+    std::conditional_t<ecsTag<T>, EcsTagArray<T>, Array<T>> components{};
+    /**
+     * The index of the owning group in the Ecs, or -1 if not owned
+     */
+    u32 group = (u32)-1;
+    /**
+     * Whether changes are tracked, enabled with Ecs::track
+     */
+    bool tracked = false;
+    /**
+     * The tick each component was added, parallel to components if tracked
      */
-    Array<T> components{};
+    Array<u32> added{};
+    /**
+     * The tick each component last changed, parallel to components if tracked
+     */
+    Array<u32> changed{};
+    /**
+     * The entities the component was removed from, if tracked
+     */
+    Array<Entity> removed{};
+    /**
+     * The tick of each removal, parallel to removed
+     */
+    Array<u32> removedTicks{};
 
     /**
      * Default-construct a component on an entity
@@ -80,18 +402,7 @@ struct EcsComponent {
     {
         HG_ASSERT(!has(e));
 
-        if (e.handle.idx() >= indices.count)
-        {
-            u64 oldCount = indices.count;
-            indices.resize(e.handle.idx() + 1);
-            for (u64 i = oldCount; i < indices.count; ++i)
-            {
-                indices[i] = (u32)-1;
-            }
-        }
-
-        u64 idx = entities.count;
-        indices[e.handle.idx()] = (u32)idx;
+        indices.set(e.handle.idx(), (u32)entities.count);
         entities.push(e);
         return components.push();
     }
@@ -105,18 +416,7 @@ struct EcsComponent {
     {
         HG_ASSERT(!has(e));
 
-        if (e.handle.idx() >= indices.count)
-        {
-            u64 oldCount = indices.count;
-            indices.resize(e.handle.idx() + 1);
-            for (u64 i = oldCount; i < indices.count; ++i)
-            {
-                indices[i] = (u32)-1;
-            }
-        }
-
-        u64 idx = entities.count;
-        indices[e.handle.idx()] = (u32)idx;
+        indices.set(e.handle.idx(), (u32)entities.count);
         entities.push(e);
         return components.push(val);
     }
@@ -130,18 +430,7 @@ struct EcsComponent {
     {
         HG_ASSERT(!has(e));
 
-        if (e.handle.idx() >= indices.count)
-        {
-            u64 oldCount = indices.count;
-            indices.resize(e.handle.idx() + 1);
-            for (u64 i = oldCount; i < indices.count; ++i)
-            {
-                indices[i] = (u32)-1;
-            }
-        }
-
-        u64 idx = entities.count;
-        indices[e.handle.idx()] = (u32)idx;
+        indices.set(e.handle.idx(), (u32)entities.count);
         entities.push(e);
         return components.push(std::move(val));
     }
@@ -153,15 +442,21 @@ struct EcsComponent {
      */
     void remove(Entity e)
     {
-        u32 idx = indices[e.handle.idx()];
-        indices[e.handle.idx()] = (u32)-1;
+        HG_ASSERT(has(e));
+        u32 idx = indices.at(e.handle.idx());
+        indices.set(e.handle.idx(), (u32)-1);
         entities.removeSwap(idx);
         components.removeSwap(idx);
+        if (tracked)
+        {
+            added.removeSwap(idx);
+            changed.removeSwap(idx);
+        }
 
         if (idx < entities.count)
         {
             Entity moved = entities[idx];
-            indices[moved.handle.idx()] = idx;
+            indices.set(moved.handle.idx(), idx);
         }
     }
 
@@ -170,7 +465,7 @@ struct EcsComponent {
      */
     bool has(Entity e) const
     {
-        return e.handle.idx() < indices.count && indices[e.handle.idx()] != (u32)-1;
+        return indices.get(e.handle.idx()) != (u32)-1;
     }
 
     /**
@@ -181,7 +476,7 @@ struct EcsComponent {
     T& get(Entity e)
     {
         HG_ASSERT(has(e));
-        return components[indices[e.handle.idx()]];
+        return components[indices.at(e.handle.idx())];
     }
 
     /**
@@ -192,101 +487,3079 @@ struct EcsComponent {
     const T& get(Entity e) const
     {
         HG_ASSERT(has(e));
-        return components[indices[e.handle.idx()]];
+        return components[indices.at(e.handle.idx())];
     }
 
     /**
-     * Get the entity associated with a component
+     * Get the component at an index, without bounds checks, generally only
+     * used internally by queries
      */
-    Entity getEntity(const T& c) const
+    T& at(u64 idx)
     {
-        return entities[static_cast<u32>(&c - components.vals)];
+        if constexpr (ecsTag<T>)
+            return EcsTagArray<T>::tag;
+        else
+            return components.vals[idx];
     }
-};
-
-/**
- * An entity component system
- */
-template<typename... Ts>
-struct Ecs {
-    /**
-     * The entity pool
-     */
-    HandlePool entities;
-    /**
-     * The component systems
-     */
-    Product<EcsComponent<Ts>...> systems{};
 
     /**
-     * Get the component system for a type
+     * Get the component at an index, without bounds checks (const)
      */
-    template<typename T>
-    EcsComponent<T>& getComponentSystem()
+    const T& at(u64 idx) const
     {
-        return systems.template get<idxOf<T, Ts...>()>();
+        if constexpr (ecsTag<T>)
+            return EcsTagArray<T>::tag;
+        else
+            return components.vals[idx];
     }
 
     /**
-     * Get the component system for a type (const)
+     * Get the components at a range of indices, generally only used
+     * internally by forEachChunk
+     *
+     * Note, tags are spans of placeholders, at most ecsChunkSize
      */
-    template<typename T>
-    const EcsComponent<T>& getComponentSystem() const
+    Span<T> span(u64 begin, u64 count)
     {
-        return systems.template get<idxOf<T, Ts...>()>();
+        if constexpr (ecsTag<T>)
+        {
+            HG_ASSERT(count <= ecsChunkSize);
+            return {EcsTagArray<T>::placeholders, count};
+        }
+        else
+        {
+            return {components.vals + begin, count};
+        }
     }
 
     /**
-     * Despawn all entities
+     * Get the components at a range of indices (const)
      */
-    void reset()
+    Span<const T> span(u64 begin, u64 count) const
     {
-        (clear<Ts>(), ...);
-        entities.reset();
+        if constexpr (ecsTag<T>)
+        {
+            HG_ASSERT(count <= ecsChunkSize);
+            return {EcsTagArray<T>::placeholders, count};
+        }
+        else
+        {
+            return {components.vals + begin, count};
+        }
     }
 
     /**
-     * Remove component type from all entities
+     * Get the entity associated with a component
+     *
+     * Note, tags share one instance, so have no entity
      */
-    template<typename T>
-    void clear()
+    Entity getEntity(const T& c) const
     {
-        EcsComponent<T>& s = getComponentSystem<T>();
-        s.indices.reset();
-        s.entities.reset();
-        s.components.reset();
+        static_assert(!ecsTag<T>, "Tags have no associated entity");
+        return entities[static_cast<u32>(&c - components.vals)];
     }
 
     /**
-     * Spawn a new entity with no components
+     * Swap the components at two indices, keeping the sparse indices valid
      */
-    Entity spawn()
+    void swap(u32 a, u32 b)
     {
-        return {entities.alloc()};
-    }
+        if (a == b)
+            return;
 
-    /**
-     * Despawn an entity, destroying all components
-     */
-    void despawn(Entity e)
-    {
-        HG_ASSERT(alive(e));
-        systems.forEach([&](auto& c)
+        if constexpr (!ecsTag<T>)
+            std::swap(components[a], components[b]);
+        std::swap(entities[a], entities[b]);
+        indices.set(entities[a].handle.idx(), a);
+        indices.set(entities[b].handle.idx(), b);
+        if (tracked)
         {
-            if (c.has(e))
-                c.remove(e);
-        });
-        entities.free(e.handle);
+            std::swap(added[a], added[b]);
+            std::swap(changed[a], changed[b]);
+        }
     }
+};
 
+/**
+ * An owning group in an Ecs
+ *
+ * The group owns the packed arrays of its component types and keeps them
+ * partitioned, so the entities with every owned type occupy indices
+ * [0, count) of each array, in the same order. Queries over exactly the
+ * owned types then walk the arrays in lockstep with no sparse lookups.
+ */
+struct EcsGroup {
     /**
-     * Returns whether an entity is still alive
+     * The number of entities in the group
      */
-    bool alive(Entity e) const
+    u32 count = 0;
+    /**
+     * The number of component types owned
+     */
+    u32 ownedCount = 0;
+    /**
+     * Returns whether an entity has every owned type
+     */
+    bool (*hasAll)(void* ecs, Entity e) = nullptr;
+    /**
+     * Swap an entity's owned components to an index in each array
+     */
+    void (*swap)(void* ecs, Entity e, u32 idx) = nullptr;
+};
+
+/**
+ * The component types a system reads, for Ecs::addSystem
+ */
+template<typename... Us>
+struct EcsReads {
+    /**
+     * Returns the mask of the types, bit idxOf<U, Ts...>() for each
+     */
+    template<typename... Ts>
+    static constexpr u64 mask()
+    {
+        static_assert(sizeof...(Ts) <= 64, "Systems support at most 64 component types");
+        return (((u64)1 << idxOf<Us, Ts...>()) | ... | 0);
+    }
+};
+
+/**
+ * The component types a system writes, for Ecs::addSystem
+ */
+template<typename... Us>
+struct EcsWrites {
+    /**
+     * Returns the mask of the types, bit idxOf<U, Ts...>() for each
+     */
+    template<typename... Ts>
+    static constexpr u64 mask()
+    {
+        static_assert(sizeof...(Ts) <= 64, "Systems support at most 64 component types");
+        return (((u64)1 << idxOf<Us, Ts...>()) | ... | 0);
+    }
+};
+
+/**
+ * A system registered with an EcsScheduler
+ */
+struct EcsSystem {
+    /**
+     * The name, for reports
+     */
+    Atom name{};
+    /**
+     * The mask of component types read
+     */
+    u64 reads = 0;
+    /**
+     * The mask of component types written
+     */
+    u64 writes = 0;
+    /**
+     * Whether the system makes structural changes and must run alone
+     */
+    bool exclusive = false;
+    /**
+     * Calls fn with the ecs cast back to its type
+     */
+    void (*thunk)(void* ecs, const EcsSystem* system) = nullptr;
+    /**
+     * The system function, cast to a generic function pointer
+     */
+    void (*fn)() = nullptr;
+    /**
+     * The data passed to the function
+     */
+    void* data = nullptr;
+    /**
+     * The later systems that must wait for this one
+     */
+    Array<u32> dependents{};
+    /**
+     * The number of earlier systems this one must wait for
+     */
+    u32 dependencies = 0;
+    /**
+     * The length of the longest chain of systems this one waits for
+     */
+    u32 level = 0;
+    /**
+     * The time in seconds of the last run
+     */
+    f64 time = 0.0;
+    /**
+     * The total time in seconds of all runs
+     */
+    f64 totalTime = 0.0;
+    /**
+     * The number of runs
+     */
+    u64 runs = 0;
+};
+
+/**
+ * Runs ecs systems on the thread pool, in parallel where their declared
+ * component accesses do not conflict
+ *
+ * Two systems conflict if either writes a type the other reads or writes,
+ * or if either is exclusive. A system waits only for the earlier registered
+ * systems it conflicts with, so the results match running every system in
+ * registration order, and each system starts as soon as those finish.
+ */
+struct EcsScheduler {
+    /**
+     * The systems, in registration order
+     */
+    Array<EcsSystem> systems{};
+    /**
+     * Whether the graph must be rebuilt before the next run
+     */
+    bool dirty = false;
+    /**
+     * The time in seconds of the last run
+     */
+    f64 time = 0.0;
+
+    /**
+     * Remove all systems
+     */
+    void reset();
+
+    /**
+     * Register a system, generally called through Ecs::addSystem
+     */
+    void add(EcsSystem system);
+
+    /**
+     * Returns whether two systems can run at the same time
+     */
+    static bool compatible(const EcsSystem& a, const EcsSystem& b);
+
+    /**
+     * Rebuild the dependencies between systems, called by run when needed
+     */
+    void build();
+
+    /**
+     * Run every system once, blocking until all are complete
+     *
+     * Parameters
+     * - ecs The ecs passed to the systems
+     */
+    void run(void* ecs);
+
+    /**
+     * Logs the schedule and the timings of each system to stdout
+     */
+    void log() const;
+};
+
+/**
+ * Stably sort keys by their high 32 bits, generally only used internally
+ *
+ * A radix sort, skipping the bytes that are equal across all keys. Keys
+ * whose low 32 bits are already ascending come out fully sorted.
+ *
+ * Parameters
+ * - keys The keys to sort in place
+ * - count The number of keys
+ */
+void ecsSortKeys(u64* keys, u64 count);
+
+/**
+ * Encode the difference between two frames of words, generally only used
+ * internally by EcsSnapshots
+ *
+ * The delta is the XOR of the frames, run length encoded: the count of the
+ * target frame, then for each run a word with the number of zero words
+ * skipped in the high half and the number of literal words in the low half,
+ * followed by the literal words. Words past the end of a frame count as zero.
+ *
+ * Parameters
+ * - delta The array to write the delta to, replacing its contents
+ * - from The frame the delta is applied to
+ * - fromCount The number of words in from
+ * - to The frame the delta produces
+ * - toCount The number of words in to
+ */
+void ecsDeltaEncode(Array<u64>* delta, const u64* from, u64 fromCount, const u64* to, u64 toCount);
+
+/**
+ * Apply a delta from ecsDeltaEncode to a frame in place, generally only used
+ * internally by EcsSnapshots
+ */
+void ecsDeltaApply(Array<u64>* frame, const Array<u64>& delta);
+
+/**
+ * Convert a sort key to an unsigned integer in the same order, generally
+ * only used internally by Ecs::sort
+ */
+template<typename K>
+constexpr u32 ecsSortKey(K key)
+{
+    if constexpr (std::is_same_v<K, f32>)
+    {
+        u32 bits = std::bit_cast<u32>(key);
+        return bits & 0x80000000 ? ~bits : bits | 0x80000000;
+    }
+    else
+    {
+        static_assert(std::is_unsigned_v<K> && sizeof(K) <= sizeof(u32), "Ecs sort keys must be f32 or unsigned 32 bit");
+        return key;
+    }
+}
+
+template<typename... Ts>
+struct Ecs;
+
+/**
+ * A component add or remove recorded in an EcsCommands
+ */
+struct EcsCommand {
+    /**
+     * The target entity
+     */
+    Entity entity{};
+    /**
+     * The index of the value in EcsCommands::values, or -1 to remove
+     */
+    u32 value = (u32)-1;
+};
+
+/**
+ * A buffer of structural changes to an Ecs, recorded during parallel
+ * iteration and applied later with Ecs::playCommands
+ *
+ * Each thread or task records into its own buffer, so recording takes no
+ * locks. Spawned entities are reserved from the ecs immediately, and can be
+ * given components in the same buffer, but are not alive until played.
+ */
+template<typename... Ts>
+struct EcsCommands {
+    /**
+     * The ecs to reserve spawned entities from
+     */
+    Ecs<Ts...>* ecs = nullptr;
+    /**
+     * The recorded adds and removes, by component type index
+     */
+    Array<EcsCommand> commands[sizeof...(Ts)] = {};
+    /**
+     * The recorded despawns
+     */
+    Array<Entity> despawns{};
+    /**
+     * The values of the recorded adds, by component type
+     */
+    Product<Array<Ts>...> values{};
+
+    /**
+     * Discard all recorded commands
+     *
+     * Note, reserved entities are still spawned by the next playCommands
+     */
+    void reset()
+    {
+        for (Array<EcsCommand>& c : commands)
+        {
+            c.reset();
+        }
+        despawns.reset();
+        values.forEach([](auto& v)
+        {
+            v.reset();
+        });
+    }
+
+    /**
+     * Returns whether no commands are recorded
+     */
+    bool empty() const
+    {
+        for (const Array<EcsCommand>& c : commands)
+        {
+            if (c.count > 0)
+                return false;
+        }
+        return despawns.count == 0;
+    }
+
+    /**
+     * Reserve an entity, which is spawned by the next playCommands
+     *
+     * Thread safe with other EcsCommands recording into the same ecs
+     */
+    Entity spawn()
+    {
+        HG_ASSERT(ecs != nullptr);
+        return ecs->reserve();
+    }
+
+    /**
+     * Record a despawn
+     */
+    void despawn(Entity e)
+    {
+        despawns.push(e);
+    }
+
+    /**
+     * Record adding a default-constructed component
+     */
+    template<typename T>
+    void add(Entity e)
+    {
+        add<T>(e, T{});
+    }
+
+    /**
+     * Record adding a copy of a component
+     */
+    template<typename T>
+    void add(Entity e, const T& val)
+    {
+        Array<T>& vs = values.template get<idxOf<T, Ts...>()>();
+        commands[idxOf<T, Ts...>()].push({e, (u32)vs.count});
+        vs.push(val);
+    }
+
+    /**
+     * Record adding a component, moving the value into the buffer
+     */
+    template<typename T>
+    void add(Entity e, T&& val)
+    {
+        Array<T>& vs = values.template get<idxOf<T, Ts...>()>();
+        commands[idxOf<T, Ts...>()].push({e, (u32)vs.count});
+        vs.push(std::move(val));
+    }
+
+    /**
+     * Record removing a component
+     */
+    template<typename T>
+    void remove(Entity e)
+    {
+        commands[idxOf<T, Ts...>()].push({e, (u32)-1});
+    }
+};
+
+/**
+ * A set of components to instantiate as many entities, with
+ * Ecs::instantiate
+ */
+template<typename... Ts>
+struct EcsPrefab {
+    /**
+     * Bit idxOf<T, Ts...>() is set for each component type in the prefab
+     */
+    u64 mask = 0;
+    /**
+     * The component values, present for the types in the mask
+     */
+    Product<Maybe<Ts>...> components{};
+
+    /**
+     * Set a component, copying the value
+     */
+    template<typename T>
+    void set(const T& val)
+    {
+        components.template get<idxOf<T, Ts...>()>() = Maybe<T>{val};
+        mask |= (u64)1 << idxOf<T, Ts...>();
+    }
+
+    /**
+     * Set a component, moving the value
+     */
+    template<typename T>
+    void set(T&& val)
+    {
+        components.template get<idxOf<T, Ts...>()>() = Maybe<T>{std::move(val)};
+        mask |= (u64)1 << idxOf<T, Ts...>();
+    }
+
+    /**
+     * Remove a component
+     */
+    template<typename T>
+    void remove()
+    {
+        components.template get<idxOf<T, Ts...>()>() = Maybe<T>{};
+        mask &= ~((u64)1 << idxOf<T, Ts...>());
+    }
+
+    /**
+     * Returns whether the prefab has a component
+     */
+    template<typename T>
+    bool has() const
+    {
+        return (mask & ((u64)1 << idxOf<T, Ts...>())) != 0;
+    }
+
+    /**
+     * Get a component
+     *
+     * Note, the prefab must have the component
+     */
+    template<typename T>
+    T& get()
+    {
+        HG_ASSERT(has<T>());
+        return components.template get<idxOf<T, Ts...>()>().val;
+    }
+
+    /**
+     * Get a component (const)
+     *
+     * Note, the prefab must have the component
+     */
+    template<typename T>
+    const T& get() const
+    {
+        HG_ASSERT(has<T>());
+        return components.template get<idxOf<T, Ts...>()>().val;
+    }
+};
+
+/**
+ * The entities of an ecs merged into another, by Ecs::merge
+ */
+struct EcsEntityMap {
+    /**
+     * The entity pool of the merged ecs
+     */
+    const HandlePool* from = nullptr;
+    /**
+     * The new entities by handle index in the merged ecs
+     */
+    const Entity* to = nullptr;
+
+    /**
+     * Get the new entity of a merged entity, or nullEntity if it was not
+     * alive
+     */
+    Entity get(Entity e) const
+    {
+        if (!from->alive(e.handle))
+            return nullEntity;
+        return to[e.handle.idx()];
+    }
+};
+
+/**
+ * The default remapping of a merged component's entity references, may be
+ * overridden
+ *
+ * Note, types holding an Entity must override this, like ecsSerialize
+ */
+template<typename T>
+void ecsRemap(T* val, const EcsEntityMap* map)
+{
+    static_cast<void>(val);
+    static_cast<void>(map);
+}
+
+/**
+ * Entity remapping
+ */
+template<>
+inline void ecsRemap(Entity* e, const EcsEntityMap* map)
+{
+    *e = map->get(*e);
+}
+
+/**
+ * An entity component system
+ *
+ * Note, at most 64 component types are supported
+ */
+template<typename... Ts>
+struct Ecs {
+    static_assert(sizeof...(Ts) <= 64, "Ecs supports at most 64 component types");
+
+    /**
+     * The entity pool
+     */
+    HandlePool entities;
+    /**
+     * masks[e.handle.idx()] has bit<T>() set for each component the entity
+     * has, maintained by add and remove
+     */
+    Array<u64> masks{};
+    /**
+     * The component systems
+     */
+    Product<EcsComponent<Ts>...> systems{};
+    /**
+     * The owning groups, indexed by EcsComponent::group
+     */
+    Array<EcsGroup> groups{};
+    /**
+     * The registered systems
+     */
+    EcsScheduler scheduler{};
+    /**
+     * The number of entities reserved by EcsCommands and not yet spawned
+     */
+    u32 reserved = 0;
+    /**
+     * The tick stamped on tracked changes, advanced with advanceTick
+     */
+    u32 changeTick = 1;
+
+    /**
+     * Returns the mask bit of a component type
+     */
+    template<typename T>
+    static constexpr u64 bit()
+    {
+        return (u64)1 << idxOf<T, Ts...>();
+    }
+
+    /**
+     * Get the component system for a type
+     */
+    template<typename T>
+    EcsComponent<T>& getComponentSystem()
+    {
+        return systems.template get<idxOf<T, Ts...>()>();
+    }
+
+    /**
+     * Get the component system for a type (const)
+     */
+    template<typename T>
+    const EcsComponent<T>& getComponentSystem() const
+    {
+        return systems.template get<idxOf<T, Ts...>()>();
+    }
+
+    /**
+     * Despawn all entities
+     */
+    void reset()
+    {
+        (clear<Ts>(), ...);
+        entities.reset();
+        masks.reset();
+    }
+
+    /**
+     * Remove component type from all entities
+     */
+    template<typename T>
+    void clear()
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        if (s.tracked)
+        {
+            for (Entity e : s.entities)
+            {
+                s.removed.push(e);
+                s.removedTicks.push(changeTick);
+            }
+            s.added.reset();
+            s.changed.reset();
+        }
+        for (Entity e : s.entities)
+        {
+            masks[e.handle.idx()] &= ~bit<T>();
+        }
+        s.indices.reset();
+        s.entities.reset();
+        s.components.reset();
+        if (s.group != (u32)-1)
+            groups[s.group].count = 0;
+    }
+
+    /**
+     * Spawn a new entity with no components
+     */
+    Entity spawn()
+    {
+        HG_ASSERT(reserved == 0);
+        Entity e{entities.alloc()};
+        if (masks.count < entities.handles.count)
+            masks.resize(entities.handles.count);
+        return e;
+    }
+
+    /**
+     * Reserve an entity to be spawned by the next playCommands, generally
+     * only used internally by EcsCommands
+     *
+     * Thread safe with other reservations. The handles are the ones the
+     * entity pool will allocate next, in order, so spawn and despawn must not
+     * be called until the reservations are played.
+     */
+    Entity reserve()
+    {
+        u32 k = std::atomic_ref<u32>{reserved}.fetch_add(1, std::memory_order_relaxed);
+        if (k < entities.freed.count)
+            return {entities.freed[entities.freed.count - 1 - k]};
+        return {Handle{(u32)(entities.handles.count + (k - entities.freed.count))}};
+    }
+
+    /**
+     * Despawn an entity, destroying all components
+     */
+    void despawn(Entity e)
+    {
+        HG_ASSERT(alive(e));
+        HG_ASSERT(reserved == 0);
+
+        // Only the types in the mask are visited
+        if constexpr (sizeof...(Ts) > 0)
+        {
+            static constexpr void (*removes[])(Ecs*, Entity) = {
+                [](Ecs* ecs, Entity entity) { ecs->template remove<Ts>(entity); }...
+            };
+            for (u64 mask = masks[e.handle.idx()]; mask != 0; mask &= mask - 1)
+            {
+                removes[std::countr_zero(mask)](this, e);
+            }
+        }
+        entities.free(e.handle);
+    }
+
+    /**
+     * Despawn many entities, destroying all components
+     *
+     * The components are removed one type at a time, so each type's storage
+     * is visited once for the whole batch, types none of the entities have
+     * are skipped, and types only the batch has are cleared.
+     *
+     * Note, every entity must be alive and appear only once
+     */
+    void despawnMany(Span<const Entity> es)
+    {
+        HG_ASSERT(reserved == 0);
+
+        u32 counts[sizeof...(Ts) + 1] = {};
+        for (Entity e : es)
+        {
+            HG_ASSERT(alive(e));
+            for (u64 mask = masks[e.handle.idx()]; mask != 0; mask &= mask - 1)
+            {
+                ++counts[std::countr_zero(mask)];
+            }
+        }
+
+        // A type the batch removes entirely, such as when clearing a level,
+        // is cleared at once
+        ([&]()
+        {
+            u32 count = counts[idxOf<Ts, Ts...>()];
+            if (count == 0)
+                return;
+            if (count == getComponentSystem<Ts>().entities.count)
+            {
+                clear<Ts>();
+                return;
+            }
+            for (Entity e : es)
+            {
+                if ((masks[e.handle.idx()] & bit<Ts>()) != 0)
+                    remove<Ts>(e);
+            }
+        }(), ...);
+
+        for (Entity e : es)
+        {
+            entities.free(e.handle);
+        }
+    }
+
+    /**
+     * Returns whether an entity is still alive
+     */
+    bool alive(Entity e) const
+    {
+        return entities.alive(e.handle);
+    }
+
+    /**
+     * Spawn many entities with no components
+     *
+     * The handle pool and masks grow once for the whole batch.
+     *
+     * Parameters
+     * - out The array the entities are written to, one per element
+     */
+    void spawnMany(Span<Entity> out)
+    {
+        HG_ASSERT(reserved == 0);
+
+        u64 fresh = out.count > entities.freed.count ? out.count - entities.freed.count : 0;
+        if (entities.handles.count + fresh > entities.handles.capacity)
+            entities.handles.reserve(std::max(entities.handles.count + fresh, entities.handles.capacity * 2));
+        for (Entity& e : out)
+        {
+            e = {entities.alloc()};
+        }
+        if (masks.count < entities.handles.count)
+            masks.resize(entities.handles.count);
+    }
+
+    /**
+     * Spawn many entities with copies of a prefab's components
+     *
+     * Each component array grows once for the whole batch, and trivially
+     * copyable components are copied with memcpy.
+     *
+     * Parameters
+     * - prefab The components to copy
+     * - out The array the entities are written to, one per element
+     */
+    void instantiate(const EcsPrefab<Ts...>& prefab, Span<Entity> out)
+    {
+        spawnMany(out);
+        ([&]()
+        {
+            if (prefab.template has<Ts>())
+                addMany<Ts>(out, prefab.template get<Ts>());
+        }(), ...);
+    }
+
+    /**
+     * Create a prefab from copies of an entity's components
+     */
+    EcsPrefab<Ts...> prefab(Entity e) const
+    {
+        HG_ASSERT(alive(e));
+        EcsPrefab<Ts...> ret{};
+        ([&]()
+        {
+            if (has<Ts>(e))
+                ret.template set<Ts>(get<Ts>(e));
+        }(), ...);
+        return ret;
+    }
+
+    /**
+     * Add a copy of a component to many entities
+     *
+     * The component's arrays grow once for the whole batch, and trivially
+     * copyable components are copied with memcpy.
+     *
+     * Note, the entities must be alive and must not already have the
+     * component
+     */
+    template<typename T>
+    void addMany(Span<const Entity> es, const T& val)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        u64 begin = s.components.count;
+        u64 end = begin + es.count;
+        if (end > s.entities.capacity)
+        {
+            u64 capacity = std::max(end, s.entities.capacity * 2);
+            s.entities.reserve(capacity);
+            s.components.reserve(capacity);
+        }
+
+        if constexpr (ecsTag<T>)
+        {
+            static_cast<void>(val);
+        }
+        else if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            // Doubling copies, each from the already filled front
+            T* vals = s.components.vals + begin;
+            if (es.count > 0)
+                memcpy(static_cast<void*>(vals), &val, sizeof(T));
+            for (u64 n = 1; n < es.count; n *= 2)
+            {
+                memcpy(static_cast<void*>(vals + n), vals, std::min(n, es.count - n) * sizeof(T));
+            }
+        }
+        else
+        {
+            T* vals = s.components.vals + begin;
+            for (u64 i = 0; i < es.count; ++i)
+            {
+                new (vals + i) T{val};
+            }
+        }
+        s.components.count = end;
+
+        memcpy(s.entities.vals + begin, es.data, es.count * sizeof(Entity));
+        s.entities.count = end;
+        for (u64 i = 0; i < es.count; ++i)
+        {
+            Entity e = es[i];
+            HG_ASSERT(alive(e));
+            HG_ASSERT(!s.has(e));
+            s.indices.set(e.handle.idx(), (u32)(begin + i));
+            masks[e.handle.idx()] |= bit<T>();
+        }
+
+        if (s.tracked)
+        {
+            s.added.resize(end);
+            s.changed.resize(end);
+            for (u64 i = begin; i < end; ++i)
+            {
+                s.added[i] = changeTick;
+                s.changed[i] = changeTick;
+            }
+        }
+        if (s.group != (u32)-1)
+        {
+            for (Entity e : es)
+            {
+                if (groups[s.group].hasAll(this, e))
+                    enterGroup(s.group, e);
+            }
+        }
+    }
+
+    /**
+     * Move all entities of another ecs into this one, such as one built
+     * detached on a worker thread while streaming a level
+     *
+     * The entities are spawned as one batch, each component array grows once
+     * and the other ecs's components are spliced on the end, with memcpy if
+     * trivially copyable. References to entities are remapped with ecsRemap,
+     * and the other ecs is left empty.
+     *
+     * Note, the other ecs's components should only reference its own
+     * entities, references to dead entities become nullEntity
+     *
+     * Parameters
+     * - other The ecs to move the entities from
+     * - remapped If not null, set to the new entities by handle index in the
+     *   other ecs, nullEntity for dead handles
+     */
+    void merge(Ecs& other, Array<Entity>* remapped = nullptr)
+    {
+        HG_ASSERT(&other != this);
+        HG_ASSERT(reserved == 0);
+        HG_ASSERT(other.reserved == 0);
+
+        ArenaScope scratch = getScratch();
+        u64 handleCount = other.entities.handles.count;
+        Entity* to;
+        if (remapped != nullptr)
+        {
+            remapped->resize(handleCount);
+            to = remapped->vals;
+        }
+        else
+        {
+            to = scratch.alloc<Entity>(handleCount);
+        }
+
+        // Freed handles are null in the pool, the rest are alive
+        u64 aliveCount = handleCount - other.entities.freed.count;
+        Entity* spawned = scratch.alloc<Entity>(aliveCount);
+        spawnMany({spawned, aliveCount});
+        for (u64 i = 0, n = 0; i < handleCount; ++i)
+        {
+            to[i] = other.entities.handles[i] == nullHandle ? nullEntity : spawned[n++];
+        }
+
+        EcsEntityMap map{&other.entities, to};
+        (mergeComponents<Ts>(other.template getComponentSystem<Ts>(), map), ...);
+        other.reset();
+    }
+
+    /**
+     * Move one component type of a merged ecs onto the end of this one's,
+     * generally only used internally by merge
+     */
+    template<typename T>
+    void mergeComponents(EcsComponent<T>& src, const EcsEntityMap& map)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        u64 count = src.components.count;
+        if (count == 0)
+            return;
+
+        u64 begin = s.components.count;
+        u64 end = begin + count;
+        if (end > s.entities.capacity)
+        {
+            u64 capacity = std::max(end, s.entities.capacity * 2);
+            s.entities.reserve(capacity);
+            s.components.reserve(capacity);
+        }
+
+        if constexpr (ecsTag<T>)
+        {
+        }
+        else if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            memcpy(static_cast<void*>(s.components.vals + begin), src.components.vals, count * sizeof(T));
+        }
+        else
+        {
+            for (u64 i = 0; i < count; ++i)
+            {
+                new (s.components.vals + begin + i) T{std::move(src.components[i])};
+            }
+        }
+        s.components.count = end;
+
+        for (u64 i = 0; i < count; ++i)
+        {
+            Entity e = map.get(src.entities[i]);
+            s.entities.vals[begin + i] = e;
+            s.indices.set(e.handle.idx(), (u32)(begin + i));
+            masks[e.handle.idx()] |= bit<T>();
+            ecsRemap(&s.at(begin + i), &map);
+        }
+        s.entities.count = end;
+
+        if (s.tracked)
+        {
+            s.added.resize(end);
+            s.changed.resize(end);
+            for (u64 i = begin; i < end; ++i)
+            {
+                s.added[i] = changeTick;
+                s.changed[i] = changeTick;
+            }
+        }
+        if (s.group != (u32)-1)
+        {
+            for (u64 i = begin; i < end; ++i)
+            {
+                if (groups[s.group].hasAll(this, s.entities[i]))
+                    enterGroup(s.group, s.entities[i]);
+            }
+        }
+    }
+
+    /**
+     * Default-construct a component on an entity
+     *
+     * Note, the entity must not already have the component
+     */
+    template<typename T>
+    T& add(Entity e)
+    {
+        HG_ASSERT(alive(e));
+        masks[e.handle.idx()] |= bit<T>();
+        return joinGroup<T>(e, stampAdded<T>(getComponentSystem<T>().add(e)));
+    }
+
+    /**
+     * Copy-construct a component on an entity
+     *
+     * Note, the entity must not already have the component
+     */
+    template<typename T>
+    T& add(Entity e, const T& val)
+    {
+        HG_ASSERT(alive(e));
+        masks[e.handle.idx()] |= bit<T>();
+        return joinGroup<T>(e, stampAdded<T>(getComponentSystem<T>().add(e, val)));
+    }
+
+    /**
+     * Move-construct a component on an entity
+     *
+     * Note, the entity must not already have the component
+     */
+    template<typename T>
+    T& add(Entity e, T&& val)
+    {
+        HG_ASSERT(alive(e));
+        masks[e.handle.idx()] |= bit<T>();
+        return joinGroup<T>(e, stampAdded<T>(getComponentSystem<T>().add(e, std::move(val))));
+    }
+
+    /**
+     * Remove a component from an entity
+     *
+     * Note, the entity must have the component to remove
+     */
+    template<typename T>
+    void remove(Entity e)
+    {
+        HG_ASSERT(alive(e));
+        EcsComponent<T>& s = getComponentSystem<T>();
+        if (s.group != (u32)-1 && s.indices.at(e.handle.idx()) < groups[s.group].count)
+            leaveGroup(s.group, e);
+        s.remove(e);
+        masks[e.handle.idx()] &= ~bit<T>();
+        if (s.tracked)
+        {
+            s.removed.push(e);
+            s.removedTicks.push(changeTick);
+        }
+    }
+
+    /**
+     * Register a system to run with runSystems
+     *
+     * The system must access components only as declared, and must not
+     * spawn, despawn, add or remove, use addExclusiveSystem for that.
+     *
+     * Parameters
+     * - Reads The EcsReads of the types read
+     * - Writes The EcsWrites of the types written
+     * - name The name, for reports
+     * - fn The system function
+     * - data The data passed to the function
+     */
+    template<typename Reads, typename Writes>
+    void addSystem(StringView name, void (*fn)(Ecs* ecs, void* data), void* data = nullptr)
+    {
+        EcsSystem system{};
+        system.name = atom(name);
+        system.reads = Reads::template mask<Ts...>();
+        system.writes = Writes::template mask<Ts...>();
+        system.thunk = &runSystem;
+        system.fn = reinterpret_cast<void (*)()>(fn);
+        system.data = data;
+        scheduler.add(std::move(system));
+    }
+
+    /**
+     * Register a system that runs alone, and may make structural changes
+     *
+     * Parameters
+     * - name The name, for reports
+     * - fn The system function
+     * - data The data passed to the function
+     */
+    void addExclusiveSystem(StringView name, void (*fn)(Ecs* ecs, void* data), void* data = nullptr)
+    {
+        EcsSystem system{};
+        system.name = atom(name);
+        system.exclusive = true;
+        system.thunk = &runSystem;
+        system.fn = reinterpret_cast<void (*)()>(fn);
+        system.data = data;
+        scheduler.add(std::move(system));
+    }
+
+    /**
+     * Calls a system function, generally only used internally
+     */
+    static void runSystem(void* ecs, const EcsSystem* system)
+    {
+        reinterpret_cast<void (*)(Ecs*, void*)>(system->fn)(static_cast<Ecs*>(ecs), system->data);
+    }
+
+    /**
+     * Run every registered system once, in parallel where they do not
+     * conflict, blocking until all are complete
+     */
+    void runSystems()
+    {
+        scheduler.run(this);
+    }
+
+    /**
+     * Apply the commands recorded in a set of buffers, then reset them
+     *
+     * Playback is deterministic for a given order of buffers: reserved
+     * entities are spawned first, then the commands are applied one component
+     * type at a time, sorted by entity, and finally the despawns. When an
+     * entity has several commands for one type, the last one recorded wins,
+     * so only the net change touches storage. Removes of a type are applied
+     * from the back of its packed array, so each swap moves a surviving
+     * component, and adds reserve their space once.
+     *
+     * Adding a component the entity already has assigns it, and removing a
+     * component or despawning an entity that is already gone does nothing.
+     * Commands on entities that are not alive are skipped.
+     *
+     * Parameters
+     * - buffers The buffers to play, in order
+     */
+    void playCommands(Span<EcsCommands<Ts...>> buffers)
+    {
+        u32 spawned = reserved;
+        reserved = 0;
+        for (u32 i = 0; i < spawned; ++i)
+        {
+            entities.alloc();
+        }
+        if (masks.count < entities.handles.count)
+            masks.resize(entities.handles.count);
+
+        (playComponentCommands<Ts>(buffers), ...);
+
+        ArenaScope scratch = getScratch();
+        u64 count = 0;
+        for (const EcsCommands<Ts...>& b : buffers)
+        {
+            count += b.despawns.count;
+        }
+        Entity* despawns = scratch.alloc<Entity>(count);
+        u64* keys = scratch.alloc<u64>(count);
+        count = 0;
+        for (EcsCommands<Ts...>& b : buffers)
+        {
+            for (Entity e : b.despawns)
+            {
+                despawns[count] = e;
+                keys[count] = (u64)e.handle.idx() << 32 | count;
+                ++count;
+            }
+        }
+        ecsSortKeys(keys, count);
+        Entity* dead = scratch.alloc<Entity>(count);
+        u64 deadCount = 0;
+        for (u64 i = 0; i < count; ++i)
+        {
+            Entity e = despawns[(u32)keys[i]];
+            if (alive(e) && (deadCount == 0 || dead[deadCount - 1] != e))
+                dead[deadCount++] = e;
+        }
+        despawnMany({dead, deadCount});
+
+        for (EcsCommands<Ts...>& b : buffers)
+        {
+            b.reset();
+        }
+    }
+
+    /**
+     * Apply the commands recorded in a buffer, then reset it
+     */
+    void playCommands(EcsCommands<Ts...>& buffer)
+    {
+        playCommands(Span<EcsCommands<Ts...>>{&buffer, 1});
+    }
+
+    /**
+     * Apply the recorded commands for one component type, generally only
+     * used internally by playCommands
+     */
+    template<typename T>
+    void playComponentCommands(Span<EcsCommands<Ts...>> buffers)
+    {
+        static constexpr u32 type = idxOf<T, Ts...>();
+
+        struct Ref {
+            u32 buffer;
+            u32 command;
+        };
+
+        u64 count = 0;
+        for (const EcsCommands<Ts...>& b : buffers)
+        {
+            count += b.commands[type].count;
+        }
+        if (count == 0)
+            return;
+
+        // Sort by entity, then by recording order
+        ArenaScope scratch = getScratch();
+        Ref* refs = scratch.alloc<Ref>(count);
+        u64* keys = scratch.alloc<u64>(count);
+        count = 0;
+        for (u32 b = 0; b < buffers.count; ++b)
+        {
+            for (u32 c = 0; c < buffers[b].commands[type].count; ++c)
+            {
+                refs[count] = {b, c};
+                keys[count] = (u64)buffers[b].commands[type][c].entity.handle.idx() << 32 | count;
+                ++count;
+            }
+        }
+        ecsSortKeys(keys, count);
+
+        auto command = [&](u32 ref) -> EcsCommand&
+        {
+            return buffers[refs[ref].buffer].commands[type][refs[ref].command];
+        };
+
+        // Keep the last command on a live entity, split into removes and adds
+        EcsComponent<T>& s = getComponentSystem<T>();
+        u64* removes = scratch.alloc<u64>(count);
+        u32* adds = scratch.alloc<u32>(count);
+        u64 removeCount = 0;
+        u64 addCount = 0;
+        for (u64 i = 0; i < count;)
+        {
+            u64 idx = keys[i] >> 32;
+            u32 last = (u32)-1;
+            for (; i < count && keys[i] >> 32 == idx; ++i)
+            {
+                if (alive(command((u32)keys[i]).entity))
+                    last = (u32)keys[i];
+            }
+            if (last == (u32)-1)
+                continue;
+
+            EcsCommand& cmd = command(last);
+            if (cmd.value != (u32)-1)
+                adds[addCount++] = last;
+            else if (s.has(cmd.entity))
+                removes[removeCount++] = (u64)s.indices.at(cmd.entity.handle.idx()) << 32 | last;
+        }
+
+        ecsSortKeys(removes, removeCount);
+        for (u64 i = removeCount; i-- > 0;)
+        {
+            remove<T>(command((u32)removes[i]).entity);
+        }
+
+        if (s.entities.count + addCount > s.entities.capacity)
+        {
+            u64 capacity = std::max(s.entities.count + addCount, s.entities.capacity * 2);
+            s.entities.reserve(capacity);
+            s.components.reserve(capacity);
+        }
+        for (u64 i = 0; i < addCount; ++i)
+        {
+            EcsCommand& cmd = command(adds[i]);
+            T& val = buffers[refs[adds[i]].buffer].values.template get<type>()[cmd.value];
+            if (s.has(cmd.entity))
+                get<T>(cmd.entity) = std::move(val);
+            else
+                add<T>(cmd.entity, std::move(val));
+        }
+    }
+
+    /**
+     * Start tracking changes to a component type
+     *
+     * Tracked types record the tick each component was added and last
+     * changed, and log the entities they are removed from, for
+     * forEachAdded, forEachChanged and forEachRemoved. A change is a mutable
+     * get or a markChanged, forEach does not mark components changed.
+     *
+     * Note, components already present are stamped with tick 0
+     */
+    template<typename T>
+    void track()
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        if (s.tracked)
+            return;
+
+        s.tracked = true;
+        s.added.reset();
+        s.changed.reset();
+        s.added.resize(s.components.count);
+        s.changed.resize(s.components.count);
+    }
+
+    /**
+     * Stop tracking changes to a component type, discarding its ticks
+     */
+    template<typename T>
+    void untrack()
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        s.tracked = false;
+        s.added.reset();
+        s.changed.reset();
+        s.removed.reset();
+        s.removedTicks.reset();
+    }
+
+    /**
+     * End the current change tick
+     *
+     * A consumer keeps the tick returned after its last query, and passes it
+     * as since to the next, to see exactly the changes made in between.
+     *
+     * Returns
+     * - The tick that ended, every earlier change has at most this tick and
+     *   every later change has a greater one
+     */
+    u32 advanceTick()
+    {
+        return changeTick++;
+    }
+
+    /**
+     * Mark an entity's component as changed in the current tick
+     *
+     * Note, the component type must be tracked and the entity must have it
+     */
+    template<typename T>
+    void markChanged(Entity e)
+    {
+        HG_ASSERT(alive(e));
+        EcsComponent<T>& s = getComponentSystem<T>();
+        HG_ASSERT(s.tracked);
+        HG_ASSERT(s.has(e));
+        s.changed[s.indices.at(e.handle.idx())] = changeTick;
+    }
+
+    /**
+     * Stamp a just added component with the current tick, generally only
+     * used internally
+     *
+     * Returns
+     * - The added component
+     */
+    template<typename T>
+    T& stampAdded(T& added)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        if (s.tracked)
+        {
+            s.added.push(changeTick);
+            s.changed.push(changeTick);
+        }
+        return added;
+    }
+
+    /**
+     * Calls a function for each entity whose component was changed after a
+     * tick, optionally with other components the entity must also have
+     *
+     * The function takes the entity, the components, or both, as forEach.
+     * Adding a component counts as a change.
+     *
+     * Parameters
+     * - since The tick of the last query, from advanceTick
+     * - fn The function to call
+     */
+    template<typename T, typename... Us, typename F>
+    void forEachChanged(u32 since, F fn)
+    {
+        HG_ASSERT(getComponentSystem<T>().tracked);
+        forEachSince<T, Us...>(getComponentSystem<T>().changed, since, fn);
+    }
+
+    /**
+     * Calls a function for each entity whose component was added after a
+     * tick, optionally with other components the entity must also have
+     *
+     * Parameters
+     * - since The tick of the last query, from advanceTick
+     * - fn The function to call
+     */
+    template<typename T, typename... Us, typename F>
+    void forEachAdded(u32 since, F fn)
+    {
+        HG_ASSERT(getComponentSystem<T>().tracked);
+        forEachSince<T, Us...>(getComponentSystem<T>().added, since, fn);
+    }
+
+    /**
+     * Calls a function for each tick filtered component, generally only used
+     * internally by forEachChanged and forEachAdded
+     */
+    template<typename T, typename... Us, typename F>
+    void forEachSince(const Array<u32>& ticks, u32 since, F& fn)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        const u32* t = ticks.vals;
+        u64 count = s.components.count;
+        for (u64 i = 0; i < count; ++i)
+        {
+            // Skip unchanged blocks with a branch free scan
+            if ((i & 15) == 0 && i + 16 <= count)
+            {
+                u32 newest = 0;
+                for (u64 j = i; j < i + 16; ++j)
+                {
+                    newest = std::max(newest, t[j]);
+                }
+                if (newest <= since)
+                {
+                    i += 15;
+                    continue;
+                }
+            }
+            if (t[i] <= since)
+                continue;
+
+            Entity e = s.entities[i];
+            if constexpr (sizeof...(Us) == 0)
+            {
+                if constexpr (std::is_invocable_r_v<void, F, Entity>)
+                    fn(e);
+                else if constexpr (std::is_invocable_r_v<void, F, T&>)
+                    fn(s.components[i]);
+                else
+                    fn(e, s.components[i]);
+            }
+            else
+            {
+                static constexpr u64 query = (bit<Us>() | ...);
+                if ((masks[e.handle.idx()] & query) == query)
+                {
+                    u32 rows[] = {getComponentSystem<Us>().indices.at(e.handle.idx())...};
+                    if constexpr (std::is_invocable_r_v<void, F, Entity>)
+                        fn(e);
+                    else if constexpr (std::is_invocable_r_v<void, F, T&, Us&...>)
+                        fn(s.components[i], getComponentSystem<Us>().components[rows[idxOf<Us, Us...>()]]...);
+                    else
+                        fn(e, s.components[i], getComponentSystem<Us>().components[rows[idxOf<Us, Us...>()]]...);
+                }
+            }
+        }
+    }
+
+    /**
+     * Calls a function for each entity a component was removed from after a
+     * tick, including by despawn
+     *
+     * Note, the entity may have been despawned, or given the component again
+     *
+     * Parameters
+     * - since The tick of the last query, from advanceTick
+     * - fn The function to call with the entity
+     */
+    template<typename T, typename F>
+    void forEachRemoved(u32 since, F fn) const
+    {
+        const EcsComponent<T>& s = getComponentSystem<T>();
+        HG_ASSERT(s.tracked);
+
+        // The log is in tick order, so only its tail is newer
+        u64 begin = s.removed.count;
+        while (begin > 0 && s.removedTicks[begin - 1] > since)
+        {
+            --begin;
+        }
+        for (u64 i = begin; i < s.removed.count; ++i)
+        {
+            fn(s.removed[i]);
+        }
+    }
+
+    /**
+     * Discard removals logged at or before a tick, once every consumer has
+     * seen them
+     */
+    template<typename T>
+    void trimRemoved(u32 tick)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        u64 end = 0;
+        while (end < s.removed.count && s.removedTicks[end] <= tick)
+        {
+            ++end;
+        }
+        if (end == 0)
+            return;
+
+        u64 count = s.removed.count - end;
+        for (u64 i = 0; i < count; ++i)
+        {
+            s.removed[i] = s.removed[end + i];
+            s.removedTicks[i] = s.removedTicks[end + i];
+        }
+        s.removed.resize(count);
+        s.removedTicks.resize(count);
+    }
+
+    /**
+     * Sort a component type's packed array by entity index, restoring
+     * creation order after churn from removeSwap
+     *
+     * Note, the type must not be owned by a group
+     */
+    template<typename T>
+    void sort()
+    {
+        sort<T>([](Entity e, const T&)
+        {
+            return e.handle.idx();
+        });
+    }
+
+    /**
+     * Sort a component type's packed array, so forEach visits it in order
+     *
+     * A function returning an unsigned or f32 key, taking the component or
+     * the entity and the component, sorts stably with a radix sort in O(n).
+     * A function comparing two components, returning whether the first goes
+     * first, sorts with std::sort.
+     *
+     * Note, the type must not be owned by a group
+     *
+     * Parameters
+     * - fn The key or comparison function
+     */
+    template<typename T, typename F>
+    void sort(F fn)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        HG_ASSERT(s.group == (u32)-1);
+
+        u64 count = s.components.count;
+        if (count < 2)
+            return;
+
+        ArenaScope scratch = getScratch();
+        u32* order = scratch.alloc<u32>(count);
+        if constexpr (std::is_invocable_r_v<bool, F, const T&, const T&>)
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                order[i] = i;
+            }
+            std::sort(order, order + count, [&](u32 a, u32 b)
+            {
+                return fn(s.components[a], s.components[b]);
+            });
+        }
+        else
+        {
+            u64* keys = scratch.alloc<u64>(count);
+            for (u32 i = 0; i < count; ++i)
+            {
+                if constexpr (std::is_invocable_v<F, const T&>)
+                    keys[i] = (u64)ecsSortKey(fn(s.components[i])) << 32 | i;
+                else
+                    keys[i] = (u64)ecsSortKey(fn(s.entities[i], s.components[i])) << 32 | i;
+            }
+            ecsSortKeys(keys, count);
+            for (u64 i = 0; i < count; ++i)
+            {
+                order[i] = (u32)keys[i];
+            }
+        }
+        permute<T>(order);
+    }
+
+    /**
+     * Sort a component type's packed array to follow another's, so a forEach
+     * over both walks each array in order
+     *
+     * The entities with both types come first, in the order of U, then the
+     * rest in their current order. Runs in O(n).
+     *
+     * Note, T must not be owned by a group
+     */
+    template<typename T, typename U>
+    void sortToMatch()
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        HG_ASSERT(s.group == (u32)-1);
+
+        u64 count = s.components.count;
+        if (count < 2)
+            return;
+
+        ArenaScope scratch = getScratch();
+        u32* order = scratch.alloc<u32>(count);
+        bool* placed = scratch.alloc<bool>(count);
+        memset(placed, 0, count);
+
+        u64 next = 0;
+        for (Entity e : getComponentSystem<U>().entities)
+        {
+            u32 row = s.indices.get(e.handle.idx());
+            if (row != (u32)-1)
+            {
+                order[next++] = row;
+                placed[row] = true;
+            }
+        }
+        for (u32 i = 0; i < count; ++i)
+        {
+            if (!placed[i])
+                order[next++] = i;
+        }
+        permute<T>(order);
+    }
+
+    /**
+     * Reorder a component type's packed arrays, generally only used
+     * internally by sort
+     *
+     * Parameters
+     * - order The old index of each new index, a permutation
+     */
+    template<typename T>
+    void permute(const u32* order)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        u64 count = s.components.count;
+
+        u64 unmoved = 0;
+        while (unmoved < count && order[unmoved] == unmoved)
+        {
+            ++unmoved;
+        }
+        if (unmoved == count)
+            return;
+
+        // Gathering into new arrays writes sequentially, which beats moving
+        // elements around their cycles in place for scattered orders
+        auto reorder = [&](auto& vals)
+        {
+            std::remove_reference_t<decltype(vals)> sorted{};
+            sorted.reserve(count);
+            for (u64 i = 0; i < count; ++i)
+            {
+                sorted.push(std::move(vals[order[i]]));
+            }
+            vals = std::move(sorted);
+        };
+        if constexpr (!ecsTag<T>)
+            reorder(s.components);
+        reorder(s.entities);
+        if (s.tracked)
+        {
+            reorder(s.added);
+            reorder(s.changed);
+        }
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            s.indices.set(s.entities[i].handle.idx(), i);
+        }
+    }
+
+    /**
+     * Create an owning group for a list of component types
+     *
+     * The group keeps the entities with all of the types at the front of
+     * each type's packed array, in the same order, and forEach over exactly
+     * these types then iterates the arrays in lockstep. Adding and removing
+     * the types maintains the partition, at the cost of a swap per owned
+     * type when an entity joins or leaves.
+     *
+     * Note, a component type can be owned by only one group, and calling
+     * this again with the same types does nothing
+     */
+    template<typename... Us> requires (sizeof...(Us) > 1)
+    void group()
+    {
+        if (getGroup<Us...>() != (u32)-1)
+            return;
+        HG_ASSERT(((getComponentSystem<Us>().group == (u32)-1) && ...));
+
+        u32 g = (u32)groups.count;
+        EcsGroup& grp = groups.push();
+        grp.ownedCount = sizeof...(Us);
+        grp.hasAll = [](void* ecs, Entity e)
+        {
+            return static_cast<Ecs*>(ecs)->template hasAll<Us...>(e);
+        };
+        grp.swap = [](void* ecs, Entity e, u32 idx)
+        {
+            Ecs* self = static_cast<Ecs*>(ecs);
+            ([&]()
+            {
+                EcsComponent<Us>& s = self->template getComponentSystem<Us>();
+                s.swap(s.indices.at(e.handle.idx()), idx);
+            }(), ...);
+        };
+        ((getComponentSystem<Us>().group = g), ...);
+
+        // Swapping only moves entities already visited, so one pass suffices
+        Span<Entity> es = getSmallestEntities<Us...>();
+        for (u64 i = 0; i < es.count; ++i)
+        {
+            Entity e = es[i];
+            if (hasAll<Us...>(e))
+                enterGroup(g, e);
+        }
+    }
+
+    /**
+     * Returns the group owning exactly a list of types, or -1 if none
+     */
+    template<typename... Us>
+    u32 getGroup() const
+    {
+        u32 gs[] = {getComponentSystem<Us>().group...};
+        u32 g = gs[0];
+        if (g == (u32)-1 || groups[g].ownedCount != sizeof...(Us))
+            return (u32)-1;
+        for (u32 other : gs)
+        {
+            if (other != g)
+                return (u32)-1;
+        }
+        return g;
+    }
+
+    /**
+     * Move an entity into a group, generally only used internally
+     */
+    void enterGroup(u32 g, Entity e)
+    {
+        groups[g].swap(this, e, groups[g].count);
+        ++groups[g].count;
+    }
+
+    /**
+     * Move an entity out of a group, generally only used internally
+     */
+    void leaveGroup(u32 g, Entity e)
+    {
+        --groups[g].count;
+        groups[g].swap(this, e, groups[g].count);
+    }
+
+    /**
+     * Move an entity into its group after adding an owned component,
+     * generally only used internally
+     *
+     * Returns
+     * - The added component, after any move
+     */
+    template<typename T>
+    T& joinGroup(Entity e, T& added)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+        if (s.group == (u32)-1 || !groups[s.group].hasAll(this, e))
+            return added;
+
+        enterGroup(s.group, e);
+        return s.get(e);
+    }
+
+    /**
+     * Default-construct components for multiple types at once
+     *
+     * Note, the entity must not already have any of the components
+     */
+    template<typename... Us> requires (sizeof...(Us) > 1)
+    void add(Entity e)
+    {
+        HG_ASSERT(alive(e));
+        (add<Us>(e), ...);
+    }
+
+    /**
+     * Forward-construct components for multiple types at once
+     *
+     * Each argument corresponds positionally to a component type.
+     * Note, the entity must not already have any of the components
+     */
+    template<typename... Us> requires (sizeof...(Us) > 1)
+    void add(Entity e, Us&&... vals)
+    {
+        HG_ASSERT(alive(e));
+        (add<Us>(e, std::forward<Us>(vals)), ...);
+    }
+
+    /**
+     * Remove components for multiple types at once
+     *
+     * Note, the entity must have all the components to remove
+     */
+    template<typename... Us> requires (sizeof...(Us) > 1)
+    void remove(Entity e)
+    {
+        HG_ASSERT(alive(e));
+        (remove<Us>(e), ...);
+    }
+
+    /**
+     * Returns whether an entity has a component
+     */
+    template<typename T>
+    bool has(Entity e) const
+    {
+        HG_ASSERT(alive(e));
+        return (masks[e.handle.idx()] & bit<T>()) != 0;
+    }
+
+    /**
+     * Returns whether an entity has all components in a type list
+     */
+    template<typename... Us>
+    bool hasAll(Entity e) const
+    {
+        HG_ASSERT(alive(e));
+        static constexpr u64 query = (bit<Us>() | ... | 0);
+        return (masks[e.handle.idx()] & query) == query;
+    }
+
+    /**
+     * Returns whether an entity has any component in a type list
+     */
+    template<typename... Us>
+    bool hasAny(Entity e) const
+    {
+        HG_ASSERT(alive(e));
+        static constexpr u64 query = (bit<Us>() | ... | 0);
+        return (masks[e.handle.idx()] & query) != 0;
+    }
+
+    /**
+     * Get a component from an entity
+     *
+     * Note, the entity must have the component
+     */
+    template<typename T>
+    T& get(Entity e)
+    {
+        HG_ASSERT(alive(e));
+        EcsComponent<T>& s = getComponentSystem<T>();
+        HG_ASSERT(s.has(e));
+        if (s.tracked)
+            s.changed[s.indices.at(e.handle.idx())] = changeTick;
+        return s.get(e);
+    }
+
+    /**
+     * Get a component from an entity (const)
+     *
+     * Note, the entity must have the component
+     */
+    template<typename T>
+    const T& get(Entity e) const
+    {
+        HG_ASSERT(alive(e));
+        return getComponentSystem<T>().get(e);
+    }
+
+    /**
+     * Get the entity associated with a component
+     */
+    template<typename T>
+    Entity getEntity(const T& c) const
+    {
+        return getComponentSystem<T>().getEntity(c);
+    }
+
+    /**
+     * Returns the number of active components of a type
+     */
+    template<typename T>
+    u64 count() const
+    {
+        return getComponentSystem<T>().components.count;
+    }
+
+    /**
+     * Returns all entities with a component type, the query of a tag
+     */
+    template<typename T>
+    Span<const Entity> getEntities() const
+    {
+        return getComponentSystem<T>().entities;
+    }
+
+    /**
+     * Returns all components of a type
+     */
+    template<typename T>
+    Span<T> getComponents()
+    {
+        static_assert(!ecsTag<T>, "Tags have no component array, use getEntities");
+        return getComponentSystem<T>().components;
+    }
+
+    /**
+     * Returns all components of a type (const)
+     */
+    template<typename T>
+    Span<const T> getComponents() const
+    {
+        static_assert(!ecsTag<T>, "Tags have no component array, use getEntities");
+        return getComponentSystem<T>().components;
+    }
+
+    /**
+     * Calls a function for each entity with a component type
+     */
+    template<typename T, typename F>
+    void forEach(F fn)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+
+        if constexpr (std::is_invocable_r_v<void, F, Entity>)
+        {
+            for (Entity e : s.entities)
+            {
+                fn(e);
+            }
+        }
+        else if constexpr (std::is_invocable_r_v<void, F, T&>)
+        {
+            for (u64 i = 0; i < s.components.count; ++i)
+            {
+                fn(s.at(i));
+            }
+        }
+        else if constexpr (std::is_invocable_r_v<void, F, Entity, T&>)
+        {
+            Entity* e = s.entities.vals;
+            for (u64 i = 0; i < s.components.count; ++i)
+            {
+                fn(e[i], s.at(i));
+            }
+        }
+        else
+        {
+            static_assert(sizeof(T) == 0, "Invalid lambda in Ecs forEach()");
+        }
+    }
+
+    /**
+     * Calls a function for each entity with a component type (const)
+     */
+    template<typename T, typename F>
+    void forEach(F fn) const
+    {
+        const EcsComponent<T>& s = getComponentSystem<T>();
+
+        if constexpr (std::is_invocable_r_v<void, F, Entity>)
+        {
+            for (const Entity& e : s.entities)
+                fn(e);
+        }
+        else if constexpr (std::is_invocable_r_v<void, F, const T&>)
+        {
+            for (u64 i = 0; i < s.components.count; ++i)
+                fn(s.at(i));
+        }
+        else if constexpr (std::is_invocable_r_v<void, F, Entity, const T&>)
+        {
+            const Entity* e = s.entities.vals;
+            for (u64 i = 0; i < s.components.count; ++i)
+                fn(e[i], s.at(i));
+        }
+        else
+        {
+            static_assert(sizeof(T) == 0, "Invalid lambda in Ecs forEach() const");
+        }
+    }
+
+    /**
+     * Calls a function in parallel for each entity with a component type
+     */
+    template<typename T, typename F>
+    void forEachPar(F fn)
+    {
+        EcsComponent<T>& s = getComponentSystem<T>();
+
+        if constexpr (std::is_invocable_r_v<void, F, Entity>)
+        {
+            Entity* e = s.entities.vals;
+            ecsForChunksPar(s.components.count, [&](u64 begin, u64 end)
+            {
+                for (u64 i = begin; i < end; ++i)
+                    fn(e[i]);
+            });
+        }
+        else if constexpr (std::is_invocable_r_v<void, F, T&>)
+        {
+            ecsForChunksPar(s.components.count, [&](u64 begin, u64 end)
+            {
+                for (u64 i = begin; i < end; ++i)
+                    fn(s.at(i));
+            });
+        }
+        else if constexpr (std::is_invocable_r_v<void, F, Entity, T&>)
+        {
+            Entity* e = s.entities.vals;
+            ecsForChunksPar(s.components.count, [&](u64 begin, u64 end)
+            {
+                for (u64 i = begin; i < end; ++i)
+                    fn(e[i], s.at(i));
+            });
+        }
+    }
+
+    /**
+     * Returns the smallest list of entities with at least one of the types
+     */
+    template<typename... Us>
+    Span<Entity> getSmallestEntities()
+    {
+        Span<Entity> ret{nullptr, (u64)-1};
+        ([&]()
+        {
+            Span<Entity> es = getComponentSystem<Us>().entities;
+            if (es.count < ret.count)
+                ret = es;
+        }(), ...);
+        return ret;
+    }
+
+    /**
+     * Returns the smallest list of entities with at least one of the types (const)
+     */
+    template<typename... Us>
+    Span<const Entity> getSmallestEntities() const
+    {
+        Span<const Entity> ret{nullptr, (u64)-1};
+        ([&]()
+        {
+            Span<const Entity> es = getComponentSystem<Us>().entities;
+            if (es.count < ret.count)
+                ret = es;
+        }(), ...);
+        return ret;
+    }
+
+    /**
+     * Calls a function for each entity with a list of components
+     */
+    template<typename... Us, typename F> requires (sizeof...(Us) > 1)
+    void forEach(F fn)
+    {
+        u32 g = getGroup<Us...>();
+        if (g != (u32)-1)
+        {
+            Entity* es = getSmallestEntities<Us...>().data;
+            for (u64 i = 0; i < groups[g].count; ++i)
+            {
+                if constexpr (std::is_invocable_r_v<void, F, Entity>)
+                    fn(es[i]);
+                else if constexpr (std::is_invocable_r_v<void, F, Us&...>)
+                    fn(getComponentSystem<Us>().at(i)...);
+                else
+                    fn(es[i], getComponentSystem<Us>().at(i)...);
+            }
+            return;
+        }
+
+        for (Entity e : getSmallestEntities<Us...>())
+        {
+            // One AND against the entity's mask, then a sparse lookup per type
+            static constexpr u64 query = (bit<Us>() | ...);
+            if ((masks[e.handle.idx()] & query) == query)
+            {
+                u32 rows[] = {getComponentSystem<Us>().indices.at(e.handle.idx())...};
+                if constexpr (std::is_invocable_r_v<void, F, Entity>)
+                    fn(e);
+                else if constexpr (std::is_invocable_r_v<void, F, decltype(get<Us>(e))...>)
+                    fn(getComponentSystem<Us>().components[rows[idxOf<Us, Us...>()]]...);
+                else
+                    fn(e, getComponentSystem<Us>().components[rows[idxOf<Us, Us...>()]]...);
+            }
+        }
+    }
+
+    /**
+     * Calls a function for each entity with a list of components (const)
+     */
+    template<typename... Us, typename F> requires (sizeof...(Us) > 1)
+    void forEach(F fn) const
+    {
+        u32 g = getGroup<Us...>();
+        if (g != (u32)-1)
+        {
+            const Entity* es = getSmallestEntities<Us...>().data;
+            for (u64 i = 0; i < groups[g].count; ++i)
+            {
+                if constexpr (std::is_invocable_r_v<void, F, Entity>)
+                    fn(es[i]);
+                else if constexpr (std::is_invocable_r_v<void, F, const Us&...>)
+                    fn(getComponentSystem<Us>().at(i)...);
+                else
+                    fn(es[i], getComponentSystem<Us>().at(i)...);
+            }
+            return;
+        }
+
+        for (Entity e : getSmallestEntities<Us...>())
+        {
+            static constexpr u64 query = (bit<Us>() | ...);
+            if ((masks[e.handle.idx()] & query) == query)
+            {
+                u32 rows[] = {getComponentSystem<Us>().indices.at(e.handle.idx())...};
+                if constexpr (std::is_invocable_r_v<void, F, Entity>)
+                    fn(e);
+                else if constexpr (std::is_invocable_r_v<void, F, decltype(get<Us>(e))...>)
+                    fn(getComponentSystem<Us>().components[rows[idxOf<Us, Us...>()]]...);
+                else
+                    fn(e, getComponentSystem<Us>().components[rows[idxOf<Us, Us...>()]]...);
+            }
+        }
+    }
+
+    /**
+     * Calls a function in parallel for each entity with a list of components
+     */
+    template<typename... Us, typename F> requires (sizeof...(Us) > 1)
+    void forEachPar(F fn)
+    {
+        Span<const Entity> entrySpan = getSmallestEntities<Us...>();
+
+        u32 g = getGroup<Us...>();
+        if (g != (u32)-1)
+        {
+            ecsForChunksPar(groups[g].count, [&](u64 begin, u64 end)
+            {
+                for (u64 i = begin; i < end; ++i)
+                {
+                    if constexpr (std::is_invocable_r_v<void, F, Entity>)
+                        fn(entrySpan[i]);
+                    else if constexpr (std::is_invocable_r_v<void, F, Us&...>)
+                        fn(getComponentSystem<Us>().at(i)...);
+                    else
+                        fn(entrySpan[i], getComponentSystem<Us>().at(i)...);
+                }
+            });
+            return;
+        }
+
+        ecsForChunksPar(entrySpan.count, [&](u64 begin, u64 end)
+        {
+            for (u64 i = begin; i < end; ++i)
+            {
+                Entity e = entrySpan[i];
+                static constexpr u64 query = (bit<Us>() | ...);
+                if ((masks[e.handle.idx()] & query) != query)
+                    continue;
+
+                u32 rows[] = {getComponentSystem<Us>().indices.at(e.handle.idx())...};
+                if constexpr (std::is_invocable_r_v<void, F, Entity>)
+                    fn(e);
+                else if constexpr (std::is_invocable_r_v<void, F, decltype(get<Us>(e))...>)
+                    fn(getComponentSystem<Us>().components[rows[idxOf<Us, Us...>()]]...);
+                else
+                    fn(e, getComponentSystem<Us>().components[rows[idxOf<Us, Us...>()]]...);
+            }
+        });
+    }
+
+    /**
+     * Returns the number of leading indices at which every type's arrays
+     * hold the same entities, or -1 if they are not aligned, generally only
+     * used internally by forEachChunk
+     *
+     * A single type is aligned with itself, and the owned types of a group
+     * are aligned over the group.
+     */
+    template<typename... Us>
+    u64 getAlignedCount() const
+    {
+        if constexpr (sizeof...(Us) == 1)
+        {
+            return (getComponentSystem<Us>().entities.count, ...);
+        }
+        else
+        {
+            u32 g = getGroup<Us...>();
+            return g == (u32)-1 ? (u64)-1 : groups[g].count;
+        }
+    }
+
+    /**
+     * Returns whether a chunk's rows of a type are consecutive, so its
+     * components can be passed in place, generally only used internally by
+     * gatherChunks
+     */
+    template<typename T>
+    static bool rowsConsecutive(const u32* rows, u64 count)
+    {
+        if constexpr (ecsTag<T>)
+        {
+            return true;
+        }
+        else
+        {
+            for (u64 i = 1; i < count; ++i)
+            {
+                if (rows[i] != rows[0] + i)
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    /**
+     * Gathers the components of the matching entities into scratch buffers,
+     * calls a function with each chunk, and moves them back, generally only
+     * used internally by forEachChunk
+     *
+     * A type whose rows in the chunk are consecutive, such as the type whose
+     * entities are the candidates, is passed in place instead.
+     *
+     * Parameters
+     * - fn The function to call with each chunk
+     * - candidates The entities to test against the query
+     */
+    template<typename... Us, typename F>
+    void gatherChunks(F& fn, Span<const Entity> candidates)
+    {
+        static constexpr u64 query = (bit<Us>() | ...);
+
+        ArenaScope scratch = getScratch();
+        Entity* es = scratch.alloc<Entity>(ecsChunkSize);
+        u32* rows = scratch.alloc<u32>(ecsChunkSize * sizeof...(Us));
+        void* buffers[] = {scratch.alloc<Us>(ecsChunkSize)...};
+
+        u64 count = 0;
+        auto flush = [&]()
+        {
+            bool inPlace[] = {rowsConsecutive<Us>(rows + idxOf<Us, Us...>() * ecsChunkSize, count)...};
+            ([&]()
+            {
+                static constexpr u32 t = idxOf<Us, Us...>();
+                if (inPlace[t])
+                    return;
+
+                EcsComponent<Us>& s = getComponentSystem<Us>();
+                Us* buffer = static_cast<Us*>(buffers[t]);
+                for (u64 i = 0; i < count; ++i)
+                {
+                    new (buffer + i) Us{std::move(s.at(rows[t * ecsChunkSize + i]))};
+                }
+            }(), ...);
+
+            fn(Span<const Entity>{es, count}, inPlace[idxOf<Us, Us...>()]
+                ? getComponentSystem<Us>().span(rows[idxOf<Us, Us...>() * ecsChunkSize], count)
+                : Span<Us>{static_cast<Us*>(buffers[idxOf<Us, Us...>()]), count}...);
+
+            ([&]()
+            {
+                static constexpr u32 t = idxOf<Us, Us...>();
+                if (inPlace[t])
+                    return;
+
+                EcsComponent<Us>& s = getComponentSystem<Us>();
+                Us* buffer = static_cast<Us*>(buffers[t]);
+                for (u64 i = 0; i < count; ++i)
+                {
+                    s.at(rows[t * ecsChunkSize + i]) = std::move(buffer[i]);
+                    buffer[i].~Us();
+                }
+            }(), ...);
+            count = 0;
+        };
+
+        for (Entity e : candidates)
+        {
+            if ((masks[e.handle.idx()] & query) != query)
+                continue;
+
+            es[count] = e;
+            ((rows[idxOf<Us, Us...>() * ecsChunkSize + count] = getComponentSystem<Us>().indices.at(e.handle.idx())), ...);
+            if (++count == ecsChunkSize)
+                flush();
+        }
+        if (count > 0)
+            flush();
+    }
+
+    /**
+     * Gathers the components of the matching entities into scratch buffers
+     * and calls a function with each chunk (const)
+     *
+     * Note, the components are copied, as they can not be moved out of a
+     * const ecs, so types which are only movable must be queried mutably
+     */
+    template<typename... Us, typename F>
+    void gatherChunks(F& fn, Span<const Entity> candidates) const
+    {
+        static_assert((std::is_copy_constructible_v<Us> && ...),
+            "Const gathered chunks copy their components, query move only types mutably");
+        static constexpr u64 query = (bit<Us>() | ...);
+
+        ArenaScope scratch = getScratch();
+        Entity* es = scratch.alloc<Entity>(ecsChunkSize);
+        u32* rows = scratch.alloc<u32>(ecsChunkSize * sizeof...(Us));
+        void* buffers[] = {scratch.alloc<Us>(ecsChunkSize)...};
+
+        u64 count = 0;
+        auto flush = [&]()
+        {
+            bool inPlace[] = {rowsConsecutive<Us>(rows + idxOf<Us, Us...>() * ecsChunkSize, count)...};
+            ([&]()
+            {
+                static constexpr u32 t = idxOf<Us, Us...>();
+                if (inPlace[t])
+                    return;
+
+                const EcsComponent<Us>& s = getComponentSystem<Us>();
+                Us* buffer = static_cast<Us*>(buffers[t]);
+                for (u64 i = 0; i < count; ++i)
+                {
+                    new (buffer + i) Us{s.at(rows[t * ecsChunkSize + i])};
+                }
+            }(), ...);
+
+            fn(Span<const Entity>{es, count}, inPlace[idxOf<Us, Us...>()]
+                ? getComponentSystem<Us>().span(rows[idxOf<Us, Us...>() * ecsChunkSize], count)
+                : Span<const Us>{static_cast<Us*>(buffers[idxOf<Us, Us...>()]), count}...);
+
+            ([&]()
+            {
+                static constexpr u32 t = idxOf<Us, Us...>();
+                if (inPlace[t])
+                    return;
+
+                Us* buffer = static_cast<Us*>(buffers[t]);
+                for (u64 i = 0; i < count; ++i)
+                {
+                    buffer[i].~Us();
+                }
+            }(), ...);
+            count = 0;
+        };
+
+        for (Entity e : candidates)
+        {
+            if ((masks[e.handle.idx()] & query) != query)
+                continue;
+
+            es[count] = e;
+            ((rows[idxOf<Us, Us...>() * ecsChunkSize + count] = getComponentSystem<Us>().indices.at(e.handle.idx())), ...);
+            if (++count == ecsChunkSize)
+                flush();
+        }
+        if (count > 0)
+            flush();
+    }
+
+    /**
+     * Calls a function for each chunk of entities with a list of components
+     *
+     * The function takes a span of at most ecsChunkSize entities and a span
+     * of each component, parallel to the entities, so kernels can loop over
+     * whole arrays. A single type and the owned types of a group are passed
+     * in place, other queries gather the components into scratch buffers and
+     * move them back after the function.
+     *
+     * Note, the function must not add or remove components, and tags are
+     * passed as spans of placeholders
+     */
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEachChunk(F fn)
+    {
+        u64 aligned = getAlignedCount<Us...>();
+        if (aligned == (u64)-1)
+        {
+            gatherChunks<Us...>(fn, getSmallestEntities<Us...>());
+            return;
+        }
+
+        const Entity* es = getSmallestEntities<Us...>().data;
+        for (u64 begin = 0; begin < aligned; begin += ecsChunkSize)
+        {
+            u64 count = std::min<u64>(ecsChunkSize, aligned - begin);
+            fn(Span<const Entity>{es + begin, count}, getComponentSystem<Us>().span(begin, count)...);
+        }
+    }
+
+    /**
+     * Calls a function for each chunk of entities with a list of components
+     * (const)
+     */
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEachChunk(F fn) const
+    {
+        u64 aligned = getAlignedCount<Us...>();
+        if (aligned == (u64)-1)
+        {
+            gatherChunks<Us...>(fn, getSmallestEntities<Us...>());
+            return;
+        }
+
+        const Entity* es = getSmallestEntities<Us...>().data;
+        for (u64 begin = 0; begin < aligned; begin += ecsChunkSize)
+        {
+            u64 count = std::min<u64>(ecsChunkSize, aligned - begin);
+            fn(Span<const Entity>{es + begin, count}, getComponentSystem<Us>().span(begin, count)...);
+        }
+    }
+
+    /**
+     * Calls a function in parallel for each chunk of entities with a list of
+     * components, as forEachChunk
+     *
+     * Gathered queries gather each chunk of candidate entities on the thread
+     * that runs it.
+     */
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEachChunkPar(F fn)
+    {
+        u64 aligned = getAlignedCount<Us...>();
+        Span<const Entity> es = getSmallestEntities<Us...>();
+        if (aligned == (u64)-1)
+        {
+            ecsForChunksPar(es.count, [&](u64 begin, u64 end)
+            {
+                gatherChunks<Us...>(fn, {es.data + begin, end - begin});
+            });
+            return;
+        }
+
+        ecsForChunksPar(aligned, [&](u64 begin, u64 end)
+        {
+            fn(Span<const Entity>{es.data + begin, end - begin}, getComponentSystem<Us>().span(begin, end - begin)...);
+        });
+    }
+};
+
+/**
+ * A ring of snapshots of an Ecs, for rollback and replay
+ *
+ * A snapshot copies the entity pool, the component masks and each type's
+ * packed arrays into one frame of words, without going through a
+ * Serializer. Only the newest frame is kept whole, each older one is kept
+ * as an XOR delta from the frame after it, run length encoded, so memory is
+ * bounded by the capacity and by how much the world changes per snapshot.
+ * Restoring the newest snapshot is a copy of the arrays, restoring an older
+ * one first applies a delta per step back.
+ *
+ * Note, the component types must be trivially copyable, and the tracked
+ * types and groups must not change between a snapshot and its restore. The
+ * removal logs of tracked types are not part of a snapshot.
+ */
+template<typename... Ts>
+struct EcsSnapshots {
+    static_assert((std::is_trivially_copyable_v<Ts> && ...), "EcsSnapshots requires trivially copyable components");
+
+    /**
+     * The newest snapshot, whole
+     */
+    Array<u64> latest{};
+    /**
+     * The frame being written by snapshot
+     */
+    Array<u64> next{};
+    /**
+     * The deltas, each turning a snapshot into the one before it
+     */
+    Array<Array<u64>> deltas{};
+    /**
+     * The index in deltas of the delta from the newest snapshot
+     */
+    u32 newest = 0;
+    /**
+     * The number of snapshots kept
+     */
+    u32 count = 0;
+
+    /**
+     * Construct empty
+     */
+    EcsSnapshots() noexcept = default;
+
+    /**
+     * Construct with room for a number of snapshots
+     *
+     * Note, the capacity must be at least 1
+     */
+    EcsSnapshots(u32 capacity)
+    {
+        HG_ASSERT(capacity > 0);
+        deltas.resize(capacity - 1);
+    }
+
+    /**
+     * Returns the maximum number of snapshots kept
+     */
+    u32 capacity() const
+    {
+        return (u32)deltas.count + 1;
+    }
+
+    /**
+     * Discard all snapshots, keeping the buffers
+     */
+    void reset()
+    {
+        latest.count = 0;
+        count = 0;
+    }
+
+    /**
+     * Take a snapshot of an ecs, discarding the oldest if full
+     */
+    void snapshot(const Ecs<Ts...>& ecs)
+    {
+        HG_ASSERT(ecs.reserved == 0);
+
+        next.count = 0;
+        writeArray(ecs.entities.handles);
+        writeArray(ecs.entities.freed);
+        writeArray(ecs.masks);
+        writeWord(ecs.changeTick);
+        writeWord(ecs.groups.count);
+        for (const EcsGroup& g : ecs.groups)
+        {
+            writeWord(g.count);
+        }
+        ([&]()
+        {
+            const EcsComponent<Ts>& s = ecs.template getComponentSystem<Ts>();
+            writeArray(s.entities);
+            if constexpr (!ecsTag<Ts>)
+                writeArray(s.components);
+            writeArray(s.added);
+            writeArray(s.changed);
+        }(), ...);
+
+        if (count > 0 && deltas.count > 0)
+        {
+            newest = (newest + 1) % (u32)deltas.count;
+            ecsDeltaEncode(&deltas[newest], next.vals, next.count, latest.vals, latest.count);
+        }
+        std::swap(latest, next);
+        count = std::min(count + 1, capacity());
+    }
+
+    /**
+     * Restore an ecs to a snapshot, discarding the snapshots after it
+     *
+     * Parameters
+     * - ecs The ecs to restore
+     * - back The number of snapshots before the newest, 0 for the newest
+     */
+    void restore(Ecs<Ts...>& ecs, u32 back = 0)
+    {
+        HG_ASSERT(back < count);
+        HG_ASSERT(ecs.reserved == 0);
+
+        for (u32 i = 0; i < back; ++i)
+        {
+            ecsDeltaApply(&latest, deltas[newest]);
+            newest = (newest + (u32)deltas.count - 1) % (u32)deltas.count;
+        }
+        count -= back;
+
+        const u64* word = latest.vals;
+        readArray(word, ecs.entities.handles);
+        readArray(word, ecs.entities.freed);
+        readArray(word, ecs.masks);
+        ecs.changeTick = (u32)*word++;
+        HG_ASSERT(*word == ecs.groups.count);
+        ++word;
+        for (EcsGroup& g : ecs.groups)
+        {
+            g.count = (u32)*word++;
+        }
+        ([&]()
+        {
+            EcsComponent<Ts>& s = ecs.template getComponentSystem<Ts>();
+
+            // Only the indices of slots holding a different entity change
+            u64 savedCount = *word;
+            const Entity* saved = reinterpret_cast<const Entity*>(word + 1);
+            for (u64 i = 0; i < s.entities.count; ++i)
+            {
+                if (i >= savedCount || s.entities[i] != saved[i])
+                    s.indices.set(s.entities[i].handle.idx(), (u32)-1);
+            }
+            for (u64 i = 0; i < savedCount; ++i)
+            {
+                Entity e = saved[i];
+                if (i >= s.entities.count || s.entities[i] != e)
+                    s.indices.set(e.handle.idx(), (u32)i);
+            }
+
+            readArray(word, s.entities);
+            if constexpr (ecsTag<Ts>)
+                s.components.count = s.entities.count;
+            else
+                readArray(word, s.components);
+            readArray(word, s.added);
+            readArray(word, s.changed);
+            HG_ASSERT(!s.tracked || s.added.count == s.components.count);
+        }(), ...);
+    }
+
+    /**
+     * Append a word to the frame being written, generally only used
+     * internally
+     */
+    void writeWord(u64 word)
+    {
+        next.push(word);
+    }
+
+    /**
+     * Append an array's count and bytes to the frame being written, padded
+     * to whole words, generally only used internally
+     */
+    template<typename T>
+    void writeArray(const Array<T>& arr)
+    {
+        u64 bytes = arr.count * sizeof(T);
+        u64 words = (bytes + sizeof(u64) - 1) / sizeof(u64);
+        if (next.count + 1 + words > next.capacity)
+            next.reserve(std::max(next.count + 1 + words, next.capacity * 2));
+
+        next.vals[next.count] = arr.count;
+        if (words > 0)
+            next.vals[next.count + words] = 0;
+        if (bytes > 0)
+            memcpy(next.vals + next.count + 1, arr.vals, bytes);
+        next.count += 1 + words;
+    }
+
+    /**
+     * Read an array written by writeArray, generally only used internally
+     */
+    template<typename T>
+    static void readArray(const u64*& word, Array<T>& arr)
+    {
+        u64 count = *word++;
+        if (count > arr.capacity)
+            arr.reserve(std::max(count, arr.capacity * 2));
+        arr.count = count;
+        if (count > 0)
+            memcpy(static_cast<void*>(arr.vals), word, count * sizeof(T));
+        word += (count * sizeof(T) + sizeof(u64) - 1) / sizeof(u64);
+    }
+};
+
+/**
+ * A table of entities sharing the same set of component types, used by
+ * EcsArchetype
+ *
+ * Row i of every column belongs to entities[i], so a query over a table is
+ * a linear scan of each column in lockstep. Columns for types outside the
+ * table's mask are always empty.
+ */
+template<typename... Ts>
+struct EcsArchetypeTable {
+    /**
+     * Bit idxOf<T, Ts...>() is set for each component type in the table
+     */
+    u64 mask = 0;
+    /**
+     * entities[row] is the entity that owns that row
+     */
+    Array<Entity> entities{};
+    /**
+     * The component data, one column per type
+     */
+    Product<Array<Ts>...> columns{};
+    /**
+     * edges[idx] is the table with component type idx added or removed,
+     * or -1 if not yet looked up
+     */
+    Array<u32> edges{};
+
+    /**
+     * Get the column for a component type
+     */
+    template<typename T>
+    Array<T>& column()
+    {
+        return columns.template get<idxOf<T, Ts...>()>();
+    }
+
+    /**
+     * Get the column for a component type (const)
+     */
+    template<typename T>
+    const Array<T>& column() const
+    {
+        return columns.template get<idxOf<T, Ts...>()>();
+    }
+};
+
+/**
+ * An entity component system with archetype storage
+ *
+ * Entities with the same set of components are stored together in a table,
+ * so multi-component queries scan contiguous columns instead of looking up
+ * each component through a sparse index. Adding or removing a component
+ * moves the entity's row to another table, which makes structural changes
+ * more expensive than in Ecs.
+ *
+ * The entity, component and query API is the same as Ecs, so storage is
+ * chosen at compile time by the world type. Because a component type is
+ * spread over several tables, getComponentSystem, getEntities,
+ * getComponents and getSmallestEntities are not available.
+ *
+ * Note, at most 64 component types are supported
+ */
+template<typename... Ts>
+struct EcsArchetype {
+    static_assert(sizeof...(Ts) <= 64, "EcsArchetype supports at most 64 component types");
+
+    /**
+     * The table type
+     */
+    using Table = EcsArchetypeTable<Ts...>;
+
+    /**
+     * Where an entity's components are stored
+     */
+    struct Location {
+        /**
+         * The index of the table
+         */
+        u32 table = (u32)-1;
+        /**
+         * The row in the table
+         */
+        u32 row = 0;
+    };
+
+    /**
+     * The entity pool
+     */
+    HandlePool entities;
+    /**
+     * locations[e.handle.idx()] is where the entity is stored
+     */
+    Array<Location> locations{};
+    /**
+     * The tables, tables[0] is the table with no components
+     */
+    Array<Table> tables{};
+    /**
+     * The index of the table for each mask
+     */
+    Map<u64, u32> tableLookup{};
+
+    /**
+     * Returns the mask bit of a component type
+     */
+    template<typename T>
+    static constexpr u64 bit()
+    {
+        return (u64)1 << idxOf<T, Ts...>();
+    }
+
+    /**
+     * Calls a function templated on each component type in a mask
+     */
+    template<typename F>
+    static void forEachType(u64 mask, F fn)
+    {
+        ([&]()
+        {
+            if (mask & bit<Ts>())
+                fn.template operator()<Ts>();
+        }(), ...);
+    }
+
+    /**
+     * Find or create the table for a mask, generally only used internally
+     */
+    u32 getTable(u64 mask)
+    {
+        if (tables.count == 0)
+        {
+            tables.push();
+            tableLookup.add(0, 0);
+        }
+
+        u32* idx = tableLookup.get(mask);
+        if (idx != nullptr)
+            return *idx;
+
+        u32 newIdx = (u32)tables.count;
+        tables.push().mask = mask;
+        tableLookup.add(mask, newIdx);
+        return newIdx;
+    }
+
+    /**
+     * Get the table with one component type added or removed, generally only
+     * used internally
+     */
+    u32 getEdge(u32 table, u32 typeIdx)
+    {
+        if (tables[table].edges.count == 0)
+        {
+            tables[table].edges.resize(sizeof...(Ts));
+            for (u32& edge : tables[table].edges)
+            {
+                edge = (u32)-1;
+            }
+        }
+
+        u32 edge = tables[table].edges[typeIdx];
+        if (edge == (u32)-1)
+        {
+            edge = getTable(tables[table].mask ^ ((u64)1 << typeIdx));
+            tables[table].edges[typeIdx] = edge;
+        }
+        return edge;
+    }
+
+    /**
+     * Remove a row from a table, destroying its components, generally only
+     * used internally
+     */
+    void removeRow(Table& t, u32 row)
+    {
+        t.entities.removeSwap(row);
+        forEachType(t.mask, [&]<typename T>()
+        {
+            t.template column<T>().removeSwap(row);
+        });
+
+        if (row < t.entities.count)
+            locations[t.entities[row].handle.idx()].row = row;
+    }
+
+    /**
+     * Move an entity to another table, moving the components both tables
+     * share and destroying the rest, generally only used internally
+     *
+     * Note, components only in the destination table must be pushed after
+     */
+    void moveEntity(Entity e, u32 dstIdx)
+    {
+        Location& loc = locations[e.handle.idx()];
+        Table& src = tables[loc.table];
+        Table& dst = tables[dstIdx];
+
+        u32 row = (u32)dst.entities.count;
+        dst.entities.push(e);
+        forEachType(src.mask & dst.mask, [&]<typename T>()
+        {
+            dst.template column<T>().push(std::move(src.template column<T>()[loc.row]));
+        });
+
+        removeRow(src, loc.row);
+        loc = {dstIdx, row};
+    }
+
+    /**
+     * Does nothing, tables already store the entities with a set of
+     * component types contiguously
+     *
+     * Note, exists so code written for Ecs groups also works here
+     */
+    template<typename... Us> requires (sizeof...(Us) > 1)
+    void group()
+    {
+    }
+
+    /**
+     * Despawn all entities
+     */
+    void reset()
+    {
+        tables.reset();
+        tableLookup.reset();
+        locations.reset();
+        entities.reset();
+    }
+
+    /**
+     * Remove component type from all entities
+     */
+    template<typename T>
+    void clear()
+    {
+        for (u32 i = 0; i < tables.count; ++i)
+        {
+            if ((tables[i].mask & bit<T>()) == 0)
+                continue;
+
+            while (tables[i].entities.count > 0)
+            {
+                remove<T>(tables[i].entities[tables[i].entities.count - 1]);
+            }
+        }
+    }
+
+    /**
+     * Spawn a new entity with no components
+     */
+    Entity spawn()
+    {
+        Entity e{entities.alloc()};
+        if (e.handle.idx() >= locations.count)
+            locations.resize(e.handle.idx() + 1);
+
+        u32 table = getTable(0);
+        locations[e.handle.idx()] = {table, (u32)tables[table].entities.count};
+        tables[table].entities.push(e);
+        return e;
+    }
+
+    /**
+     * Despawn an entity, destroying all components
+     */
+    void despawn(Entity e)
+    {
+        HG_ASSERT(alive(e));
+        Location loc = locations[e.handle.idx()];
+        removeRow(tables[loc.table], loc.row);
+        entities.free(e.handle);
+    }
+
+    /**
+     * Despawn many entities, destroying all components
+     *
+     * Note, every entity must be alive and appear only once
+     */
+    void despawnMany(Span<const Entity> es)
+    {
+        for (Entity e : es)
+        {
+            despawn(e);
+        }
+    }
+
+    /**
+     * Returns whether an entity is still alive
+     */
+    bool alive(Entity e) const
     {
         return entities.alive(e.handle);
     }
 
+    /**
+     * Spawn many entities with no components
+     *
+     * Parameters
+     * - out The array the entities are written to, one per element
+     */
+    void spawnMany(Span<Entity> out)
+    {
+        instantiate(EcsPrefab<Ts...>{}, out);
+    }
+
+    /**
+     * Spawn many entities with copies of a prefab's components
+     *
+     * The entities are appended to the prefab's table directly, growing
+     * each column once for the whole batch.
+     *
+     * Parameters
+     * - prefab The components to copy
+     * - out The array the entities are written to, one per element
+     */
+    void instantiate(const EcsPrefab<Ts...>& prefab, Span<Entity> out)
+    {
+        u32 table = getTable(prefab.mask);
+        Table& t = tables[table];
+        u64 begin = t.entities.count;
+        u64 end = begin + out.count;
+        if (end > t.entities.capacity)
+            t.entities.reserve(std::max(end, t.entities.capacity * 2));
+
+        forEachType(prefab.mask, [&]<typename T>()
+        {
+            Array<T>& column = t.template column<T>();
+            if (end > column.capacity)
+                column.reserve(std::max(end, column.capacity * 2));
+            const T& val = prefab.template get<T>();
+            for (u64 i = 0; i < out.count; ++i)
+            {
+                column.push(val);
+            }
+        });
+
+        for (Entity& e : out)
+        {
+            e = {entities.alloc()};
+            if (e.handle.idx() >= locations.count)
+                locations.resize(e.handle.idx() + 1);
+            locations[e.handle.idx()] = {table, (u32)t.entities.count};
+            t.entities.push(e);
+        }
+    }
+
+    /**
+     * Create a prefab from copies of an entity's components
+     */
+    EcsPrefab<Ts...> prefab(Entity e) const
+    {
+        HG_ASSERT(alive(e));
+        Location loc = locations[e.handle.idx()];
+        const Table& t = tables[loc.table];
+        EcsPrefab<Ts...> ret{};
+        forEachType(t.mask, [&]<typename T>()
+        {
+            ret.template set<T>(t.template column<T>()[loc.row]);
+        });
+        return ret;
+    }
+
     /**
      * Default-construct a component on an entity
      *
@@ -296,7 +3569,10 @@ struct Ecs {
     T& add(Entity e)
     {
         HG_ASSERT(alive(e));
-        return getComponentSystem<T>().add(e);
+        HG_ASSERT(!has<T>(e));
+        u32 table = getEdge(locations[e.handle.idx()].table, idxOf<T, Ts...>());
+        moveEntity(e, table);
+        return tables[table].template column<T>().push();
     }
 
     /**
@@ -308,7 +3584,10 @@ struct Ecs {
     T& add(Entity e, const T& val)
     {
         HG_ASSERT(alive(e));
-        return getComponentSystem<T>().add(e, val);
+        HG_ASSERT(!has<T>(e));
+        u32 table = getEdge(locations[e.handle.idx()].table, idxOf<T, Ts...>());
+        moveEntity(e, table);
+        return tables[table].template column<T>().push(val);
     }
 
     /**
@@ -320,7 +3599,10 @@ struct Ecs {
     T& add(Entity e, T&& val)
     {
         HG_ASSERT(alive(e));
-        return getComponentSystem<T>().add(e, std::move(val));
+        HG_ASSERT(!has<T>(e));
+        u32 table = getEdge(locations[e.handle.idx()].table, idxOf<T, Ts...>());
+        moveEntity(e, table);
+        return tables[table].template column<T>().push(std::move(val));
     }
 
     /**
@@ -332,11 +3614,13 @@ struct Ecs {
     void remove(Entity e)
     {
         HG_ASSERT(alive(e));
-        getComponentSystem<T>().remove(e);
+        HG_ASSERT(has<T>(e));
+        moveEntity(e, getEdge(locations[e.handle.idx()].table, idxOf<T, Ts...>()));
     }
 
     /**
-     * Default-construct components for multiple types at once
+     * Default-construct components for multiple types at once, moving the
+     * entity only once
      *
      * Note, the entity must not already have any of the components
      */
@@ -344,11 +3628,15 @@ struct Ecs {
     void add(Entity e)
     {
         HG_ASSERT(alive(e));
-        (getComponentSystem<Us>().add(e), ...);
+        HG_ASSERT(!hasAny<Us...>(e));
+        u32 table = getTable(tables[locations[e.handle.idx()].table].mask | (bit<Us>() | ...));
+        moveEntity(e, table);
+        (tables[table].template column<Us>().push(), ...);
     }
 
     /**
-     * Forward-construct components for multiple types at once
+     * Forward-construct components for multiple types at once, moving the
+     * entity only once
      *
      * Each argument corresponds positionally to a component type.
      * Note, the entity must not already have any of the components
@@ -357,11 +3645,15 @@ struct Ecs {
     void add(Entity e, Us&&... vals)
     {
         HG_ASSERT(alive(e));
-        (getComponentSystem<Us>().add(e, std::forward<Us>(vals)), ...);
+        HG_ASSERT(!hasAny<std::remove_cvref_t<Us>...>(e));
+        u32 table = getTable(tables[locations[e.handle.idx()].table].mask | (bit<std::remove_cvref_t<Us>>() | ...));
+        moveEntity(e, table);
+        (tables[table].template column<std::remove_cvref_t<Us>>().push(std::forward<Us>(vals)), ...);
     }
 
     /**
-     * Remove components for multiple types at once
+     * Remove components for multiple types at once, moving the entity only
+     * once
      *
      * Note, the entity must have all the components to remove
      */
@@ -369,7 +3661,8 @@ struct Ecs {
     void remove(Entity e)
     {
         HG_ASSERT(alive(e));
-        (getComponentSystem<Us>().remove(e), ...);
+        HG_ASSERT(hasAll<Us...>(e));
+        moveEntity(e, getTable(tables[locations[e.handle.idx()].table].mask & ~(bit<Us>() | ...)));
     }
 
     /**
@@ -379,7 +3672,7 @@ struct Ecs {
     bool has(Entity e) const
     {
         HG_ASSERT(alive(e));
-        return getComponentSystem<T>().has(e);
+        return (tables[locations[e.handle.idx()].table].mask & bit<T>()) != 0;
     }
 
     /**
@@ -408,8 +3701,9 @@ struct Ecs {
     template<typename T>
     T& get(Entity e)
     {
-        HG_ASSERT(alive(e));
-        return getComponentSystem<T>().get(e);
+        HG_ASSERT(has<T>(e));
+        Location loc = locations[e.handle.idx()];
+        return tables[loc.table].template column<T>()[loc.row];
     }
 
     /**
@@ -420,17 +3714,26 @@ struct Ecs {
     template<typename T>
     const T& get(Entity e) const
     {
-        HG_ASSERT(alive(e));
-        return getComponentSystem<T>().get(e);
+        HG_ASSERT(has<T>(e));
+        Location loc = locations[e.handle.idx()];
+        return tables[loc.table].template column<T>()[loc.row];
     }
 
     /**
      * Get the entity associated with a component
+     *
+     * Note, searches the tables with the component type
      */
     template<typename T>
     Entity getEntity(const T& c) const
     {
-        return getComponentSystem<T>().getEntity(c);
+        for (const Table& t : tables)
+        {
+            const Array<T>& col = t.template column<T>();
+            if (&c >= col.vals && &c < col.vals + col.count)
+                return t.entities[static_cast<u64>(&c - col.vals)];
+        }
+        return nullEntity;
     }
 
     /**
@@ -439,233 +3742,157 @@ struct Ecs {
     template<typename T>
     u64 count() const
     {
-        return getComponentSystem<T>().components.count;
-    }
-
-    /**
-     * Returns all entities with a component type
-     */
-    template<typename T>
-    Span<const Entity> getEntities() const
-    {
-        return getComponentSystem<T>().entities;
-    }
-
-    /**
-     * Returns all components of a type
-     */
-    template<typename T>
-    Span<T> getComponents()
-    {
-        return getComponentSystem<T>().components;
-    }
-
-    /**
-     * Returns all components of a type (const)
-     */
-    template<typename T>
-    Span<const T> getComponents() const
-    {
-        return getComponentSystem<T>().components;
+        u64 ret = 0;
+        for (const Table& t : tables)
+        {
+            ret += t.template column<T>().count;
+        }
+        return ret;
     }
 
     /**
-     * Calls a function for each entity with a component type
+     * Calls a function for each row of a table, generally only used
+     * internally
      */
-    template<typename T, typename F>
-    void forEach(F fn)
+    template<typename... Us, typename F>
+    static void forEachRow(Entity* es, F& fn, u64 begin, u64 end, Us*... cs)
     {
-        EcsComponent<T>& s = getComponentSystem<T>();
-
         if constexpr (std::is_invocable_r_v<void, F, Entity>)
         {
-            for (Entity e : s.entities)
-            {
-                fn(e);
-            }
+            for (u64 i = begin; i < end; ++i)
+                fn(es[i]);
         }
-        else if constexpr (std::is_invocable_r_v<void, F, T&>)
+        else if constexpr (std::is_invocable_r_v<void, F, Us&...>)
         {
-            for (T& c : s.components)
-            {
-                fn(c);
-            }
+            for (u64 i = begin; i < end; ++i)
+                fn(cs[i]...);
         }
-        else if constexpr (std::is_invocable_r_v<void, F, Entity, T&>)
+        else if constexpr (std::is_invocable_r_v<void, F, Entity, Us&...>)
         {
-            Entity* e = s.entities.vals;
-            T* c = s.components.vals;
-            T* end = c + s.components.count;
-            for (; c != end; ++c, ++e)
-            {
-                fn(*e, *c);
-            }
+            for (u64 i = begin; i < end; ++i)
+                fn(es[i], cs[i]...);
         }
         else
         {
-            static_assert(sizeof(T) == 0, "Invalid lambda in Ecs forEach()");
+            static_assert(sizeof(F) == 0, "Invalid lambda in EcsArchetype forEach()");
         }
     }
 
     /**
-     * Calls a function for each entity with a component type (const)
+     * Calls a function for each entity with a list of components
      */
-    template<typename T, typename F>
-    void forEach(F fn) const
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEach(F fn)
     {
-        const EcsComponent<T>& s = getComponentSystem<T>();
-
-        if constexpr (std::is_invocable_r_v<void, F, Entity>)
-        {
-            for (const Entity& e : s.entities)
-                fn(e);
-        }
-        else if constexpr (std::is_invocable_r_v<void, F, const T&>)
-        {
-            for (const T& c : s.components)
-                fn(c);
-        }
-        else if constexpr (std::is_invocable_r_v<void, F, Entity, const T&>)
-        {
-            const Entity* e = s.entities.vals;
-            const T* c = s.components.vals;
-            const T* end = c + s.components.count;
-            for (; c != end; ++c, ++e)
-                fn(*e, *c);
-        }
-        else
+        static constexpr u64 query = (bit<Us>() | ...);
+        for (Table& t : tables)
         {
-            static_assert(sizeof(T) == 0, "Invalid lambda in Ecs forEach() const");
+            if ((t.mask & query) == query)
+                forEachRow<Us...>(t.entities.vals, fn, 0, t.entities.count, t.template column<Us>().vals...);
         }
     }
 
     /**
-     * Calls a function in parallel for each entity with a component type
+     * Calls a function for each entity with a list of components (const)
      */
-    template<typename T, typename F>
-    void forEachPar(F fn)
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEach(F fn) const
     {
-        EcsComponent<T>& s = getComponentSystem<T>();
-
-        if constexpr (std::is_invocable_r_v<void, F, Entity>)
-        {
-            Entity* e = s.entities.vals;
-            forPar(0, s.components.count, [&](u64 idx)
-            {
-                fn(e[idx]);
-            });
-        }
-        else if constexpr (std::is_invocable_r_v<void, F, T&>)
+        static constexpr u64 query = (bit<Us>() | ...);
+        for (const Table& t : tables)
         {
-            T* c = s.components.vals;
-            forPar(0, s.components.count, [&](u64 idx)
+            if ((t.mask & query) == query)
             {
-                fn(c[idx]);
-            });
-        }
-        else if constexpr (std::is_invocable_r_v<void, F, Entity, T&>)
-        {
-            Entity* e = s.entities.vals;
-            T* c = s.components.vals;
-            forPar(0, s.components.count, [&](u64 idx)
-            {
-                fn(e[idx], c[idx]);
-            });
+                forEachRow<const Us...>(t.entities.vals, fn, 0, t.entities.count,
+                    static_cast<const Us*>(t.template column<Us>().vals)...);
+            }
         }
     }
 
     /**
-     * Returns the smallest list of entities with at least one of the types
+     * Calls a function in parallel for each entity with a list of components
      */
-    template<typename... Us>
-    Span<Entity> getSmallestEntities()
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEachPar(F fn)
     {
-        Span<Entity> ret{nullptr, (u64)-1};
-        ([&]()
+        static constexpr u64 query = (bit<Us>() | ...);
+        for (Table& t : tables)
         {
-            Span<Entity> es = getComponentSystem<Us>().entities;
-            if (es.count < ret.count)
-                ret = es;
-        }(), ...);
-        return ret;
-    }
+            if ((t.mask & query) != query)
+                continue;
 
-    /**
-     * Returns the smallest list of entities with at least one of the types (const)
-     */
-    template<typename... Us>
-    Span<const Entity> getSmallestEntities() const
-    {
-        Span<const Entity> ret{nullptr, (u64)-1};
-        ([&]()
-        {
-            Span<const Entity> es = getComponentSystem<Us>().entities;
-            if (es.count < ret.count)
-                ret = es;
-        }(), ...);
-        return ret;
+            ecsForChunksPar(t.entities.count, [&](u64 begin, u64 end)
+            {
+                forEachRow<Us...>(t.entities.vals, fn, begin, end, t.template column<Us>().vals...);
+            });
+        }
     }
 
     /**
-     * Calls a function for each entity with a list of components
+     * Calls a function for each chunk of entities with a list of components
+     *
+     * The function takes a span of at most ecsChunkSize entities and a span
+     * of each component, parallel to the entities, straight from the columns
+     * of each matching table.
+     *
+     * Note, the function must not add or remove components
      */
-    template<typename... Us, typename F> requires (sizeof...(Us) > 1)
-    void forEach(F fn)
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEachChunk(F fn)
     {
-        for (Entity e : getSmallestEntities<Us...>())
+        static constexpr u64 query = (bit<Us>() | ...);
+        for (Table& t : tables)
         {
-            if (hasAll<Us...>(e))
+            if ((t.mask & query) != query)
+                continue;
+
+            for (u64 begin = 0; begin < t.entities.count; begin += ecsChunkSize)
             {
-                if constexpr (std::is_invocable_r_v<void, F, Entity>)
-                    fn(e);
-                else if constexpr (std::is_invocable_r_v<void, F, decltype(get<Us>(e))...>)
-                    fn(get<Us>(e)...);
-                else
-                    fn(e, get<Us>(e)...);
+                u64 count = std::min<u64>(ecsChunkSize, t.entities.count - begin);
+                fn(Span<const Entity>{t.entities.vals + begin, count}, Span<Us>{t.template column<Us>().vals + begin, count}...);
             }
         }
     }
 
     /**
-     * Calls a function for each entity with a list of components (const)
+     * Calls a function for each chunk of entities with a list of components
+     * (const)
      */
-    template<typename... Us, typename F> requires (sizeof...(Us) > 1)
-    void forEach(F fn) const
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEachChunk(F fn) const
     {
-        for (Entity e : getSmallestEntities<Us...>())
+        static constexpr u64 query = (bit<Us>() | ...);
+        for (const Table& t : tables)
         {
-            if (hasAll<Us...>(e))
+            if ((t.mask & query) != query)
+                continue;
+
+            for (u64 begin = 0; begin < t.entities.count; begin += ecsChunkSize)
             {
-                if constexpr (std::is_invocable_r_v<void, F, Entity>)
-                    fn(e);
-                else if constexpr (std::is_invocable_r_v<void, F, decltype(get<Us>(e))...>)
-                    fn(get<Us>(e)...);
-                else
-                    fn(e, get<Us>(e)...);
+                u64 count = std::min<u64>(ecsChunkSize, t.entities.count - begin);
+                fn(Span<const Entity>{t.entities.vals + begin, count}, Span<const Us>{t.template column<Us>().vals + begin, count}...);
             }
         }
     }
 
     /**
-     * Calls a function in parallel for each entity with a list of components
+     * Calls a function in parallel for each chunk of entities with a list of
+     * components, as forEachChunk
      */
-    template<typename... Us, typename F> requires (sizeof...(Us) > 1)
-    void forEachPar(F fn)
+    template<typename... Us, typename F> requires (sizeof...(Us) > 0)
+    void forEachChunkPar(F fn)
     {
-        Span<const Entity> entrySpan = getSmallestEntities<Us...>();
-        forPar(0, entrySpan.count, [&](u64 idx)
+        static constexpr u64 query = (bit<Us>() | ...);
+        for (Table& t : tables)
         {
-            Entity e = entrySpan[idx];
-            if (hasAll<Us...>(e))
+            if ((t.mask & query) != query)
+                continue;
+
+            ecsForChunksPar(t.entities.count, [&](u64 begin, u64 end)
             {
-                if constexpr (std::is_invocable_r_v<void, F, Entity>)
-                    fn(e);
-                else if constexpr (std::is_invocable_r_v<void, F, decltype(get<Us>(e))...>)
-                    fn(get<Us>(e)...);
-                else
-                    fn(e, get<Us>(e)...);
-            }
-        });
+                fn(Span<const Entity>{t.entities.vals + begin, end - begin}, Span<Us>{t.template column<Us>().vals + begin, end - begin}...);
+            });
+        }
     }
 };
 
@@ -728,9 +3955,32 @@ inline void ecsSerialize(Serializer* s, Entity* e, EntitySerializer* ecs)
     }
 }
 
+/**
+ * Whether a component type is serialized in bulk, may be overridden
+ *
+ * Bulk types are written as one contiguous blob of components per type,
+ * after a blob of their entities' indices, and loaded back with memcpy.
+ * Tags are always written as only the blob of indices. Other types are
+ * serialized one component at a time with ecsSerialize.
+ *
+ * Only arithmetic and math types are bulk by default. Other types may opt
+ * in by overriding this to true.
+ *
+ * Note, types holding an Entity or overriding ecsSerialize must not opt in,
+ * as the bytes are copied without remapping
+ */
+template<typename T>
+constexpr bool ecsSerializeBulk = std::is_arithmetic_v<T>
+    || std::same_as<T, Vec2> || std::same_as<T, Vec3> || std::same_as<T, Vec4>
+    || std::same_as<T, Mat2> || std::same_as<T, Mat3> || std::same_as<T, Mat4>
+    || std::same_as<T, Complex> || std::same_as<T, Quat>;
+
 /**
  * Ecs serialization
  *
+ * Components whose type is ecsSerializeBulk are written as blobs, the rest
+ * one at a time with ecsSerialize.
+ *
  * Note, if the ecs is not empty, the serialized data is added to the ecs
  */
 template<typename... Ts>
@@ -757,17 +4007,29 @@ void serialize(Serializer* s, Ecs<Ts...>* ecs)
 
         ecs->systems.forEach([&](auto& sys)
         {
+            using T = std::remove_cvref_t<decltype(sys)>::Type;
+
             u32 cCount = (u32)sys.components.count;
             serialize(s, &cCount);
 
-            Entity* e = sys.entities.vals;
-            auto* c = sys.components.vals;
-            auto* end = c + sys.components.count;
-            for (; c != end; ++c, ++e)
+            if constexpr (ecsTag<T> || ecsSerializeBulk<T>)
+            {
+                u32* idxs = scratch.alloc<u32>(cCount);
+                for (u32 i = 0; i < cCount; ++i)
+                {
+                    idxs[i] = es.getIdx(sys.entities[i]);
+                }
+                serializeVoid(s, {idxs, cCount * sizeof(u32)});
+                if constexpr (!ecsTag<T>)
+                    serializeVoid(s, {sys.components.vals, cCount * sizeof(T)});
+                return;
+            }
+
+            for (u32 i = 0; i < cCount; ++i)
             {
-                u32 idx = es.getIdx(*e);
+                u32 idx = es.getIdx(sys.entities[i]);
                 serialize(s, &idx);
-                ecsSerialize(s, c, &es);
+                ecsSerialize(s, &sys.at(i), &es);
             }
         });
     }
@@ -790,9 +4052,40 @@ void serialize(Serializer* s, Ecs<Ts...>* ecs)
             u32 cCount;
             serialize(s, &cCount);
 
+            if constexpr (ecsTag<T> || ecsSerializeBulk<T>)
+            {
+                u32* idxs = scratch.alloc<u32>(cCount);
+                serializeVoid(s, {idxs, cCount * sizeof(u32)});
+
+                // The entities are new, so the components append in order
+                u64 begin = sys.components.count;
+                sys.entities.reserve(begin + cCount);
+                sys.components.reserve(begin + cCount);
+                if constexpr (!ecsTag<T>)
+                    serializeVoid(s, {sys.components.vals + begin, cCount * sizeof(T)});
+                sys.components.count = begin + cCount;
+                for (u32 i = 0; i < cCount; ++i)
+                {
+                    Entity e = es.getEntity(idxs[i]);
+                    sys.indices.set(e.handle.idx(), (u32)sys.entities.count);
+                    sys.entities.push(e);
+                    ecs->masks[e.handle.idx()] |= ecs->template bit<T>();
+                    ecs->template stampAdded<T>(sys.components[begin + i]);
+                }
+                if (sys.group != (u32)-1)
+                {
+                    for (u32 i = 0; i < cCount; ++i)
+                    {
+                        Entity e = es.getEntity(idxs[i]);
+                        ecs->template joinGroup<T>(e, sys.get(e));
+                    }
+                }
+                return;
+            }
+
             for (u32 i = 0; i < cCount; ++i)
             {
-                u32 idx;
+                u32 idx = 0;
                 serialize(s, &idx);
                 ecsSerialize(s, &ecs->template add<T>(es.getEntity(idx)), &es);
             }
@@ -802,4 +4095,105 @@ void serialize(Serializer* s, Ecs<Ts...>* ecs)
     serializeEnd(s);
 }
 
+
+/**
+ * Archetype ecs serialization, in the same format as Ecs
+ *
+ * Note, if the ecs is not empty, the serialized data is added to the ecs
+ */
+template<typename... Ts>
+void serialize(Serializer* s, EcsArchetype<Ts...>* ecs)
+{
+    serializeBegin(s);
+
+    ArenaScope scratch = getScratch(&s->arena, 1);
+
+    if (s->writing)
+    {
+        EntitySerializer es{};
+        es.entityToIdx = scratch.alloc<u32>(ecs->entities.handles.count);
+
+        u32 eCount = 0;
+        for (u32 i = 0; i < ecs->entities.handles.count; ++i)
+        {
+            if (ecs->entities.handles[i].idx() < ecs->entities.handles.count)
+                es.entityToIdx[i] = eCount++;
+            else
+                es.entityToIdx[i] = (u32)-1;
+        }
+        serialize(s, &eCount);
+
+        ([&]()
+        {
+            u32 cCount = (u32)ecs->template count<Ts>();
+            serialize(s, &cCount);
+
+            if constexpr (ecsTag<Ts> || ecsSerializeBulk<Ts>)
+            {
+                u32* idxs = scratch.alloc<u32>(cCount);
+                Ts* vals = scratch.alloc<Ts>(cCount);
+                u32 i = 0;
+                ecs->template forEach<Ts>([&](Entity e, Ts& c)
+                {
+                    idxs[i] = es.getIdx(e);
+                    vals[i] = c;
+                    ++i;
+                });
+                serializeVoid(s, {idxs, cCount * sizeof(u32)});
+                if constexpr (!ecsTag<Ts>)
+                    serializeVoid(s, {vals, cCount * sizeof(Ts)});
+                return;
+            }
+
+            ecs->template forEach<Ts>([&](Entity e, Ts& c)
+            {
+                u32 idx = es.getIdx(e);
+                serialize(s, &idx);
+                ecsSerialize(s, &c, &es);
+            });
+        }(), ...);
+    }
+    else
+    {
+        u32 eCount;
+        serialize(s, &eCount);
+
+        EntitySerializer es{};
+        es.idxToEntity = scratch.alloc<Entity>(eCount);
+        for (u32 i = 0; i < eCount; ++i)
+        {
+            es.idxToEntity[i] = ecs->spawn();
+        }
+
+        ([&]()
+        {
+            u32 cCount;
+            serialize(s, &cCount);
+
+            if constexpr (ecsTag<Ts> || ecsSerializeBulk<Ts>)
+            {
+                u32* idxs = scratch.alloc<u32>(cCount);
+                Ts* vals = scratch.alloc<Ts>(cCount);
+                serializeVoid(s, {idxs, cCount * sizeof(u32)});
+                if constexpr (!ecsTag<Ts>)
+                    serializeVoid(s, {vals, cCount * sizeof(Ts)});
+                for (u32 i = 0; i < cCount; ++i)
+                {
+                    ecs->template add<Ts>(es.getEntity(idxs[i]), vals[i]);
+                }
+                return;
+            }
+
+            for (u32 i = 0; i < cCount; ++i)
+            {
+                u32 idx = 0;
+                serialize(s, &idx);
+                ecsSerialize(s, &ecs->template add<Ts>(es.getEntity(idx)), &es);
+            }
+        }(), ...);
+    }
+
+    serializeEnd(s);
+}
+
 } // namespace hg
@@ -0,0 +1,745 @@
+#pragma once
+
+#include "hg/macros.hpp"
+#include "hg/inttypes.hpp"
+#include "hg/span.hpp"
+#include "hg/memory.hpp"
+#include "hg/array.hpp"
+#include "hg/map.hpp"
+
+#include <utility>
+
+namespace hg {
+
+/**
+ * The number of children of each node in a heap
+ *
+ * Note, 4 children keeps the tree shallow while each sibling group stays
+ * within one or two cache lines for small types
+ */
+static constexpr u64 heapArity = 4;
+
+namespace internal {
+
+/**
+ * Move the value at idx up toward the root until its parent is not greater
+ */
+template<typename T>
+void heapSiftUp(T* vals, u64 idx)
+{
+    if (idx == 0)
+        return;
+
+    T val = std::move(vals[idx]);
+    while (idx > 0)
+    {
+        u64 parent = (idx - 1) / heapArity;
+        if (!(val < vals[parent]))
+            break;
+        vals[idx] = std::move(vals[parent]);
+        idx = parent;
+    }
+    vals[idx] = std::move(val);
+}
+
+/**
+ * Move the value at idx down toward the leaves until no child is smaller
+ */
+template<typename T>
+void heapSiftDown(T* vals, u64 count, u64 idx)
+{
+    if (count < 2)
+        return;
+
+    T val = std::move(vals[idx]);
+    for (;;)
+    {
+        u64 first = idx * heapArity + 1;
+        if (first >= count)
+            break;
+
+        u64 last = first + heapArity < count ? first + heapArity : count;
+        u64 least = first;
+        for (u64 c = first + 1; c < last; ++c)
+        {
+            if (vals[c] < vals[least])
+                least = c;
+        }
+
+        if (!(vals[least] < val))
+            break;
+        vals[idx] = std::move(vals[least]);
+        idx = least;
+    }
+    vals[idx] = std::move(val);
+}
+
+/**
+ * Order an unordered array into a heap in O(n)
+ */
+template<typename T>
+void heapify(T* vals, u64 count)
+{
+    if (count < 2)
+        return;
+
+    for (u64 i = (count - 2) / heapArity + 1; i > 0; --i)
+    {
+        heapSiftDown(vals, count, i - 1);
+    }
+}
+
+} // namespace internal
+
+/**
+ * A 4-ary min heap priority queue
+ *
+ * Note, values are ordered with operator<, the smallest value is on top
+ */
+template<typename T>
+struct Heap {
+    /**
+     * The values in heap order
+     */
+    T* vals = nullptr;
+    /**
+     * The number of vals
+     */
+    u64 count = 0;
+    /**
+     * The current max number of vals
+     */
+    u64 capacity = 0;
+
+    /**
+     * Construct empty
+     */
+    Heap() noexcept = default;
+
+    /**
+     * Construct with init capacity
+     */
+    Heap(u64 capacityVal)
+        : vals{heapAlloc<T>(capacityVal)}
+        , count{0}
+        , capacity{capacityVal}
+    {}
+
+    /**
+     * Construct from unordered values using a bulk heapify
+     */
+    Heap(Span<const T> src)
+        : vals{heapAlloc<T>(src.count)}
+        , count{src.count}
+        , capacity{src.count}
+    {
+        for (u64 i = 0; i < count; ++i)
+        {
+            new (vals + i) T{src[i]};
+        }
+        internal::heapify(vals, count);
+    }
+
+    /**
+     * Free the heap
+     */
+    ~Heap() noexcept
+    {
+        for (u64 i = 0; i < count; ++i)
+        {
+            vals[i].~T();
+        }
+        heapFree(vals, capacity);
+    }
+
+    /**
+     * Remove all values
+     */
+    void reset()
+    {
+        for (u64 i = 0; i < count; ++i)
+        {
+            vals[i].~T();
+        }
+        count = 0;
+    }
+
+    /**
+     * Increase the capacity of the heap to at least newCapacity
+     */
+    void reserve(u64 newCapacity)
+    {
+        if (newCapacity > capacity)
+        {
+            T* newVals = heapAlloc<T>(newCapacity);
+            for (u64 i = 0; i < count; ++i)
+            {
+                new (newVals + i) T{std::move(vals[i])};
+                vals[i].~T();
+            }
+            heapFree(vals, capacity);
+            vals = newVals;
+            capacity = newCapacity;
+        }
+    }
+
+    /**
+     * Push a value into the heap
+     */
+    void push(const T& val)
+    {
+        if (count == capacity)
+            reserve(capacity == 0 ? 64 : capacity * 2);
+
+        new (vals + count) T{val};
+        internal::heapSiftUp(vals, count++);
+    }
+
+    /**
+     * Push a value by rvalue reference into the heap
+     */
+    void push(T&& val)
+    {
+        if (count == capacity)
+            reserve(capacity == 0 ? 64 : capacity * 2);
+
+        new (vals + count) T{std::move(val)};
+        internal::heapSiftUp(vals, count++);
+    }
+
+    /**
+     * Push many values at once, reordering with a single heapify when the
+     * batch is large relative to the heap
+     */
+    void pushMany(Span<const T> src)
+    {
+        if (count + src.count > capacity)
+            reserve(count + src.count > capacity * 2 ? count + src.count : capacity * 2);
+
+        u64 oldCount = count;
+        for (u64 i = 0; i < src.count; ++i)
+        {
+            new (vals + count++) T{src[i]};
+        }
+
+        if (src.count > oldCount)
+        {
+            internal::heapify(vals, count);
+        }
+        else
+        {
+            for (u64 i = oldCount; i < count; ++i)
+            {
+                internal::heapSiftUp(vals, i);
+            }
+        }
+    }
+
+    /**
+     * Access the smallest value
+     */
+    T& peek()
+    {
+        HG_ASSERT(count > 0);
+        return vals[0];
+    }
+
+    /**
+     * Access the smallest value (const)
+     */
+    const T& peek() const
+    {
+        HG_ASSERT(count > 0);
+        return vals[0];
+    }
+
+    /**
+     * Pop the smallest value
+     */
+    T pop()
+    {
+        HG_ASSERT(count > 0);
+
+        --count;
+        T ret = std::move(vals[0]);
+        if (count > 0)
+        {
+            vals[0] = std::move(vals[count]);
+            vals[count].~T();
+            internal::heapSiftDown(vals, count, 0);
+        }
+        else
+        {
+            vals[0].~T();
+        }
+        return ret;
+    }
+
+    /**
+     * Move construct
+     */
+    Heap(Heap&& other) noexcept
+        : vals{std::exchange(other.vals, nullptr)}
+        , count{std::exchange(other.count, 0)}
+        , capacity{std::exchange(other.capacity, 0)}
+    {}
+
+    /**
+     * Move assign
+     */
+    Heap& operator=(Heap&& other) noexcept
+    {
+        if (this != &other)
+        {
+            this->~Heap();
+            new (this) Heap{std::move(other)};
+        }
+        return *this;
+    }
+
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+};
+
+/**
+ * A 4-ary min heap priority queue using an arena
+ *
+ * Note, values are ordered with operator<, the smallest value is on top
+ */
+template<typename T>
+struct HeapTemp {
+    /**
+     * The arena to allocate from
+     */
+    Arena* arena = nullptr;
+    /**
+     * The values in heap order
+     */
+    T* vals = nullptr;
+    /**
+     * The number of vals
+     */
+    u64 count = 0;
+    /**
+     * The current max number of vals
+     */
+    u64 capacity = 0;
+
+    /**
+     * Construct empty
+     */
+    HeapTemp() noexcept = default;
+
+    /**
+     * Construct with init capacity
+     */
+    HeapTemp(Arena* arenaVal, u64 capacityVal)
+        : arena{arenaVal}
+        , vals{arenaVal->alloc<T>(capacityVal)}
+        , count{0}
+        , capacity{capacityVal}
+    {}
+
+    /**
+     * Construct from unordered values using a bulk heapify
+     */
+    HeapTemp(Arena* arenaVal, Span<const T> src)
+        : arena{arenaVal}
+        , vals{arenaVal->alloc<T>(src.count)}
+        , count{src.count}
+        , capacity{src.count}
+    {
+        for (u64 i = 0; i < count; ++i)
+        {
+            new (vals + i) T{src[i]};
+        }
+        internal::heapify(vals, count);
+    }
+
+    /**
+     * Free the heap
+     */
+    ~HeapTemp() noexcept
+    {
+        for (u64 i = 0; i < count; ++i)
+        {
+            vals[i].~T();
+        }
+    }
+
+    /**
+     * Remove all values
+     */
+    void reset()
+    {
+        for (u64 i = 0; i < count; ++i)
+        {
+            vals[i].~T();
+        }
+        count = 0;
+    }
+
+    /**
+     * Increase the capacity of the heap to at least newCapacity
+     */
+    void reserve(u64 newCapacity)
+    {
+        HG_ASSERT(arena != nullptr);
+
+        if (newCapacity > capacity)
+        {
+            if (!arena->extend(vals, capacity, newCapacity))
+            {
+                T* newVals = arena->alloc<T>(newCapacity);
+                for (u64 i = 0; i < count; ++i)
+                {
+                    new (newVals + i) T{std::move(vals[i])};
+                    vals[i].~T();
+                }
+                vals = newVals;
+            }
+            capacity = newCapacity;
+        }
+    }
+
+    /**
+     * Push a value into the heap
+     */
+    void push(const T& val)
+    {
+        if (count == capacity)
+            reserve(capacity == 0 ? 64 : capacity * 2);
+
+        new (vals + count) T{val};
+        internal::heapSiftUp(vals, count++);
+    }
+
+    /**
+     * Push a value by rvalue reference into the heap
+     */
+    void push(T&& val)
+    {
+        if (count == capacity)
+            reserve(capacity == 0 ? 64 : capacity * 2);
+
+        new (vals + count) T{std::move(val)};
+        internal::heapSiftUp(vals, count++);
+    }
+
+    /**
+     * Push many values at once, reordering with a single heapify when the
+     * batch is large relative to the heap
+     */
+    void pushMany(Span<const T> src)
+    {
+        if (count + src.count > capacity)
+            reserve(count + src.count > capacity * 2 ? count + src.count : capacity * 2);
+
+        u64 oldCount = count;
+        for (u64 i = 0; i < src.count; ++i)
+        {
+            new (vals + count++) T{src[i]};
+        }
+
+        if (src.count > oldCount)
+        {
+            internal::heapify(vals, count);
+        }
+        else
+        {
+            for (u64 i = oldCount; i < count; ++i)
+            {
+                internal::heapSiftUp(vals, i);
+            }
+        }
+    }
+
+    /**
+     * Access the smallest value
+     */
+    T& peek()
+    {
+        HG_ASSERT(count > 0);
+        return vals[0];
+    }
+
+    /**
+     * Access the smallest value (const)
+     */
+    const T& peek() const
+    {
+        HG_ASSERT(count > 0);
+        return vals[0];
+    }
+
+    /**
+     * Pop the smallest value
+     */
+    T pop()
+    {
+        HG_ASSERT(count > 0);
+
+        --count;
+        T ret = std::move(vals[0]);
+        if (count > 0)
+        {
+            vals[0] = std::move(vals[count]);
+            vals[count].~T();
+            internal::heapSiftDown(vals, count, 0);
+        }
+        else
+        {
+            vals[0].~T();
+        }
+        return ret;
+    }
+
+    /**
+     * Move construct
+     */
+    HeapTemp(HeapTemp&& other) noexcept
+        : arena{std::exchange(other.arena, nullptr)}
+        , vals{std::exchange(other.vals, nullptr)}
+        , count{std::exchange(other.count, 0)}
+        , capacity{std::exchange(other.capacity, 0)}
+    {}
+
+    /**
+     * Move assign
+     */
+    HeapTemp& operator=(HeapTemp&& other) noexcept
+    {
+        if (this != &other)
+        {
+            this->~HeapTemp();
+            new (this) HeapTemp{std::move(other)};
+        }
+        return *this;
+    }
+
+    HeapTemp(const HeapTemp&) = delete;
+    HeapTemp& operator=(const HeapTemp&) = delete;
+};
+
+/**
+ * A 4-ary min heap of unique keys with mutable priorities
+ *
+ * Each key's position in the heap is tracked in a map, so a key's priority
+ * can be changed or the key removed in O(log n), as needed by A* open lists
+ */
+template<typename K, typename P>
+struct IndexedHeap {
+    /**
+     * A key and its priority
+     */
+    struct Entry {
+        /**
+         * The key
+         */
+        K key{};
+        /**
+         * The priority, ordered with operator<
+         */
+        P priority{};
+    };
+
+    /**
+     * The entries in heap order
+     */
+    Array<Entry> entries{};
+    /**
+     * The index of each key in entries
+     */
+    Map<K, u64> indices{};
+
+    /**
+     * Remove all keys
+     */
+    void reset()
+    {
+        entries.reset();
+        indices.reset();
+    }
+
+    /**
+     * Returns the number of keys
+     */
+    u64 count() const
+    {
+        return entries.count;
+    }
+
+    /**
+     * Returns whether a key is in the heap
+     */
+    bool has(const K& key)
+    {
+        return indices.has(key);
+    }
+
+    /**
+     * Returns a key's priority
+     *
+     * Note, the key must be in the heap
+     */
+    const P& priority(const K& key)
+    {
+        u64* idx = indices.get(key);
+        HG_ASSERT(idx != nullptr);
+        return entries[*idx].priority;
+    }
+
+    /**
+     * Push a key, or change its priority if it is already in the heap
+     */
+    void push(const K& key, const P& priority)
+    {
+        u64* idx = indices.get(key);
+        if (idx != nullptr)
+        {
+            update(key, priority);
+            return;
+        }
+
+        entries.push({key, priority});
+        indices.add(key, entries.count - 1);
+        siftUp(entries.count - 1);
+    }
+
+    /**
+     * Change the priority of a key in either direction
+     *
+     * Note, the key must be in the heap
+     */
+    void update(const K& key, const P& priority)
+    {
+        u64* idx = indices.get(key);
+        HG_ASSERT(idx != nullptr);
+
+        u64 i = *idx;
+        bool decreased = priority < entries[i].priority;
+        entries[i].priority = priority;
+        if (decreased)
+            siftUp(i);
+        else
+            siftDown(i);
+    }
+
+    /**
+     * Access the entry with the smallest priority
+     */
+    const Entry& peek() const
+    {
+        HG_ASSERT(entries.count > 0);
+        return entries[0];
+    }
+
+    /**
+     * Pop the key with the smallest priority
+     */
+    Entry pop()
+    {
+        HG_ASSERT(entries.count > 0);
+
+        Entry ret = std::move(entries[0]);
+        indices.remove(ret.key);
+
+        Entry last = entries.pop();
+        if (entries.count > 0)
+        {
+            entries[0] = std::move(last);
+            *indices.get(entries[0].key) = 0;
+            siftDown(0);
+        }
+        return ret;
+    }
+
+    /**
+     * Remove a key from the heap
+     *
+     * Returns
+     * - Whether the key was in the heap
+     */
+    bool remove(const K& key)
+    {
+        u64 i;
+        if (!indices.remove(key, &i))
+            return false;
+
+        Entry last = entries.pop();
+        if (i < entries.count)
+        {
+            bool decreased = last.priority < entries[i].priority;
+            entries[i] = std::move(last);
+            *indices.get(entries[i].key) = i;
+            if (decreased)
+                siftUp(i);
+            else
+                siftDown(i);
+        }
+        return true;
+    }
+
+    /**
+     * Store an entry at an index and record the index in the map
+     */
+    void place(u64 idx, Entry&& entry)
+    {
+        entries[idx] = std::move(entry);
+        *indices.get(entries[idx].key) = idx;
+    }
+
+    /**
+     * Move the entry at idx up toward the root until its parent is not greater
+     */
+    void siftUp(u64 idx)
+    {
+        if (idx == 0)
+            return;
+
+        Entry entry = std::move(entries[idx]);
+        while (idx > 0)
+        {
+            u64 parent = (idx - 1) / heapArity;
+            if (!(entry.priority < entries[parent].priority))
+                break;
+            place(idx, std::move(entries[parent]));
+            idx = parent;
+        }
+        place(idx, std::move(entry));
+    }
+
+    /**
+     * Move the entry at idx down toward the leaves until no child is smaller
+     */
+    void siftDown(u64 idx)
+    {
+        u64 count = entries.count;
+        if (count < 2)
+            return;
+
+        Entry entry = std::move(entries[idx]);
+        for (;;)
+        {
+            u64 first = idx * heapArity + 1;
+            if (first >= count)
+                break;
+
+            u64 last = first + heapArity < count ? first + heapArity : count;
+            u64 least = first;
+            for (u64 c = first + 1; c < last; ++c)
+            {
+                if (entries[c].priority < entries[least].priority)
+                    least = c;
+            }
+
+            if (!(entries[least].priority < entry.priority))
+                break;
+            place(idx, std::move(entries[least]));
+            idx = least;
+        }
+        place(idx, std::move(entry));
+    }
+};
+
+} // namespace hg
@@ -6,6 +6,8 @@
 #include "hg/array.hpp"
 #include "hg/hash.hpp"
 
+#include <atomic>
+
 namespace hg {
 
 /**
@@ -238,5 +240,152 @@ struct HandlePool {
     void free(Handle handle);
 };
 
+/**
+ * A range of fresh handle indices reserved by one thread
+ *
+ * Handles are allocated from the range without touching the shared pool, so
+ * threads spawning many handles at once do not contend with each other
+ */
+struct HandleBatch {
+    /**
+     * The next index to allocate
+     */
+    u32 next = 0;
+    /**
+     * One past the last index in the range
+     */
+    u32 end = 0;
+};
+
+/**
+ * A handle pool which may be allocated from and freed to by many threads at
+ * once
+ *
+ * Freed handles are kept in a lock free stack, linked through their slots,
+ * and fresh indices are taken with a single atomic add, so the generations
+ * match a HandlePool used on one thread.
+ *
+ * Note, the capacity is fixed when the pool is created, as the slots cannot
+ * move while other threads may be using them
+ */
+struct ConcurrentHandlePool {
+    /**
+     * The maximum number of handles
+     */
+    u32 capacity = 0;
+    /**
+     * The currently active handle ids, or null in vacant slots
+     */
+    std::atomic<u32>* handles = nullptr;
+    /**
+     * The handle each freed slot will be allocated as next
+     */
+    u32* freed = nullptr;
+    /**
+     * The next slot in the free stack after each freed slot
+     */
+    std::atomic<u32>* links = nullptr;
+    /**
+     * The top of the free stack in the low bits, and a count of changes to
+     * it in the high bits, so a stale pop cannot succeed
+     */
+    std::atomic<u64> freeTop{(u32)-1};
+    /**
+     * The number of slots ever allocated, at most the capacity
+     */
+    std::atomic<u32> fresh{0};
+
+    /**
+     * Construct empty, with no capacity
+     */
+    ConcurrentHandlePool() noexcept = default;
+
+    /**
+     * Construct with a fixed capacity
+     *
+     * Parameters
+     * - slotCount The maximum number of handles alive at once, at most 2^24
+     */
+    explicit ConcurrentHandlePool(u32 slotCount);
+
+    /**
+     * Destroy the pool
+     */
+    ~ConcurrentHandlePool() noexcept;
+
+    ConcurrentHandlePool(const ConcurrentHandlePool&) = delete;
+    ConcurrentHandlePool& operator=(const ConcurrentHandlePool&) = delete;
+
+    /**
+     * Reset the pool, invalidating every handle
+     *
+     * Note, not thread safe, no other thread may be using the pool
+     */
+    void reset();
+
+    /**
+     * The number of slots used so far
+     */
+    u32 slots() const;
+
+    /**
+     * Allocate a handle from the pool, thread safe
+     *
+     * Returns
+     * - A freed handle at its next generation, a fresh one, or null if the
+     *   pool is full
+     */
+    Handle alloc();
+
+    /**
+     * Reserve a range of fresh indices for one thread, thread safe
+     *
+     * Parameters
+     * - count The number of indices to reserve, fewer are reserved when the
+     *   pool is nearly full
+     * Returns
+     * - The reserved range
+     */
+    HandleBatch reserve(u32 count);
+
+    /**
+     * Allocate a handle from a batch, or from the pool once it is empty
+     *
+     * Parameters
+     * - batch The batch reserved by this thread
+     * Returns
+     * - The allocated handle, or null if the batch is empty and the pool is
+     *   full
+     */
+    Handle alloc(HandleBatch* batch);
+
+    /**
+     * Free the indices left in a batch back into the pool, thread safe
+     *
+     * Parameters
+     * - batch The batch to release, empty afterwards
+     */
+    void release(HandleBatch* batch);
+
+    /**
+     * Returns whether a handle is alive in the pool, thread safe
+     */
+    bool alive(Handle handle) const;
+
+    /**
+     * Free a handle back into the pool, thread safe
+     *
+     * Note, the handle must be valid and alive, and freed only once
+     */
+    void free(Handle handle);
+
+    /**
+     * Push a chain of slots linked through links onto the free stack
+     *
+     * Note, generally only used internally
+     */
+    void pushFreed(u32 first, u32 last);
+};
+
 } // namespace hg
 
@@ -10,6 +10,7 @@
 #include "hg/maybe.hpp"
 #include "hg/smart_ptr.hpp"
 #include "hg/array.hpp"
+#include "hg/binary.hpp"
 #include "hg/set.hpp"
 #include "hg/map.hpp"
 #include "hg/assets.hpp"
@@ -58,6 +59,216 @@ struct SerialNode {
     SerialData data{};
 };
 
+/**
+ * The header at the start of a serial binary
+ */
+struct SerialBinHeader {
+    /**
+     * The tag identifying the format
+     */
+    char tag[5] = {};
+    /**
+     * The major version of the format
+     */
+    u32 versionMajor = 0;
+    /**
+     * The minor version of the format
+     */
+    u32 versionMinor = 0;
+    /**
+     * The patch version of the format
+     */
+    u32 versionPatch = 0;
+    /**
+     * The offset of the root node
+     */
+    u32 nodeBegin = 0;
+};
+
+/**
+ * An object in a serial binary
+ */
+struct SerialBinObject {
+    /**
+     * The number of fields
+     */
+    u32 fieldCount;
+    /**
+     * The offset of the contiguous field nodes
+     */
+    u32 fieldsBegin;
+};
+
+/**
+ * A string or blob in a serial binary
+ */
+struct SerialBinString {
+    /**
+     * The offset of the bytes
+     */
+    u32 begin;
+    /**
+     * The number of bytes
+     */
+    u32 length;
+};
+
+/**
+ * A node in a serial binary, typed by the index of the type in SerialData
+ */
+struct SerialBinNode {
+    /**
+     * The index of the type in SerialData
+     */
+    u32 type = {};
+    union {
+        SerialBinObject object;
+        SerialBinString string;
+        i64 integer;
+        f64 floating;
+        bool boolean;
+    };
+};
+
+/**
+ * A serial binary being written as values are serialized
+ *
+ * Strings and blobs are written as soon as they are serialized, and the
+ * fields of an object are held only until the object ends, then written
+ * together and pointed to by the object's node, so no node tree is built.
+ */
+struct SerialStream {
+    /**
+     * The builder written to, or null when writing to a file
+     */
+    BinaryBuilder* bin = nullptr;
+    /**
+     * The file written to, or null when writing to a builder
+     */
+    void* file = nullptr;
+    /**
+     * The number of bytes written
+     */
+    u64 size = 0;
+    /**
+     * The offset of the root node, written last
+     */
+    u32 nodeBegin = 0;
+    /**
+     * The fields of the open objects, not yet written
+     */
+    Array<SerialBinNode> pending = {};
+    /**
+     * The index of the first pending field of each open object
+     */
+    Array<u32> opened = {};
+    /**
+     * Whether writing to the file has failed
+     */
+    bool failed = false;
+};
+
+/**
+ * A value in a serial binary, read lazily from its node
+ */
+struct SerialBinValue {
+    /**
+     * The binary containing the value
+     */
+    BinaryView bin = {};
+    /**
+     * The offset of the value's node, or 0 if there is no value
+     */
+    u32 offset = 0;
+
+    /**
+     * Returns whether there is a value
+     */
+    constexpr bool valid() const
+    {
+        return offset != 0;
+    }
+
+    /**
+     * Read the value's node
+     */
+    SerialBinNode node() const;
+
+    /**
+     * Returns whether the value holds the type from SerialData
+     */
+    template<typename T>
+    bool is() const
+    {
+        return valid() && node().type == SerialData::typeIdx<T>;
+    }
+
+    /**
+     * The number of fields in an object
+     */
+    u32 count() const;
+
+    /**
+     * Get a field of an object without reading the others
+     *
+     * Parameters
+     * - idx The index of the field, less than count
+     */
+    SerialBinValue field(u32 idx) const;
+
+    /**
+     * Get an integer
+     */
+    i64 integer() const;
+
+    /**
+     * Get a float
+     */
+    f64 floating() const;
+
+    /**
+     * Get a bool
+     */
+    bool boolean() const;
+
+    /**
+     * Get a string as a view into the binary
+     */
+    StringView string() const;
+
+    /**
+     * Get a blob as a view into the binary
+     */
+    BinaryView blob() const;
+};
+
+/**
+ * A serial binary being read in place, without building nodes
+ *
+ * Fields are found through their object's offsets as they are serialized,
+ * and strings are copied straight out of the binary, so reading from a
+ * mapped file only touches the pages which are read.
+ */
+struct SerialBinReader {
+    /**
+     * The binary read from
+     */
+    BinaryView bin = {};
+    /**
+     * The offset of the node read first
+     */
+    u32 root = 0;
+    /**
+     * The offsets of the nodes of the open objects
+     */
+    Array<u32> parents = {};
+    /**
+     * The offset of the last node read in the innermost object, or 0 before
+     * its first field
+     */
+    u32 current = 0;
+};
+
 /**
  * The data for serialization
  */
@@ -82,6 +293,14 @@ struct Serializer {
      * Whether the serializer is reading or writing
      */
     bool writing = false;
+    /**
+     * The stream written to directly instead of building nodes, if any
+     */
+    SerialStream* stream = nullptr;
+    /**
+     * The binary read from directly instead of from nodes, if any
+     */
+    SerialBinReader* reader = nullptr;
 };
 
 /**
@@ -94,11 +313,77 @@ Serializer serialWriter(Arena* arena);
  */
 Serializer serialReader(Arena* arena, SerialNode* begin);
 
+/**
+ * Begin a serial writer streaming the binary format into a builder
+ *
+ * Parameters
+ * - stream The stream state, must outlive the serializer
+ * - bin The builder to append to
+ * Returns
+ * - The serializer to write with
+ */
+Serializer serialStreamWriter(SerialStream* stream, BinaryBuilder* bin);
+
+/**
+ * Begin a serial writer streaming the binary format into a file
+ *
+ * Parameters
+ * - stream The stream state, must outlive the serializer
+ * - path The path of the file to create
+ * Returns
+ * - The serializer to write with, nothing is written if the file could not
+ *   be created
+ */
+Serializer serialStreamWriter(SerialStream* stream, StringView path);
+
+/**
+ * Finish a streamed binary, writing the root node and closing the file
+ *
+ * Parameters
+ * - stream The stream to finish, exactly one value must have been serialized
+ * Returns
+ * - Whether the whole binary was written
+ */
+bool serialStreamEnd(SerialStream* stream);
+
+/**
+ * Get the root value of a serial binary
+ *
+ * Parameters
+ * - bin The binary, such as a mapped file
+ * Returns
+ * - The root value, or no value if the binary has no header
+ */
+SerialBinValue serialBinRoot(BinaryView bin);
+
+/**
+ * Begin a serial reader over a binary in place
+ *
+ * Parameters
+ * - reader The reader state, must outlive the serializer
+ * - value The value to read, the root or any value within it
+ * Returns
+ * - The serializer to read with
+ */
+Serializer serialBinReader(SerialBinReader* reader, SerialBinValue value);
+
 /**
  * The preamble to serializing a primitive node, generally only used internally
  */
 void serializeNodeStart(Serializer* s);
 
+/**
+ * Read a primitive node, generally only used internally
+ *
+ * Note, strings are views into the arena or binary read from
+ */
+SerialData serializeRead(Serializer* s);
+
+/**
+ * Write a primitive node, generally only used internally
+ */
+void serializeWrite(Serializer* s, const SerialData& data);
+
 /**
  * Begin serializing an object or array
  */
@@ -154,16 +439,15 @@ void serialize(Serializer* s, T (*arr)[N])
 template<std::integral T>
 void serialize(Serializer* s, T* val)
 {
-    serializeNodeStart(s);
-
     if (s->writing)
     {
-        s->current->data = static_cast<i64>(*val);
+        serializeWrite(s, static_cast<i64>(*val));
     }
     else
     {
-        HG_ASSERT(s->current->data.is<i64>());
-        *val = static_cast<T>(s->current->data.get<i64>());
+        SerialData data = serializeRead(s);
+        HG_ASSERT(data.is<i64>());
+        *val = static_cast<T>(data.get<i64>());
     }
 }
 
@@ -173,16 +457,15 @@ void serialize(Serializer* s, T* val)
 template<std::floating_point T>
 void serialize(Serializer* s, T* val)
 {
-    serializeNodeStart(s);
-
     if (s->writing)
     {
-        s->current->data = f64{*val};
+        serializeWrite(s, f64{*val});
     }
     else
     {
-        HG_ASSERT(s->current->data.is<f64>());
-        *val = static_cast<T>(s->current->data.get<f64>());
+        SerialData data = serializeRead(s);
+        HG_ASSERT(data.is<f64>());
+        *val = static_cast<T>(data.get<f64>());
     }
 }
 
@@ -316,6 +599,24 @@ void serialize(Serializer* s, String* val);
 template<>
 void serialize(Serializer* s, Binary* val);
 
+/**
+ * StringView serialization
+ *
+ * Note, a read view points into the arena or binary read from, so does not
+ * outlive it
+ */
+template<>
+void serialize(Serializer* s, StringView* val);
+
+/**
+ * BinaryView serialization
+ *
+ * Note, a read view points into the arena or binary read from, so does not
+ * outlive it
+ */
+template<>
+void serialize(Serializer* s, BinaryView* val);
+
 /**
  * UniquePtr serialization
  */
@@ -338,6 +338,8 @@ i64 stringToInteger(StringView str);
 
 /**
  * Create a float from a base 10 string
+ *
+ * Note, the result is correctly rounded, the nearest double to the decimal
  */
 f64 stringToFloat(StringView str);
 
@@ -351,15 +353,127 @@ f64 stringToFloat(StringView str);
 StringBuilder integerToString(Arena* arena, i64 num);
 
 /**
- * Create a base 10 string from an integer
+ * Create the shortest base 10 string that parses back to the same float
+ *
+ * Note, the string is in positional notation, e.g. 0.001 or 120.0, for
+ * magnitudes from 1e-5 to below 1e17, and in exponent notation, e.g. 1.5e-7,
+ * otherwise, so it is always accepted by isFloat, except for inf and nan
  *
  * Parameters
  * - arena The arena to allocate from
- * - num The integer number to create from
+ * - num The float number to create from
+ */
+StringBuilder floatToString(Arena* arena, f64 num);
+
+/**
+ * Create a base 10 string from a float with a fixed number of decimals
+ *
+ * Note, the decimals are rounded from the exact value of the float, with ties
+ * to even, so they match printf's %f
+ *
+ * Parameters
+ * - arena The arena to allocate from
+ * - num The float number to create from
  * - decimalCount The number of trailing decimal digits
  */
 StringBuilder floatToString(Arena* arena, f64 num, u32 decimalCount);
 
+/**
+ * The codepoint substituted for invalid UTF-8
+ */
+static constexpr u32 utf8Replacement = 0xfffd;
+
+/**
+ * Check whether a string is entirely ASCII
+ */
+bool isAscii(StringView str);
+
+/**
+ * Check whether a string is valid UTF-8
+ *
+ * Note, overlong encodings, surrogates, and codepoints above U+10FFFF are
+ * invalid
+ */
+bool isUtf8(StringView str);
+
+/**
+ * Count the codepoints in a UTF-8 string
+ *
+ * Note, for invalid UTF-8 this counts the bytes that are not continuation
+ * bytes, which may differ from the count utf8Decode produces
+ */
+u64 utf8Length(StringView str);
+
+/**
+ * Decode the codepoint at a position in a UTF-8 string
+ *
+ * Parameters
+ * - str The string to decode from
+ * - head The position to decode at, advanced past the codepoint, or by one
+ *   byte if the sequence is invalid
+ *
+ * Returns
+ * - The codepoint, or utf8Replacement if the sequence is invalid
+ */
+u32 utf8Next(StringView str, u64* head);
+
+/**
+ * Decode a UTF-8 string into codepoints
+ *
+ * Parameters
+ * - str The string to decode
+ * - codepoints The output, must have room for str.length codepoints
+ *
+ * Returns
+ * - The number of codepoints written, each invalid byte writes one
+ *   utf8Replacement
+ */
+u64 utf8Decode(StringView str, u32* codepoints);
+
+/**
+ * Encode a codepoint as UTF-8
+ *
+ * Parameters
+ * - codepoint The codepoint, utf8Replacement is encoded if it is invalid
+ * - chars The output, must have room for 4 chars
+ *
+ * Returns
+ * - The number of chars written
+ */
+u32 utf8Encode(u32 codepoint, char* chars);
+
+/**
+ * Find the first occurrence of a char
+ *
+ * Returns
+ * - The index of the char, or str.length if not found
+ */
+u64 findChar(StringView str, char c, u64 begin = 0);
+
+/**
+ * Find the first newline
+ *
+ * Returns
+ * - The index of the newline, or str.length if not found
+ */
+u64 findNewline(StringView str, u64 begin = 0);
+
+/**
+ * Find the first whitespace char, as defined by isWhitespace
+ *
+ * Returns
+ * - The index of the whitespace, or str.length if not found
+ */
+u64 findWhitespace(StringView str, u64 begin = 0);
+
+/**
+ * Find the first char that is not whitespace, as defined by isWhitespace
+ *
+ * Returns
+ * - The index of the char, or str.length if not found
+ */
+u64 skipWhitespace(StringView str, u64 begin = 0);
+
 // base 2 and 16 string-int conversions : TODO
 // arbitrary base string-int conversions : TODO?
 
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "hg/macros.hpp"
+#include "hg/inttypes.hpp"
+#include "hg/array.hpp"
+#include "hg/pool.hpp"
+#include "hg/time.hpp"
+
+namespace hg {
+
+/**
+ * A scheduled timer in a timer wheel
+ */
+struct Timer {
+    /**
+     * The timer handle
+     */
+    Handle handle = nullHandle;
+};
+
+/**
+ * The null timer
+ */
+static constexpr Timer nullTimer = Timer{};
+
+/**
+ * Compare timers
+ */
+constexpr bool operator==(Timer lhs, Timer rhs)
+{
+    return lhs.handle.id == rhs.handle.id;
+}
+
+/**
+ * Compare timers
+ */
+constexpr bool operator!=(Timer lhs, Timer rhs)
+{
+    return lhs.handle.id != rhs.handle.id;
+}
+
+/**
+ * A hierarchical timer wheel for scheduled callbacks
+ *
+ * Time is quantized into ticks of tickLength seconds. Each level of the wheel
+ * has wheelSize slots, and each slot of a level spans wheelSize times as many
+ * ticks as a slot of the level below. Timers are placed in the lowest level
+ * their delay fits in, and are cascaded down as the wheel turns, so schedule
+ * and cancel are O(1) and each tick only touches the timers that fire.
+ */
+struct TimerWheel {
+    /**
+     * The number of bits of the tick count resolved by each level
+     */
+    static constexpr u32 wheelBits = 6;
+    /**
+     * The number of slots in each level
+     */
+    static constexpr u32 wheelSize = 1 << wheelBits;
+    /**
+     * The number of levels, timers further out than wheelSize^wheelLevels
+     * ticks are parked in the top level until they come within range
+     */
+    static constexpr u32 wheelLevels = 4;
+
+    /**
+     * A scheduled timer's state
+     */
+    struct Node {
+        /**
+         * The tick the timer fires on
+         */
+        u64 expiry = 0;
+        /**
+         * The number of ticks between repeats, or 0 to fire once
+         */
+        u64 interval = 0;
+        /**
+         * The function to call when the timer fires
+         */
+        void (*fn)(void* data) = nullptr;
+        /**
+         * The data passed to fn
+         */
+        void* data = nullptr;
+        /**
+         * The previous node in the slot, or -1
+         */
+        u32 prev = (u32)-1;
+        /**
+         * The next node in the slot, or -1
+         */
+        u32 next = (u32)-1;
+        /**
+         * The slot the node is linked into
+         */
+        u32 slot = (u32)-1;
+    };
+
+    /**
+     * A callback gathered for dispatch
+     */
+    struct Call {
+        /**
+         * The function to call
+         */
+        void (*fn)(void* data) = nullptr;
+        /**
+         * The data passed to fn
+         */
+        void* data = nullptr;
+    };
+
+    /**
+     * The length of a tick in seconds
+     */
+    f64 tickLength = 1.0 / 60.0;
+    /**
+     * The number of ticks elapsed
+     */
+    u64 now = 0;
+    /**
+     * Time accumulated toward the next tick, in seconds
+     */
+    f64 accumulated = 0.0;
+    /**
+     * The clock driving update
+     */
+    Clock clock{};
+    /**
+     * The minimum number of callbacks in a tick before they are dispatched to
+     * the thread pool instead of being called on this thread
+     */
+    u32 parallelThreshold = 64;
+    /**
+     * The timer handles
+     */
+    HandlePool handles{};
+    /**
+     * nodes[t.handle.idx()] is the state of timer t
+     */
+    Array<Node> nodes{};
+    /**
+     * The first node in each slot, or -1, indexed by level * wheelSize + slot
+     */
+    u32 slots[wheelLevels * wheelSize];
+    /**
+     * The callbacks gathered in the current tick
+     */
+    Array<Call> fired{};
+
+    /**
+     * Construct with a tick length in seconds
+     */
+    TimerWheel(f64 tickLengthVal = 1.0 / 60.0);
+
+    /**
+     * Cancel all timers
+     */
+    void reset();
+
+    /**
+     * Schedule a callback
+     *
+     * Parameters
+     * - delay The time in seconds until the timer fires, rounded up to ticks
+     * - data The data passed to fn
+     * - fn The function to call, may be called from any thread
+     * - interval The time in seconds between repeats, or 0 to fire once
+     *
+     * Returns
+     * - The timer, valid until it fires for the last time or is cancelled
+     */
+    Timer schedule(f64 delay, void* data, void (*fn)(void* data), f64 interval = 0.0);
+
+    /**
+     * Cancel a scheduled timer
+     *
+     * Returns
+     * - Whether the timer was still scheduled
+     */
+    bool cancel(Timer timer);
+
+    /**
+     * Returns whether a timer is still scheduled
+     */
+    bool scheduled(Timer timer) const;
+
+    /**
+     * Returns the time in seconds until a timer fires
+     *
+     * Note, the timer must be scheduled
+     */
+    f64 remaining(Timer timer) const;
+
+    /**
+     * Advance the wheel by the time since the last update
+     *
+     * Returns
+     * - The number of callbacks dispatched
+     */
+    u32 update();
+
+    /**
+     * Advance the wheel by a time in seconds, dispatching expired callbacks
+     *
+     * Returns
+     * - The number of callbacks dispatched
+     */
+    u32 advance(f64 seconds);
+
+    /**
+     * Advance the wheel by one tick, dispatching expired callbacks
+     *
+     * Returns
+     * - The number of callbacks dispatched
+     */
+    u32 tick();
+
+    /**
+     * Convert a time in seconds to a whole number of ticks, at least 1
+     */
+    u64 secondsToTicks(f64 seconds) const;
+
+    /**
+     * Link a node into the slot for its expiry, generally only used internally
+     */
+    void link(u32 idx);
+
+    /**
+     * Unlink a node from its slot, generally only used internally
+     */
+    void unlink(u32 idx);
+
+    TimerWheel(TimerWheel&&) = delete;
+    TimerWheel& operator=(TimerWheel&&) = delete;
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+};
+
+} // namespace hg
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "hg/macros.hpp"
+#include "hg/inttypes.hpp"
+#include "hg/math.hpp"
+#include "hg/array.hpp"
+#include "hg/pool.hpp"
+#include "hg/ecs.hpp"
+
+namespace hg {
+
+/**
+ * A scene graph of entity transforms, propagating local transforms to world
+ * transforms
+ *
+ * Nodes are stored in arrays in breadth first order, so every parent comes
+ * before its children and each depth is a contiguous range. propagate
+ * computes the world transforms one level at a time, in parallel within a
+ * level, and only recomputes the subtrees under nodes whose local transform
+ * or parent changed. Adding, removing and reparenting nodes mark the order
+ * stale, and the next propagate rebuilds it in O(n).
+ */
+struct TransformHierarchy {
+    /**
+     * The number of nodes per parallel task in propagate
+     */
+    static constexpr u32 chunkSize = 1024;
+
+    /**
+     * The entity of each node
+     */
+    Array<Entity> entities{};
+    /**
+     * The parent entity of each node, or nullEntity for roots
+     */
+    Array<Entity> parentEntities{};
+    /**
+     * The index of each node's parent, or -1 for roots, valid when not stale
+     */
+    Array<u32> parents{};
+    /**
+     * The transform of each node relative to its parent
+     */
+    Array<Mat4> locals{};
+    /**
+     * The transform of each node in the world, as of the last propagate
+     */
+    Array<Mat4> worlds{};
+    /**
+     * Whether each node must be recomputed by the next propagate
+     */
+    Array<u8> dirty{};
+    /**
+     * The depth d nodes are [levels[d], levels[d + 1]), valid when not stale
+     */
+    Array<u32> levels{};
+    /**
+     * indices.get(e.handle.idx()) is the index of an entity's node, or -1
+     */
+    EcsSparse indices{};
+    /**
+     * Whether the order must be rebuilt before the next propagate
+     */
+    bool stale = false;
+    /**
+     * The number of nodes marked dirty since the last propagate
+     */
+    u32 dirtyCount = 0;
+
+    /**
+     * Remove all nodes
+     */
+    void reset();
+
+    /**
+     * Add a node for an entity
+     *
+     * Note, the entity must not already have a node, and the parent, if not
+     * null, should have one by the next propagate
+     *
+     * Parameters
+     * - e The entity
+     * - parent The parent entity, or nullEntity for a root
+     * - local The transform relative to the parent
+     */
+    void add(Entity e, Entity parent = nullEntity, const Mat4& local = Mat4{1.0f});
+
+    /**
+     * Returns whether an entity has a node
+     */
+    bool has(Entity e) const;
+
+    /**
+     * Remove an entity's node, its children become roots
+     *
+     * Note, the entity must have a node
+     */
+    void remove(Entity e);
+
+    /**
+     * Remove the nodes of every entity no longer alive in a pool, such as
+     * Ecs::entities after despawning
+     */
+    void removeDead(const HandlePool& pool);
+
+    /**
+     * Change the parent of an entity's node
+     *
+     * Note, parents must not form a cycle
+     *
+     * Parameters
+     * - e The entity
+     * - parent The new parent entity, or nullEntity to make a root
+     */
+    void setParent(Entity e, Entity parent);
+
+    /**
+     * Get the parent of an entity's node, or nullEntity for a root
+     */
+    Entity getParent(Entity e) const;
+
+    /**
+     * Set the transform of an entity's node relative to its parent
+     */
+    void setLocal(Entity e, const Mat4& local);
+
+    /**
+     * Set the local transform of an entity's node from a 3D model
+     */
+    void setLocal3D(Entity e, const Vec3& position, const Vec3& scale, const Quat& rotation);
+
+    /**
+     * Set the local transform of an entity's node from a 2D model
+     */
+    void setLocal2D(Entity e, Vec3 position, Vec2 scale, f32 rotation);
+
+    /**
+     * Get the transform of an entity's node relative to its parent
+     */
+    const Mat4& getLocal(Entity e) const;
+
+    /**
+     * Get the world transform of an entity's node, as of the last propagate
+     */
+    const Mat4& getWorld(Entity e) const;
+
+    /**
+     * Returns the number of levels, the depth of the deepest node plus one
+     */
+    u32 depth() const;
+
+    /**
+     * Rebuild the breadth first order, called by propagate when stale
+     */
+    void rebuild();
+
+    /**
+     * Recompute the world transforms of the dirty nodes and their subtrees
+     */
+    void propagate();
+};
+
+} // namespace hg
@@ -53,13 +53,17 @@
 #include "hg/smart_ptr.hpp"
 #include "hg/array.hpp"
 #include "hg/queue.hpp"
+#include "hg/heap.hpp"
 #include "hg/hash.hpp"
+#include "hg/atom.hpp"
 #include "hg/set.hpp"
 #include "hg/map.hpp"
+#include "hg/cache.hpp"
 #include "hg/pool.hpp"
 #include "hg/assets.hpp"
 #include "hg/serialization.hpp"
 #include "hg/time.hpp"
+#include "hg/timer.hpp"
 #include "hg/dynlib.hpp"
 #include "hg/gpu.hpp"
 #include "hg/window.hpp"
@@ -67,4 +71,5 @@
 #include "hg/render2d.hpp"
 #include "hg/imgui.hpp"
 #include "hg/ecs.hpp"
+#include "hg/transform.hpp"
 
@@ -53,7 +53,7 @@ bool binaryStore(BinaryView bin, StringView path)
     }
     HG_DEFER(fclose(fileHandle));
 
-    if (fwrite(bin.data, 1, bin.size, fileHandle) != bin.size)
+    if (bin.size > 0 && fwrite(bin.data, 1, bin.size, fileHandle) != bin.size)
     {
         setError("Failed to write binary data to file: %s", cpath);
         return false;
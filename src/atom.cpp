@@ -0,0 +1,174 @@
+#include "hg/atom.hpp"
+#include "hg/memory.hpp"
+#include "hg/array.hpp"
+#include "hg/concurrency.hpp"
+#include "hg/error.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace hg {
+
+struct AtomEntry {
+    StringView str{};
+    u64 hash = 0;
+};
+
+static constexpr u32 atomPageBits = 10;
+static constexpr u32 atomPageSize = 1 << atomPageBits;
+static constexpr u32 atomMaxPages = 4096;
+static constexpr u64 atomArenaSize = 64 * 1024;
+
+struct AtomTable {
+    // Entries are stored in fixed pages that are never moved, so atomString
+    // and atomHash can read them without taking the lock
+    std::atomic<AtomEntry*> pages[atomMaxPages] = {};
+    std::atomic<u32> count{0};
+
+    // Guards everything below and the creation of entries
+    SpinLock lock{};
+    Array<u32> slots{};
+    Array<Arena> arenas{};
+
+    AtomTable()
+    {
+        slots.resize(1024);
+        AtomEntry* page = heapAlloc<AtomEntry>(atomPageSize);
+        page[0] = {StringView{}, atomHash(StringView{})};
+        pages[0].store(page);
+        count.store(1);
+    }
+
+    const AtomEntry& entry(u32 id) const
+    {
+        return pages[id >> atomPageBits].load(std::memory_order_acquire)[id & (atomPageSize - 1)];
+    }
+
+    u32 find(StringView str, u64 strHash) const
+    {
+        u64 mask = slots.count - 1;
+        for (u64 i = strHash & mask;; i = (i + 1) & mask)
+        {
+            u32 id = slots[i];
+            if (id == 0)
+                return 0;
+
+            const AtomEntry& e = entry(id);
+            if (e.hash == strHash && e.str == str)
+                return id;
+        }
+    }
+
+    void grow()
+    {
+        Array<u32> old = std::move(slots);
+        slots = Array<u32>{};
+        slots.resize(old.count * 2);
+
+        u64 mask = slots.count - 1;
+        for (u32 id : old)
+        {
+            if (id == 0)
+                continue;
+
+            u64 i = entry(id).hash & mask;
+            while (slots[i] != 0)
+            {
+                i = (i + 1) & mask;
+            }
+            slots[i] = id;
+        }
+    }
+
+    StringView store(StringView str)
+    {
+        if (arenas.count == 0 || arenas[arenas.count - 1].head + str.length > arenas[arenas.count - 1].capacity)
+            arenas.push(Arena{std::max(atomArenaSize, str.length)});
+
+        char* chars = arenas[arenas.count - 1].alloc<char>(str.length);
+        memcpy(chars, str.chars, str.length);
+        return {chars, str.length};
+    }
+
+    u32 insert(StringView str, u64 strHash)
+    {
+        u32 id = count.load(std::memory_order_relaxed);
+        if ((id >> atomPageBits) >= atomMaxPages)
+            HG_PANIC("Atom table is full");
+
+        if ((static_cast<u64>(id) + 1) * 4 > slots.count * 3)
+            grow();
+
+        std::atomic<AtomEntry*>& page = pages[id >> atomPageBits];
+        if (page.load(std::memory_order_relaxed) == nullptr)
+            page.store(heapAlloc<AtomEntry>(atomPageSize), std::memory_order_release);
+
+        page.load(std::memory_order_relaxed)[id & (atomPageSize - 1)] = {store(str), strHash};
+        count.store(id + 1, std::memory_order_release);
+
+        u64 mask = slots.count - 1;
+        u64 i = strHash & mask;
+        while (slots[i] != 0)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+        return id;
+    }
+};
+
+static AtomTable& atomTable()
+{
+    static AtomTable table{};
+    return table;
+}
+
+Atom atom(StringView str)
+{
+    return atom(str, atomHash(str));
+}
+
+Atom atom(StringView str, u64 strHash)
+{
+    HG_ASSERT(strHash == atomHash(str));
+    if (str.length == 0)
+        return nullAtom;
+
+    AtomTable& table = atomTable();
+    SpinLockScope lock{&table.lock};
+
+    u32 id = table.find(str, strHash);
+    if (id == 0)
+        id = table.insert(str, strHash);
+    return {id};
+}
+
+Atom atomFind(StringView str)
+{
+    if (str.length == 0)
+        return nullAtom;
+
+    AtomTable& table = atomTable();
+    SpinLockScope lock{&table.lock};
+    return {table.find(str, atomHash(str))};
+}
+
+StringView atomString(Atom atom)
+{
+    HG_ASSERT(atom.id < atomCount());
+    return atomTable().entry(atom.id).str;
+}
+
+u64 atomHash(Atom atom)
+{
+    HG_ASSERT(atom.id < atomCount());
+    return atomTable().entry(atom.id).hash;
+}
+
+u32 atomCount()
+{
+    return atomTable().count.load(std::memory_order_acquire);
+}
+
+} // namespace hg
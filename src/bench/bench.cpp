@@ -0,0 +1,89 @@
+#include "bench.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+bool benchSelected(StringView title)
+{
+    if (benchFilter.length == 0)
+        return true;
+    if (benchFilter.length > title.length)
+        return false;
+
+    for (u64 i = 0; i + benchFilter.length <= title.length; ++i)
+    {
+        if (memcmp(title.chars + i, benchFilter.chars, benchFilter.length) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool benchWriteCsv(StringView path)
+{
+    ArenaScope scratch = getScratch();
+
+    FILE* file = fopen(cString(scratch, path), "wb");
+    if (file == nullptr)
+        return false;
+    HG_DEFER(fclose(file));
+
+    fprintf(file, "title,iterations,avg_ns,best_ns,worst_ns\n");
+    for (const BenchResult& result : benchResults)
+    {
+        // Titles may hold commas but never quotes
+        StringView title = result.title;
+        fprintf(file, "\"%.*s\",%u,%.1f,%.1f,%.1f\n", static_cast<int>(title.length), title.chars,
+            result.iterations, result.stats.avg * 1.e9, result.stats.best * 1.e9, result.stats.worst * 1.e9);
+    }
+    return true;
+}
+
+/**
+ * Usage: hg_bench [--filter <text>] [--csv <path>]
+ *
+ * --filter runs only the benchmarks whose title contains the text, such as
+ * "Ecs scale", and --csv writes the results of the run to a file, so a
+ * script can compare them against a baseline.
+ */
+int main(int argc, char** argv)
+{
+    StringView csv{};
+    for (int i = 1; i < argc; ++i)
+    {
+        StringView arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc)
+        {
+            benchFilter = argv[++i];
+        }
+        else if (arg == "--csv" && i + 1 < argc)
+        {
+            csv = argv[++i];
+        }
+        else
+        {
+            std::printf("Usage: hg_bench [--filter <text>] [--csv <path>]\n");
+            return 1;
+        }
+    }
+
+    std::printf("HurdyGurdy: Benchmarks begun\n");
+
+    Clock timer{};
+
+    benchHeap();
+    benchStrings();
+    benchEcs();
+    benchTransform();
+
+    std::printf("HurdyGurdy: All benchmarks finished in %fms\n", timer.tick() * 1000.0f);
+
+    if (csv.length > 0)
+    {
+        if (!benchWriteCsv(csv))
+        {
+            std::printf("HurdyGurdy: Could not write results to %.*s\n", static_cast<int>(csv.length), csv.chars);
+            return 1;
+        }
+        std::printf("HurdyGurdy: Results written to %.*s\n", static_cast<int>(csv.length), csv.chars);
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#undef HG_NO_LOGGING
+#define HG_LOGGING 1
+#include "hg/macros.hpp"
+#include "hg/inttypes.hpp"
+#include "hg/strings.hpp"
+#include "hg/memory.hpp"
+#include "hg/array.hpp"
+#include "hg/time.hpp"
+
+using namespace hg;
+
+/**
+ * Written to by benchmarks so the optimizer cannot remove the measured work
+ */
+inline volatile u64 benchSink = 0;
+
+/**
+ * The statistics of one benchmark, for the machine readable results
+ */
+struct BenchResult {
+    /**
+     * The name the benchmark was logged under
+     */
+    String title{};
+    /**
+     * The number of timed runs
+     */
+    u32 iterations = 0;
+    /**
+     * The statistics of all runs
+     */
+    PerfStats stats{};
+};
+
+/**
+ * Every benchmark run so far, in order
+ */
+inline Array<BenchResult> benchResults{};
+
+/**
+ * Only benchmarks whose title contains this are run, all if empty
+ */
+inline StringView benchFilter{};
+
+/**
+ * Returns whether a benchmark passes benchFilter
+ */
+bool benchSelected(StringView title);
+
+/**
+ * Write benchResults as CSV, one line per benchmark with the times in
+ * nanoseconds
+ *
+ * Returns
+ * - Whether the file was written
+ */
+bool benchWriteCsv(StringView path);
+
+/**
+ * Runs a function repeatedly, timing each run but not the setup before it,
+ * and logs and records the statistics, unless filtered out by benchFilter
+ *
+ * Parameters
+ * - title The name to log the results under
+ * - iterations The number of timed runs
+ * - setup The untimed work before each run
+ * - fn The work to measure
+ *
+ * Returns
+ * - The statistics of all runs
+ */
+template<typename S, typename F>
+PerfStats bench(StringView title, u32 iterations, S setup, F fn)
+{
+    if (!benchSelected(title))
+        return {};
+
+    ArenaScope scratch = getScratch();
+
+    Perf perf = perfCreate(scratch, iterations);
+    for (u32 i = 0; i < iterations; ++i)
+    {
+        setup();
+        perfBegin(&perf);
+        fn();
+        perfEnd(&perf);
+    }
+
+    PerfStats stats = perfAnalyze(&perf);
+    perfLog(title, &stats, PerfScale_micro);
+    benchResults.push({String::create(title), iterations, stats});
+    return stats;
+}
+
+/**
+ * Runs a function repeatedly, timing each run, and logs and records the
+ * statistics, unless filtered out by benchFilter
+ *
+ * Parameters
+ * - title The name to log the results under
+ * - iterations The number of timed runs
+ * - fn The work to measure
+ *
+ * Returns
+ * - The statistics of all runs
+ */
+template<typename F>
+PerfStats bench(StringView title, u32 iterations, F fn)
+{
+    return bench(title, iterations, []{}, fn);
+}
+
+void benchHeap();
+void benchStrings();
+void benchEcs();
+void benchTransform();
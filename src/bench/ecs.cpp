@@ -0,0 +1,933 @@
+#include "bench.hpp"
+#include "hg/noise.hpp"
+#include "hg/ecs.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+struct Position {
+    f32 x, y, z;
+};
+
+struct Velocity {
+    f32 x, y, z;
+};
+
+struct Health {
+    f32 val;
+};
+
+struct Burning {
+    f32 time;
+};
+
+template<>
+constexpr bool hg::ecsSerializeBulk<Position> = true;
+
+template<>
+constexpr bool hg::ecsSerializeBulk<Velocity> = true;
+
+template<>
+constexpr bool hg::ecsSerializeBulk<Health> = true;
+
+template<>
+constexpr bool hg::ecsSerializeBulk<Burning> = true;
+
+template<typename T>
+struct PerComponent {
+    T val;
+};
+
+template<u32 N>
+struct Tag {
+    u32 val;
+};
+
+template<u32 N>
+constexpr bool hg::ecsSerializeBulk<Tag<N>> = true;
+
+struct Marked {};
+
+struct MarkedByte {
+    u8 on;
+};
+
+using SparseWorld = Ecs<Position, Velocity, Health, Burning>;
+using ArchetypeWorld = EcsArchetype<Position, Velocity, Health, Burning>;
+
+template<template<typename...> typename Storage>
+using ScaleWorld = Storage<Position, Velocity, Health, Burning, Tag<0>, Tag<1>, Tag<2>, Tag<3>>;
+
+template<typename World>
+static void populate(World& world, u32 n)
+{
+    Rng rng{1234};
+    for (u32 i = 0; i < n; ++i)
+    {
+        Entity e = world.spawn();
+        world.template add<Position>(e, Position{(f32)i, 0.0f, 0.0f});
+        if (rng.next() % 4 != 0)
+            world.template add<Velocity>(e, Velocity{1.0f, 2.0f, 3.0f});
+        if (rng.next() % 2 == 0)
+            world.template add<Health>(e, Health{100.0f});
+    }
+}
+
+template<typename World>
+static void benchWorld(StringView name, u32 n, bool grouped)
+{
+    static constexpr u32 iterations = 16;
+
+    ArenaScope scratch = getScratch();
+    auto title = [&](StringView op)
+    {
+        StringBuilder str{scratch, name};
+        str.append(" ");
+        str.append(op);
+        return StringView{str};
+    };
+
+    bench(title("populate 500k"), 4, [&]
+    {
+        World world{};
+        if (grouped)
+            world.template group<Position, Velocity>();
+        populate(world, n);
+        benchSink = world.template count<Position>();
+    });
+
+    World world{};
+    if (grouped)
+        world.template group<Position, Velocity>();
+    populate(world, n);
+
+    bench(title("forEach Position/Velocity"), iterations, [&]
+    {
+        world.template forEach<Position, Velocity>([](Position& p, Velocity& v)
+        {
+            p.x += v.x * 0.016f;
+            p.y += v.y * 0.016f;
+            p.z += v.z * 0.016f;
+        });
+    });
+
+    bench(title("forEachChunk Position/Velocity"), iterations, [&]
+    {
+        world.template forEachChunk<Position, Velocity>([](Span<const Entity> es, Span<Position> ps, Span<Velocity> vs)
+        {
+            Position* p = ps.data;
+            const Velocity* v = vs.data;
+            for (u64 i = 0; i < es.count; ++i)
+            {
+                p[i].x += v[i].x * 0.016f;
+                p[i].y += v[i].y * 0.016f;
+                p[i].z += v[i].z * 0.016f;
+            }
+        });
+    });
+
+    bench(title("forEach Position/Velocity/Health"), iterations, [&]
+    {
+        f32 sum = 0.0f;
+        world.template forEach<Position, Velocity, Health>([&](Position& p, Velocity& v, Health& h)
+        {
+            p.x += v.x * 0.016f;
+            p.y += v.y * 0.016f;
+            p.z += v.z * 0.016f;
+            sum += h.val;
+        });
+        benchSink = (u64)sum;
+    });
+
+    bench(title("get Position 500k"), iterations, [&]
+    {
+        f32 sum = 0.0f;
+        for (u32 i = 0; i < n; ++i)
+            sum += world.template get<Position>(Entity{Handle{i}}).x;
+        benchSink = (u64)sum;
+    });
+
+    bench(title("add/remove Burning 50k"), iterations, [&]
+    {
+        for (u32 i = 0; i < n; i += 10)
+            world.template add<Burning>(Entity{Handle{i}}, Burning{1.0f});
+        for (u32 i = 0; i < n; i += 10)
+            world.template remove<Burning>(Entity{Handle{i}});
+    });
+}
+
+/**
+ * Spawns n entities with Position, most with Velocity and Health, spread over
+ * frag combinations of the tags, up to 16
+ */
+template<typename World>
+static void populateFragmented(World& world, u32 n, u32 frag)
+{
+    Rng rng{77};
+    for (u32 i = 0; i < n; ++i)
+    {
+        Entity e = world.spawn();
+        world.template add<Position>(e, Position{(f32)i, 0.0f, 0.0f});
+        if (rng.next() % 4 != 0)
+            world.template add<Velocity>(e, Velocity{1.0f, 2.0f, 3.0f});
+        if (rng.next() % 2 == 0)
+            world.template add<Health>(e, Health{100.0f});
+
+        u32 tags = i % frag;
+        if ((tags & 1) != 0)
+            world.template add<Tag<0>>(e, Tag<0>{i});
+        if ((tags & 2) != 0)
+            world.template add<Tag<1>>(e, Tag<1>{i});
+        if ((tags & 4) != 0)
+            world.template add<Tag<2>>(e, Tag<2>{i});
+        if ((tags & 8) != 0)
+            world.template add<Tag<3>>(e, Tag<3>{i});
+    }
+}
+
+/**
+ * The scaling suite for one storage, entity count and fragmentation
+ *
+ * Titles are "<name> scale <op> n=<n> frag=<frag>", so a run can be filtered
+ * to the suite and its results compared by title.
+ */
+template<template<typename...> typename Storage>
+static void benchScale(StringView name, u32 n, u32 frag)
+{
+    using World = ScaleWorld<Storage>;
+    u32 iterations = n >= 100000 ? 8 : 32;
+
+    ArenaScope scratch = getScratch();
+    auto title = [&](StringView op)
+    {
+        StringBuilder str{scratch, name};
+        str.append(" scale ");
+        str.append(op);
+        str.append(" n=");
+        str.append(integerToString(scratch, n));
+        str.append(" frag=");
+        str.append(integerToString(scratch, frag));
+        return StringView{str};
+    };
+
+    // The world is only built if some benchmark in the suite will run
+    static constexpr StringView ops[] = {
+        "populate",
+        "forEach Position/Velocity",
+        "forEach Position/Velocity/Health",
+        "forEachPar Position/Velocity",
+        "forEachChunkPar Position/Velocity",
+        "add/remove Burning 10%",
+        "despawn all",
+        "save",
+        "load",
+    };
+    bool selected = false;
+    for (StringView op : ops)
+        selected = selected || benchSelected(title(op));
+    if (!selected)
+        return;
+
+    World world{};
+    populateFragmented(world, n, frag);
+
+    bench(title("populate"), 4, [&]
+    {
+        World w{};
+        populateFragmented(w, n, frag);
+    });
+
+    bench(title("forEach Position/Velocity"), iterations, [&]
+    {
+        world.template forEach<Position, Velocity>([](Position& p, Velocity& v)
+        {
+            p.x += v.x * 0.016f;
+            p.y += v.y * 0.016f;
+            p.z += v.z * 0.016f;
+        });
+    });
+
+    bench(title("forEach Position/Velocity/Health"), iterations, [&]
+    {
+        f32 sum = 0.0f;
+        world.template forEach<Position, Velocity, Health>([&](Position& p, Velocity& v, Health& h)
+        {
+            p.x += v.x * 0.016f;
+            sum += h.val;
+        });
+        benchSink = (u64)sum;
+    });
+
+    bench(title("forEachPar Position/Velocity"), iterations, [&]
+    {
+        world.template forEachPar<Position, Velocity>([](Position& p, Velocity& v)
+        {
+            p.x += v.x * 0.016f;
+            p.y += v.y * 0.016f;
+            p.z += v.z * 0.016f;
+        });
+    });
+
+    bench(title("forEachChunkPar Position/Velocity"), iterations, [&]
+    {
+        world.template forEachChunkPar<Position, Velocity>([](Span<const Entity> es, Span<Position> ps, Span<Velocity> vs)
+        {
+            Position* p = ps.data;
+            const Velocity* v = vs.data;
+            for (u64 i = 0; i < es.count; ++i)
+            {
+                p[i].x += v[i].x * 0.016f;
+                p[i].y += v[i].y * 0.016f;
+                p[i].z += v[i].z * 0.016f;
+            }
+        });
+    });
+
+    bench(title("add/remove Burning 10%"), iterations, [&]
+    {
+        for (u32 i = 0; i < n; i += 10)
+            world.template add<Burning>(Entity{Handle{i}}, Burning{1.0f});
+        for (u32 i = 0; i < n; i += 10)
+            world.template remove<Burning>(Entity{Handle{i}});
+    });
+
+    World despawned{};
+    bench(title("despawn all"), 4, [&]
+    {
+        despawned.reset();
+        populateFragmented(despawned, n, frag);
+    }, [&]
+    {
+        for (u32 i = 0; i < n; ++i)
+            despawned.despawn(Entity{Handle{i}});
+    });
+
+    BinaryView bin{};
+    bench(title("save"), iterations, [&]
+    {
+        ArenaScope arena = getScratch(&scratch.arena, 1);
+        Serializer w = serialWriter(arena);
+        serialize(&w, &world);
+        bin = writeSerialBinary(arena, &w);
+        benchSink = bin.size;
+    });
+
+    if (!benchSelected(title("load")))
+        return;
+
+    Arena saved{(u64)1 << 28};
+    {
+        Serializer w = serialWriter(&saved);
+        serialize(&w, &world);
+        bin = writeSerialBinary(&saved, &w);
+    }
+    bench(title("load"), iterations, [&]
+    {
+        ArenaScope arena = getScratch(&scratch.arena, 1);
+        Serializer r = readSerialBinary(arena, bin);
+        World copy{};
+        serialize(&r, &copy);
+    });
+}
+
+void benchEcs()
+{
+    // ============================================================================
+    // Ecs storage
+    // ============================================================================
+    //
+    // Sparse set storage (Ecs), with and without an owning group over
+    // Position and Velocity, against archetype storage (EcsArchetype) over
+    // 500k entities with a mix of component sets: population, multi-component
+    // queries, random access and structural changes.
+
+    static constexpr u32 n = 500000;
+
+    benchWorld<SparseWorld>("Ecs", n, false);
+    benchWorld<SparseWorld>("Ecs grouped", n, true);
+    benchWorld<ArchetypeWorld>("EcsArchetype", n, false);
+
+    // ============================================================================
+    // Command buffers
+    // ============================================================================
+    //
+    // The add/remove Burning pass above, recorded into per-task command
+    // buffers in parallel and played back in bulk.
+
+    {
+        static constexpr u32 iterations = 16;
+        static constexpr u32 tasks = 16;
+
+        SparseWorld world{};
+        populate(world, n);
+
+        Array<EcsCommands<Position, Velocity, Health, Burning>> buffers{};
+        for (u32 i = 0; i < tasks; ++i)
+            buffers.push({&world});
+
+        bench("Ecs commands add/remove Burning 50k", iterations, [&]
+        {
+            forPar(0, tasks, [&](u64 t)
+            {
+                for (u64 i = t * 10; i < n; i += tasks * 10)
+                    buffers[t].add<Burning>(Entity{Handle{(u32)i}}, Burning{1.0f});
+            });
+            world.playCommands(buffers);
+            forPar(0, tasks, [&](u64 t)
+            {
+                for (u64 i = t * 10; i < n; i += tasks * 10)
+                    buffers[t].remove<Burning>(Entity{Handle{(u32)i}});
+            });
+            world.playCommands(buffers);
+        });
+    }
+
+    // ============================================================================
+    // Change detection
+    // ============================================================================
+    //
+    // A steady state frame where 1% of the positions move: a system that
+    // recomputes from every position, against one that only visits the
+    // changed ones. The tick scan costs 4 bytes per component.
+
+    {
+        static constexpr u32 iterations = 16;
+
+        SparseWorld world{};
+        world.track<Position>();
+        populate(world, n);
+        u32 seen = world.advanceTick();
+
+        // Rebuilding a rotation from the position, as a render instance would
+        auto work = [](const Position& p)
+        {
+            f32 s = std::sin(p.x);
+            f32 c = std::cos(p.x);
+            return s * p.y + c * p.z + std::sqrt(p.x * p.x + 1.0f);
+        };
+
+        bench("Ecs forEach all 500k", iterations, [&]
+        {
+            for (u32 i = 0; i < n; i += 100)
+                world.get<Position>(Entity{Handle{i}}).x += 1.0f;
+            f32 sum = 0.0f;
+            world.forEach<Position>([&](Position& p) { sum += work(p); });
+            benchSink = (u64)sum;
+        });
+
+        bench("Ecs forEachChanged 1% of 500k", iterations, [&]
+        {
+            for (u32 i = 0; i < n; i += 100)
+                world.get<Position>(Entity{Handle{i}}).x += 1.0f;
+            f32 sum = 0.0f;
+            world.forEachChanged<Position>(seen, [&](Position& p) { sum += work(p); });
+            seen = world.advanceTick();
+            benchSink = (u64)sum;
+        });
+    }
+
+    // ============================================================================
+    // Sorting
+    // ============================================================================
+    //
+    // Churn scrambles the packed arrays through removeSwap, so a query over
+    // Position and Velocity looks up Position in random order. Sorting
+    // Velocity by entity and Position to match makes both walks sequential.
+
+    {
+        static constexpr u32 iterations = 16;
+
+        SparseWorld world{};
+        populate(world, n);
+        Rng rng{5678};
+        for (u32 i = 0; i < n; ++i)
+        {
+            Entity e = Entity{Handle{rng.next() % n}};
+            if (world.has<Velocity>(e))
+            {
+                world.remove<Velocity>(e);
+                world.add<Velocity>(e, Velocity{1.0f, 2.0f, 3.0f});
+            }
+            Position p = world.get<Position>(e);
+            world.remove<Position>(e);
+            world.add<Position>(e, p);
+        }
+
+        auto query = [&]
+        {
+            world.forEach<Position, Velocity>([](Position& p, Velocity& v)
+            {
+                p.x += v.x * 0.016f;
+                p.y += v.y * 0.016f;
+                p.z += v.z * 0.016f;
+            });
+        };
+
+        bench("Ecs forEach Position/Velocity churned", iterations, query);
+
+        bench("Ecs sort Velocity by entity, Position to match", iterations, [&]
+        {
+            world.sort<Velocity>();
+            world.sortToMatch<Position, Velocity>();
+        });
+
+        bench("Ecs forEach Position/Velocity sorted", iterations, query);
+    }
+
+    // ============================================================================
+    // Sparse index memory
+    // ============================================================================
+    //
+    // The paged sparse indices against the flat array they replaced, which
+    // cost 4 bytes per entity slot up to the highest index holding the type.
+    // Every entity has Position, and the other types are rare, held by a few
+    // entities near the end of the index range.
+
+    {
+        SparseWorld world{};
+        Rng rng{1234};
+        for (u32 i = 0; i < 1000000; ++i)
+        {
+            Entity e = world.spawn();
+            world.add<Position>(e, Position{(f32)i, 0.0f, 0.0f});
+            if (i >= 999000 && rng.next() % 64 == 0)
+                world.add<Velocity>(e);
+            if (i >= 990000 && rng.next() % 256 == 0)
+                world.add<Health>(e);
+            if (i == 999999)
+                world.add<Burning>(e);
+        }
+
+        u64 paged = 0;
+        u64 flat = 0;
+        world.systems.forEach([&](auto& sys)
+        {
+            u32 maxIdx = 0;
+            for (Entity e : sys.entities)
+                maxIdx = std::max(maxIdx, e.handle.idx());
+            paged += sys.indices.memoryUsage();
+            flat += (maxIdx + 1) * sizeof(u32);
+        });
+        std::printf("HG Memory - Ecs sparse indices 1M entities: paged: %lluKB, flat: %lluKB\n",
+            static_cast<unsigned long long>(paged / 1024), static_cast<unsigned long long>(flat / 1024));
+    }
+
+    // ============================================================================
+    // System scheduler
+    // ============================================================================
+    //
+    // Four systems that each write a different component, run one after
+    // another against the scheduler, which runs them on separate threads
+    // since their write sets do not overlap.
+
+    {
+        static constexpr u32 iterations = 16;
+
+        SparseWorld world{};
+        for (u32 i = 0; i < n; ++i)
+        {
+            Entity e = world.spawn();
+            world.add<Position>(e, Position{(f32)i, 0.0f, 0.0f});
+            world.add<Velocity>(e, Velocity{1.0f, 0.0f, 0.0f});
+            world.add<Health>(e, Health{100.0f});
+            world.add<Burning>(e, Burning{0.0f});
+        }
+
+        void (*systems[])(SparseWorld*, void*) = {
+            [](SparseWorld* w, void*) { w->forEach<Position>([](Position& p) { p.x = std::sqrt(p.x * p.x + 1.0f); }); },
+            [](SparseWorld* w, void*) { w->forEach<Velocity>([](Velocity& v) { v.y = std::sin(v.x + v.y); }); },
+            [](SparseWorld* w, void*) { w->forEach<Health>([](Health& h) { h.val = std::sqrt(h.val + 1.0f); }); },
+            [](SparseWorld* w, void*) { w->forEach<Burning>([](Burning& b) { b.time = std::cos(b.time); }); },
+        };
+
+        bench("systems sequential 4x500k", iterations, [&]
+        {
+            for (auto system : systems)
+                system(&world, nullptr);
+        });
+
+        world.addSystem<EcsReads<>, EcsWrites<Position>>("position", systems[0]);
+        world.addSystem<EcsReads<>, EcsWrites<Velocity>>("velocity", systems[1]);
+        world.addSystem<EcsReads<>, EcsWrites<Health>>("health", systems[2]);
+        world.addSystem<EcsReads<>, EcsWrites<Burning>>("burning", systems[3]);
+
+        bench("systems scheduled 4x500k", iterations, [&]
+        {
+            world.runSystems();
+        });
+        world.scheduler.log();
+    }
+
+    // ============================================================================
+    // Mass despawn
+    // ============================================================================
+    //
+    // Despawning 100k entities, each with 3 of 16 component types, one at a
+    // time and as a batch, and a three type hasAll over every entity.
+
+    {
+        static constexpr u32 count = 100000;
+        static constexpr u32 iterations = 8;
+        using TagWorld = Ecs<Tag<0>, Tag<1>, Tag<2>, Tag<3>, Tag<4>, Tag<5>, Tag<6>, Tag<7>,
+            Tag<8>, Tag<9>, Tag<10>, Tag<11>, Tag<12>, Tag<13>, Tag<14>, Tag<15>>;
+
+        Array<Entity> es{};
+        auto populateTags = [&](TagWorld& world)
+        {
+            es.reset();
+            for (u32 i = 0; i < count; ++i)
+            {
+                Entity e = world.spawn();
+                es.push(e);
+                world.add<Tag<0>>(e, {i});
+                if (i % 2 == 0)
+                    world.add<Tag<5>>(e, {i});
+                else
+                    world.add<Tag<9>>(e, {i});
+                world.add<Tag<15>>(e, {i});
+            }
+        };
+
+        TagWorld world{};
+        populateTags(world);
+        bench("Ecs hasAll 3 types 100k", iterations, [&]
+        {
+            u32 found = 0;
+            for (Entity e : es)
+                found += world.hasAll<Tag<0>, Tag<5>, Tag<15>>(e);
+            benchSink = found;
+        });
+
+        bench("Ecs despawn 16 types 100k", iterations, [&]
+        {
+            TagWorld w{};
+            populateTags(w);
+            for (Entity e : es)
+                w.despawn(e);
+        });
+
+        bench("Ecs despawnMany 16 types 100k", iterations, [&]
+        {
+            TagWorld w{};
+            populateTags(w);
+            w.despawnMany(es);
+        });
+
+        bench("Ecs populate only 16 types 100k", iterations, [&]
+        {
+            TagWorld w{};
+            populateTags(w);
+        });
+    }
+
+    // ============================================================================
+    // Batch spawning
+    // ============================================================================
+    //
+    // A burst of 50k particles with Position, Velocity and Health into a
+    // fresh world, spawned one at a time against instantiating a prefab.
+
+    {
+        static constexpr u32 count = 50000;
+        static constexpr u32 iterations = 16;
+
+        bench("Ecs spawn and add 3 50k", iterations, [&]
+        {
+            SparseWorld world{};
+            for (u32 i = 0; i < count; ++i)
+            {
+                Entity e = world.spawn();
+                world.add<Position>(e, Position{0.0f, 0.0f, 0.0f});
+                world.add<Velocity>(e, Velocity{1.0f, 2.0f, 3.0f});
+                world.add<Health>(e, Health{100.0f});
+            }
+        });
+
+        EcsPrefab<Position, Velocity, Health, Burning> particle{};
+        particle.set<Position>(Position{0.0f, 0.0f, 0.0f});
+        particle.set<Velocity>(Velocity{1.0f, 2.0f, 3.0f});
+        particle.set<Health>(Health{100.0f});
+        Array<Entity> es{};
+        es.resize(count);
+
+        bench("Ecs instantiate 3 50k", iterations, [&]
+        {
+            SparseWorld world{};
+            world.instantiate(particle, es);
+        });
+
+        bench("EcsArchetype spawn and add 3 50k", iterations, [&]
+        {
+            ArchetypeWorld world{};
+            for (u32 i = 0; i < count; ++i)
+            {
+                Entity e = world.spawn();
+                world.add<Position>(e, Position{0.0f, 0.0f, 0.0f});
+                world.add<Velocity>(e, Velocity{1.0f, 2.0f, 3.0f});
+                world.add<Health>(e, Health{100.0f});
+            }
+        });
+
+        bench("EcsArchetype instantiate 3 50k", iterations, [&]
+        {
+            ArchetypeWorld world{};
+            world.instantiate(particle, es);
+        });
+    }
+
+    // ============================================================================
+    // Tags
+    // ============================================================================
+    //
+    // Marking and unmarking every other one of 100k entities, with an empty
+    // tag against a one byte component, then a query of the marked entities.
+
+    {
+        static constexpr u32 count = 100000;
+        static constexpr u32 iterations = 16;
+
+        auto mark = [&]<typename T>(StringView title)
+        {
+            Ecs<Position, T> world{};
+            Array<Entity> es{};
+            es.resize(count);
+            world.spawnMany(es);
+            bench(title, iterations, [&]
+            {
+                for (u32 i = 0; i < count; i += 2)
+                    world.template add<T>(es[i]);
+                for (u32 i = 0; i < count; i += 4)
+                    world.template remove<T>(es[i]);
+                benchSink = benchSink + world.template getEntities<T>().count;
+                for (u32 i = 2; i < count; i += 4)
+                    world.template remove<T>(es[i]);
+            });
+        };
+        mark.template operator()<MarkedByte>("Ecs mark 1 byte component 100k");
+        mark.template operator()<Marked>("Ecs mark tag 100k");
+    }
+
+    // ============================================================================
+    // Merging
+    // ============================================================================
+    //
+    // A streamed level of 50k entities with Position, Velocity and Health,
+    // built in a detached world and moved into the live world, one entity at
+    // a time against merging. Building the level alone is the baseline.
+
+    {
+        static constexpr u32 count = 50000;
+        static constexpr u32 iterations = 16;
+
+        EcsPrefab<Position, Velocity, Health, Burning> particle{};
+        particle.set<Position>(Position{0.0f, 0.0f, 0.0f});
+        particle.set<Velocity>(Velocity{1.0f, 2.0f, 3.0f});
+        particle.set<Health>(Health{100.0f});
+        Array<Entity> es{};
+        es.resize(count);
+
+        bench("Ecs build level only 50k", iterations, [&]
+        {
+            SparseWorld level{};
+            level.instantiate(particle, es);
+        });
+
+        bench("Ecs build and copy level 50k", iterations, [&]
+        {
+            SparseWorld level{};
+            level.instantiate(particle, es);
+            SparseWorld live{};
+            const SparseWorld& view = level;
+            view.forEach<Position, Velocity, Health>([&](const Position& p, const Velocity& v, const Health& h)
+            {
+                Entity e = live.spawn();
+                live.add<Position>(e, p);
+                live.add<Velocity>(e, v);
+                live.add<Health>(e, h);
+            });
+        });
+
+        bench("Ecs build and merge level 50k", iterations, [&]
+        {
+            SparseWorld level{};
+            level.instantiate(particle, es);
+            SparseWorld live{};
+            live.merge(level);
+        });
+    }
+
+    // ============================================================================
+    // Snapshots
+    // ============================================================================
+    //
+    // A ring of 16 snapshots of 50k entities, where a tenth of the entities
+    // move each tick: taking a snapshot, restoring the newest, and rolling
+    // back 8 ticks.
+
+    {
+        static constexpr u32 count = 50000;
+        static constexpr u32 iterations = 16;
+        static constexpr u32 ticks = 16;
+
+        SparseWorld world{};
+        populate(world, count);
+        Rng rng{5};
+        auto tick = [&]
+        {
+            for (u32 i = 0; i < count / 10; ++i)
+                world.get<Position>(Entity{Handle{rng.next() % count}}).x += 1.0f;
+        };
+
+        EcsSnapshots<Position, Velocity, Health, Burning> snapshots{ticks};
+        bench("Ecs snapshot 50k", iterations, [&]
+        {
+            tick();
+            snapshots.snapshot(world);
+        });
+
+        u64 deltaBytes = 0;
+        for (const Array<u64>& delta : snapshots.deltas)
+            deltaBytes += delta.count * sizeof(u64);
+        std::printf("HG Memory - Ecs snapshots 50k: frame: %lluKB, %u deltas: %lluKB\n",
+            static_cast<unsigned long long>(snapshots.latest.count * sizeof(u64) / 1024),
+            ticks - 1, static_cast<unsigned long long>(deltaBytes / 1024));
+
+        bench("Ecs restore newest 50k", iterations, [&]
+        {
+            snapshots.restore(world);
+        });
+
+        // The ring is refilled between rollbacks, outside the timing
+        ArenaScope scratch = getScratch();
+        Perf perf = perfCreate(scratch, iterations);
+        for (u32 i = 0; i < iterations; ++i)
+        {
+            while (snapshots.count < ticks)
+            {
+                tick();
+                snapshots.snapshot(world);
+            }
+            perfBegin(&perf);
+            snapshots.restore(world, 8);
+            perfEnd(&perf);
+        }
+        PerfStats stats = perfAnalyze(&perf);
+        perfLog("Ecs restore 8 back 50k", &stats, PerfScale_micro);
+    }
+
+    // ============================================================================
+    // Serialization
+    // ============================================================================
+    //
+    // Saving and loading 200k entities to the binary format, with the
+    // components written as one blob per type, against the same data wrapped
+    // to be written one component at a time.
+
+    auto benchSerialize = [&]<typename World, template<typename> typename Wrap>(StringView name)
+    {
+        static constexpr u32 count = 200000;
+        static constexpr u32 iterations = 8;
+
+        World world{};
+        Rng rng{99};
+        for (u32 i = 0; i < count; ++i)
+        {
+            Entity e = world.spawn();
+            world.template add<Wrap<Position>>(e, {Position{(f32)i, 0.0f, 0.0f}});
+            world.template add<Wrap<Velocity>>(e, {Velocity{1.0f, 2.0f, 3.0f}});
+            if (rng.next() % 2 == 0)
+                world.template add<Wrap<Health>>(e, {Health{100.0f}});
+        }
+
+        ArenaScope scratch = getScratch();
+        auto title = [&](StringView op)
+        {
+            StringBuilder str{scratch, name};
+            str.append(op);
+            return StringView{str};
+        };
+
+        BinaryView bin{};
+        bench(title(" save 200k"), iterations, [&]
+        {
+            ArenaScope arena = getScratch(&scratch.arena, 1);
+            Serializer w = serialWriter(arena);
+            serialize(&w, &world);
+            bin = writeSerialBinary(arena, &w);
+        });
+
+        Arena saved{(u64)1 << 28};
+        {
+            Serializer w = serialWriter(&saved);
+            serialize(&w, &world);
+            bin = writeSerialBinary(&saved, &w);
+        }
+        std::printf("HG Serialization - %.*s 200k: %lluKB\n", (int)name.length, name.chars,
+            static_cast<unsigned long long>(bin.size / 1024));
+
+        // Streaming skips the node tree, so only the output is allocated
+        bench(title(" stream save 200k"), iterations, [&]
+        {
+            ArenaScope arena = getScratch(&scratch.arena, 1);
+            SerialStream stream{};
+            BinaryBuilder streamed{arena};
+            Serializer w = serialStreamWriter(&stream, &streamed);
+            serialize(&w, &world);
+            serialStreamEnd(&stream);
+            benchSink = streamed.size;
+        });
+
+        {
+            Arena streamedArena{(u64)1 << 28};
+            SerialStream stream{};
+            BinaryBuilder streamed{&streamedArena};
+            Serializer w = serialStreamWriter(&stream, &streamed);
+            serialize(&w, &world);
+            serialStreamEnd(&stream);
+            std::printf("HG Serialization - %.*s 200k arena used: tree %lluKB, stream %lluKB\n",
+                (int)name.length, name.chars,
+                static_cast<unsigned long long>(saved.head / 1024),
+                static_cast<unsigned long long>(streamedArena.head / 1024));
+        }
+
+        bench(title(" load 200k"), iterations, [&]
+        {
+            ArenaScope arena = getScratch(&scratch.arena, 1);
+            Serializer r = readSerialBinary(arena, bin);
+            World copy{};
+            serialize(&r, &copy);
+        });
+
+        // Reading in place skips rebuilding the node tree
+        bench(title(" in place load 200k"), iterations, [&]
+        {
+            SerialBinReader reader{};
+            Serializer r = serialBinReader(&reader, serialBinRoot(bin));
+            World copy{};
+            serialize(&r, &copy);
+        });
+    };
+
+    benchSerialize.template operator()<SparseWorld, std::type_identity_t>("Ecs bulk");
+    benchSerialize.template operator()<Ecs<PerComponent<Position>, PerComponent<Velocity>, PerComponent<Health>>,
+        PerComponent>("Ecs per component");
+
+    // ============================================================================
+    // Scaling
+    // ============================================================================
+    //
+    // The core operations at 1k, 10k and 100k entities, spread over 1, 4 and
+    // 16 component sets, for both storages: iteration and joins, serial and
+    // parallel, add/remove churn, despawn, and serialization. Run alone with
+    // hg_bench --filter " scale " --csv results.csv to gate regressions.
+
+    for (u32 scaleN : {1000u, 10000u, 100000u})
+    {
+        for (u32 frag : {1u, 4u, 16u})
+        {
+            benchScale<Ecs>("Ecs", scaleN, frag);
+            benchScale<EcsArchetype>("EcsArchetype", scaleN, frag);
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include "bench.hpp"
+#include "hg/noise.hpp"
+#include "hg/array.hpp"
+#include "hg/heap.hpp"
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+void benchHeap()
+{
+    // ============================================================================
+    // Heap
+    // ============================================================================
+    //
+    // Heap and HeapTemp against std::priority_queue, for push then pop of random
+    // keys, bulk construction, and a decrease-key heavy open list.
+
+    static constexpr u32 iterations = 16;
+    static constexpr u32 n = 100000;
+
+    Array<u32> keys{n, n};
+    Rng rng{1234};
+    for (u32& k : keys)
+        k = rng.next();
+
+    // ------------------------------------------------------------------
+    // Push then pop
+    // ------------------------------------------------------------------
+
+    bench("Heap push/pop 100k", iterations, [&]
+    {
+        Heap<u32> h{n};
+        for (u32 k : keys)
+            h.push(k);
+        u64 sum = 0;
+        while (h.count > 0)
+            sum += h.pop();
+        benchSink = sum;
+    });
+
+    bench("HeapTemp push/pop 100k", iterations, [&]
+    {
+        ArenaScope scratch = getScratch();
+        HeapTemp<u32> h{scratch, n};
+        for (u32 k : keys)
+            h.push(k);
+        u64 sum = 0;
+        while (h.count > 0)
+            sum += h.pop();
+        benchSink = sum;
+    });
+
+    bench("std::priority_queue push/pop 100k", iterations, [&]
+    {
+        std::vector<u32> storage;
+        storage.reserve(n);
+        std::priority_queue<u32, std::vector<u32>, std::greater<u32>> h{std::greater<u32>{}, std::move(storage)};
+        for (u32 k : keys)
+            h.push(k);
+        u64 sum = 0;
+        while (!h.empty())
+        {
+            sum += h.top();
+            h.pop();
+        }
+        benchSink = sum;
+    });
+
+    // ------------------------------------------------------------------
+    // Bulk construction
+    // ------------------------------------------------------------------
+
+    bench("Heap heapify 100k", iterations, [&]
+    {
+        Heap<u32> h{Span<const u32>{keys}};
+        benchSink = h.peek();
+    });
+
+    bench("std::priority_queue range construct 100k", iterations, [&]
+    {
+        std::priority_queue<u32, std::vector<u32>, std::greater<u32>> h{keys.begin(), keys.end()};
+        benchSink = h.top();
+    });
+
+    // ------------------------------------------------------------------
+    // Decrease key
+    // ------------------------------------------------------------------
+    //
+    // Every node is lowered twice before being popped, as an A* open list does
+    // when shorter paths are found. std::priority_queue has no decrease-key, so
+    // it re-pushes and skips stale entries on pop.
+
+    static constexpr u32 nodes = 20000;
+
+    bench("IndexedHeap decrease-key 20k", iterations, [&]
+    {
+        IndexedHeap<u32, u32> h;
+        for (u32 i = 0; i < nodes; ++i)
+            h.push(i, keys[i] | 0x80000000);
+        for (u32 i = 0; i < nodes; ++i)
+            h.update(i, keys[i] >> 1 | 0x40000000);
+        for (u32 i = 0; i < nodes; ++i)
+            h.update(i, keys[i] >> 2);
+        u64 sum = 0;
+        while (h.count() > 0)
+            sum += h.pop().key;
+        benchSink = sum;
+    });
+
+    bench("std::priority_queue lazy decrease-key 20k", iterations, [&]
+    {
+        using Entry = std::pair<u32, u32>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> h;
+        std::vector<u32> best(nodes);
+        for (u32 i = 0; i < nodes; ++i)
+        {
+            best[i] = keys[i] | 0x80000000;
+            h.push({best[i], i});
+        }
+        for (u32 i = 0; i < nodes; ++i)
+        {
+            best[i] = keys[i] >> 1 | 0x40000000;
+            h.push({best[i], i});
+        }
+        for (u32 i = 0; i < nodes; ++i)
+        {
+            best[i] = keys[i] >> 2;
+            h.push({best[i], i});
+        }
+        u64 sum = 0;
+        while (!h.empty())
+        {
+            Entry e = h.top();
+            h.pop();
+            if (e.first == best[e.second])
+                sum += e.second;
+        }
+        benchSink = sum;
+    });
+}
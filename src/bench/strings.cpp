@@ -0,0 +1,217 @@
+#include "bench.hpp"
+#include "hg/noise.hpp"
+#include "hg/array.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void benchStrings()
+{
+    // ============================================================================
+    // Number conversion
+    // ============================================================================
+    //
+    // stringToFloat, floatToString, stringToInteger and integerToString
+    // against strtod, snprintf and strtoll, over random values.
+
+    static constexpr u32 iterations = 16;
+    static constexpr u32 n = 100000;
+
+    Rng rng{1234};
+
+    Array<f64> floats{n, n};
+    for (f64& f : floats)
+    {
+        u64 bits = (rng.next64() & 0x800fffffffffffff) | (static_cast<u64>(rng.next() % 120 + 963) << 52);
+        memcpy(&f, &bits, sizeof(f));
+    }
+
+    Array<i64> integers{n, n};
+    for (i64& i : integers)
+        i = static_cast<i64>(rng.next64()) >> (rng.next() % 64);
+
+    // Arena backed text for parsing, NUL terminated for the C functions
+    Arena text{n * 64};
+    Array<StringView> floatStrings{n, n};
+    Array<StringView> integerStrings{n, n};
+    for (u32 i = 0; i < n; ++i)
+    {
+        char* chars = text.alloc<char>(32);
+        i32 length = snprintf(chars, 32, "%.17e", floats[i]);
+        floatStrings[i] = {chars, static_cast<u64>(length)};
+
+        chars = text.alloc<char>(32);
+        length = snprintf(chars, 32, "%lld", static_cast<long long>(integers[i]));
+        integerStrings[i] = {chars, static_cast<u64>(length)};
+    }
+
+    // ------------------------------------------------------------------
+    // Float parsing
+    // ------------------------------------------------------------------
+
+    bench("stringToFloat 100k", iterations, [&]
+    {
+        f64 sum = 0.0;
+        for (StringView str : floatStrings)
+            sum += stringToFloat(str);
+        benchSink = static_cast<u64>(sum);
+    });
+
+    bench("strtod 100k", iterations, [&]
+    {
+        f64 sum = 0.0;
+        for (StringView str : floatStrings)
+            sum += strtod(str.chars, nullptr);
+        benchSink = static_cast<u64>(sum);
+    });
+
+    // ------------------------------------------------------------------
+    // Float formatting
+    // ------------------------------------------------------------------
+
+    bench("floatToString shortest 100k", iterations, [&]
+    {
+        ArenaScope scratch = getScratch();
+        u64 total = 0;
+        for (f64 f : floats)
+            total += floatToString(scratch, f).length;
+        benchSink = total;
+    });
+
+    bench("snprintf %.17g 100k", iterations, [&]
+    {
+        u64 total = 0;
+        char chars[32];
+        for (f64 f : floats)
+            total += static_cast<u64>(snprintf(chars, sizeof(chars), "%.17g", f));
+        benchSink = total;
+    });
+
+    bench("floatToString 6 decimals 100k", iterations, [&]
+    {
+        ArenaScope scratch = getScratch();
+        u64 total = 0;
+        for (u32 i = 0; i < n; ++i)
+            total += floatToString(scratch, static_cast<f64>(integers[i] % 1000000) * 0.001, 6).length;
+        benchSink = total;
+    });
+
+    bench("snprintf %.6f 100k", iterations, [&]
+    {
+        u64 total = 0;
+        char chars[64];
+        for (u32 i = 0; i < n; ++i)
+            total += static_cast<u64>(snprintf(chars, sizeof(chars), "%.6f", static_cast<f64>(integers[i] % 1000000) * 0.001));
+        benchSink = total;
+    });
+
+    // ------------------------------------------------------------------
+    // Integers
+    // ------------------------------------------------------------------
+
+    bench("stringToInteger 100k", iterations, [&]
+    {
+        i64 sum = 0;
+        for (StringView str : integerStrings)
+            sum += stringToInteger(str);
+        benchSink = static_cast<u64>(sum);
+    });
+
+    bench("strtoll 100k", iterations, [&]
+    {
+        i64 sum = 0;
+        for (StringView str : integerStrings)
+            sum += strtoll(str.chars, nullptr, 10);
+        benchSink = static_cast<u64>(sum);
+    });
+
+    bench("integerToString 100k", iterations, [&]
+    {
+        ArenaScope scratch = getScratch();
+        u64 total = 0;
+        for (i64 i : integers)
+            total += integerToString(scratch, i).length;
+        benchSink = total;
+    });
+
+    bench("snprintf %lld 100k", iterations, [&]
+    {
+        u64 total = 0;
+        char chars[32];
+        for (i64 i : integers)
+            total += static_cast<u64>(snprintf(chars, sizeof(chars), "%lld", static_cast<long long>(i)));
+        benchSink = total;
+    });
+
+    // ============================================================================
+    // UTF-8
+    // ============================================================================
+    //
+    // Validation, decoding and scanning over a megabyte of mostly ASCII text
+    // with some multibyte codepoints, the common case for source and assets.
+
+    static constexpr u64 textLength = 1 << 20;
+
+    Arena utf8{textLength};
+    char* chars = utf8.alloc<char>(textLength);
+    for (u64 i = 0; i < textLength;)
+    {
+        u32 r = rng.next() % 64;
+        if (r == 0 && i + 3 <= textLength)
+        {
+            memcpy(chars + i, "\xe2\x82\xac", 3);
+            i += 3;
+        }
+        else
+        {
+            chars[i++] = r == 1 ? '\n' : r < 10 ? ' ' : static_cast<char>('a' + r % 26);
+        }
+    }
+    StringView str{chars, textLength};
+
+    bench("isUtf8 1MB", iterations, [&]
+    {
+        benchSink = isUtf8(str);
+    });
+
+    bench("utf8Length 1MB", iterations, [&]
+    {
+        benchSink = utf8Length(str);
+    });
+
+    bench("utf8Next 1MB", iterations, [&]
+    {
+        u64 sum = 0;
+        for (u64 head = 0; head < str.length;)
+            sum += utf8Next(str, &head);
+        benchSink = sum;
+    });
+
+    Array<u32> codepoints{textLength, textLength};
+    bench("utf8Decode 1MB", iterations, [&]
+    {
+        benchSink = utf8Decode(str, codepoints.vals);
+    });
+
+    bench("findNewline 1MB", iterations, [&]
+    {
+        u64 lines = 0;
+        for (u64 head = findNewline(str); head < str.length; head = findNewline(str, head + 1))
+            ++lines;
+        benchSink = lines;
+    });
+
+    bench("memchr newline 1MB", iterations, [&]
+    {
+        u64 lines = 0;
+        const char* end = str.chars + str.length;
+        for (const void* c = memchr(str.chars, '\n', str.length); c != nullptr;)
+        {
+            ++lines;
+            const char* next = static_cast<const char*>(c) + 1;
+            c = memchr(next, '\n', static_cast<u64>(end - next));
+        }
+        benchSink = lines;
+    });
+}
@@ -0,0 +1,59 @@
+#include "bench.hpp"
+#include "hg/noise.hpp"
+#include "hg/transform.hpp"
+
+void benchTransform()
+{
+    // ============================================================================
+    // Transform propagation
+    // ============================================================================
+    //
+    // A 100k node scene graph of a few hundred roots with random children,
+    // propagated with every node dirty, with 1% of the local transforms
+    // changed, and with nothing changed, plus rebuilding the breadth first
+    // order after a reparent.
+
+    static constexpr u32 iterations = 16;
+    static constexpr u32 n = 100000;
+
+    Rng rng{4321};
+    TransformHierarchy h{};
+    for (u32 i = 0; i < n; ++i)
+    {
+        Entity parent = i < 256 ? nullEntity : Entity{Handle{rng.next() % i}};
+        f32 angle = static_cast<f32>(rng.next() % 628) * 0.01f;
+        h.add(Entity{Handle{i}}, parent, matModel3D({1.0f, 0.0f, 0.5f}, {1.0f, 1.0f, 1.0f}, quatAxisAngle({0.0f, 1.0f, 0.0f}, angle)));
+    }
+    h.propagate();
+
+    bench("TransformHierarchy propagate all 100k", iterations, [&]
+    {
+        for (u32 i = 0; i < 256; ++i)
+            h.setLocal(Entity{Handle{i}}, h.getLocal(Entity{Handle{i}}));
+        h.propagate();
+    });
+
+    bench("TransformHierarchy propagate 1% of 100k", iterations, [&]
+    {
+        for (u32 i = 0; i < n; i += 100)
+        {
+            Entity e{Handle{(rng.next() % (n - 256)) + 256}};
+            h.setLocal(e, h.getLocal(e));
+        }
+        h.propagate();
+    });
+
+    bench("TransformHierarchy propagate clean 100k", iterations, [&]
+    {
+        h.propagate();
+    });
+
+    bench("TransformHierarchy rebuild 100k", iterations, [&]
+    {
+        Entity e{Handle{n - 1}};
+        h.setParent(e, Entity{Handle{rng.next() % (n - 1)}});
+        h.propagate();
+    });
+
+    std::printf("HG Transform - 100k nodes, depth: %u\n", h.depth());
+}
@@ -1,4 +1,15 @@
 #include "hg/binary.hpp"
+#include "hg/error.hpp"
+
+#if defined(HG_PLATFORM_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(HG_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
 
 namespace hg {
 
@@ -55,4 +66,100 @@ Binary::~Binary() noexcept
         heapFree(data, size);
 }
 
+#if defined(HG_PLATFORM_LINUX)
+
+Maybe<MappedBinary> MappedBinary::map(StringView path)
+{
+    ArenaScope scratch = getScratch();
+    char* cpath = cString(scratch, path);
+
+    int fd = open(cpath, O_RDONLY);
+    if (fd < 0)
+    {
+        setError("Could not open file to map: %s", cpath);
+        return {};
+    }
+    HG_DEFER(close(fd));
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0)
+    {
+        setError("Could not read size of file to map: %s", cpath);
+        return {};
+    }
+
+    Maybe<MappedBinary> bin = some<MappedBinary>();
+    bin->size = static_cast<u64>(info.st_size);
+    if (bin->size == 0)
+        return bin;
+
+    void* data = mmap(nullptr, bin->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        setError("Could not map file: %s", cpath);
+        return {};
+    }
+    bin->data = data;
+    return bin;
+}
+
+MappedBinary::~MappedBinary() noexcept
+{
+    if (data != nullptr)
+        munmap(const_cast<void*>(data), size);
+}
+
+#elif defined(HG_PLATFORM_WINDOWS)
+
+Maybe<MappedBinary> MappedBinary::map(StringView path)
+{
+    ArenaScope scratch = getScratch();
+    char* cpath = cString(scratch, path);
+
+    HANDLE file = CreateFileA(cpath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        setError("Could not open file to map: %s", cpath);
+        return {};
+    }
+    HG_DEFER(CloseHandle(file));
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        setError("Could not read size of file to map: %s", cpath);
+        return {};
+    }
+
+    Maybe<MappedBinary> bin = some<MappedBinary>();
+    bin->size = static_cast<u64>(fileSize.QuadPart);
+    if (bin->size == 0)
+        return bin;
+
+    bin->mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (bin->mapping == nullptr)
+    {
+        setError("Could not map file: %s", cpath);
+        return {};
+    }
+
+    bin->data = MapViewOfFile(static_cast<HANDLE>(bin->mapping), FILE_MAP_READ, 0, 0, 0);
+    if (bin->data == nullptr)
+    {
+        setError("Could not map file: %s", cpath);
+        return {};
+    }
+    return bin;
+}
+
+MappedBinary::~MappedBinary() noexcept
+{
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (mapping != nullptr)
+        CloseHandle(static_cast<HANDLE>(mapping));
+}
+
+#endif
+
 } // namespace hg
@@ -0,0 +1,249 @@
+#include "hg/ecs.hpp"
+#include "hg/time.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace hg {
+
+void EcsScheduler::reset()
+{
+    systems.reset();
+    dirty = false;
+    time = 0.0;
+}
+
+void EcsScheduler::add(EcsSystem system)
+{
+    HG_ASSERT(system.thunk != nullptr);
+    HG_ASSERT(system.fn != nullptr);
+    systems.push(std::move(system));
+    dirty = true;
+}
+
+bool EcsScheduler::compatible(const EcsSystem& a, const EcsSystem& b)
+{
+    if (a.exclusive || b.exclusive)
+        return false;
+    return (a.writes & (b.reads | b.writes)) == 0 && (b.writes & (a.reads | a.writes)) == 0;
+}
+
+void EcsScheduler::build()
+{
+    for (EcsSystem& system : systems)
+    {
+        system.dependents.reset();
+        system.dependencies = 0;
+        system.level = 0;
+    }
+
+    for (u32 j = 0; j < systems.count; ++j)
+    {
+        for (u32 i = 0; i < j; ++i)
+        {
+            if (compatible(systems[i], systems[j]))
+                continue;
+
+            systems[i].dependents.push(j);
+            ++systems[j].dependencies;
+            systems[j].level = std::max(systems[j].level, systems[i].level + 1);
+        }
+    }
+
+    dirty = false;
+}
+
+void ecsSortKeys(u64* keys, u64 count)
+{
+    // Commands from a single buffer are often already in order
+    u64 sorted = 1;
+    while (sorted < count && keys[sorted - 1] >> 32 <= keys[sorted] >> 32)
+    {
+        ++sorted;
+    }
+    if (sorted >= count)
+        return;
+
+    u64 histograms[4][256] = {};
+    for (u64 i = 0; i < count; ++i)
+    {
+        u32 high = static_cast<u32>(keys[i] >> 32);
+        for (u32 d = 0; d < 4; ++d)
+        {
+            ++histograms[d][(high >> (d * 8)) & 0xff];
+        }
+    }
+
+    ArenaScope scratch = getScratch();
+    u64* src = keys;
+    u64* dst = scratch.alloc<u64>(count);
+    for (u32 d = 0; d < 4; ++d)
+    {
+        u32 shift = 32 + d * 8;
+        u64* offsets = histograms[d];
+        if (offsets[(src[0] >> shift) & 0xff] == count)
+            continue;
+
+        u64 offset = 0;
+        for (u64& bucket : Span<u64>{offsets, 256})
+        {
+            u64 n = bucket;
+            bucket = offset;
+            offset += n;
+        }
+        for (u64 i = 0; i < count; ++i)
+        {
+            dst[offsets[(src[i] >> shift) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != keys)
+        memcpy(keys, src, count * sizeof(u64));
+}
+
+void ecsDeltaEncode(Array<u64>* delta, const u64* from, u64 fromCount, const u64* to, u64 toCount)
+{
+    delta->count = 0;
+    delta->push(toCount);
+
+    u64 count = std::max(fromCount, toCount);
+    u64 common = std::min(fromCount, toCount);
+    auto diff = [&](u64 i)
+    {
+        if (i < common)
+            return from[i] ^ to[i];
+        return i < fromCount ? from[i] : to[i];
+    };
+
+    for (u64 i = 0; i < count;)
+    {
+        u64 zeros = i;
+        while (i < count && diff(i) == 0)
+        {
+            ++i;
+        }
+        if (i == count)
+            break;
+        zeros = i - zeros;
+
+        u64 literals = i;
+        while (i < count && diff(i) != 0)
+        {
+            ++i;
+        }
+        literals = i - literals;
+
+        delta->push(zeros << 32 | literals);
+        for (u64 j = i - literals; j < i; ++j)
+        {
+            delta->push(diff(j));
+        }
+    }
+}
+
+void ecsDeltaApply(Array<u64>* frame, const Array<u64>& delta)
+{
+    u64 toCount = delta[0];
+    if (toCount > frame->count)
+        frame->resize(toCount);
+
+    // Words past toCount become zero, as the target frame has none there
+    u64* word = frame->vals;
+    for (u64 i = 1; i < delta.count;)
+    {
+        word += delta[i] >> 32;
+        u64 literals = delta[i] & 0xffffffff;
+        ++i;
+        for (u64 j = 0; j < literals; ++j)
+        {
+            *word++ ^= delta[i++];
+        }
+    }
+    frame->count = toCount;
+}
+
+struct EcsRun {
+    EcsScheduler* scheduler = nullptr;
+    void* ecs = nullptr;
+    std::atomic<u32>* pending = nullptr;
+    Fence fence{};
+};
+
+struct EcsTask {
+    EcsRun* run = nullptr;
+    u32 idx = 0;
+};
+
+static void ecsRunTask(void* ptask)
+{
+    EcsTask* task = static_cast<EcsTask*>(ptask);
+    EcsRun* run = task->run;
+    EcsSystem& system = run->scheduler->systems[task->idx];
+
+    Clock clock{};
+    system.thunk(run->ecs, &system);
+    system.time = clock.tick();
+    system.totalTime += system.time;
+    ++system.runs;
+
+    // The fence still counts this task, so it cannot complete before the
+    // dependents are pushed
+    for (u32 dependent : system.dependents)
+    {
+        if (run->pending[dependent].fetch_sub(1) == 1)
+            callPar(&run->fence, task - task->idx + dependent, ecsRunTask);
+    }
+}
+
+void EcsScheduler::run(void* ecs)
+{
+    if (dirty)
+        build();
+    if (systems.count == 0)
+        return;
+
+    Clock clock{};
+    ArenaScope scratch = getScratch();
+
+    EcsRun run{};
+    run.scheduler = this;
+    run.ecs = ecs;
+    run.pending = scratch.alloc<std::atomic<u32>>(systems.count);
+
+    EcsTask* tasks = scratch.alloc<EcsTask>(systems.count);
+    for (u32 i = 0; i < systems.count; ++i)
+    {
+        new (run.pending + i) std::atomic<u32>{systems[i].dependencies};
+        tasks[i] = {&run, i};
+    }
+
+    for (u32 i = 0; i < systems.count; ++i)
+    {
+        if (systems[i].dependencies == 0)
+            callPar(&run.fence, tasks + i, ecsRunTask);
+    }
+    helpThreads(&run.fence, INFINITY);
+
+    time = clock.tick();
+}
+
+void EcsScheduler::log() const
+{
+    printf("HG Schedule - %llu systems, last run: %.4fms\n",
+        static_cast<unsigned long long>(systems.count), time * 1.e3);
+
+    for (u32 i = 0; i < systems.count; ++i)
+    {
+        const EcsSystem& system = systems[i];
+        StringView name = atomString(system.name);
+        f64 avg = system.runs == 0 ? 0.0 : system.totalTime / static_cast<f64>(system.runs);
+        printf("HG Schedule - %u %.*s: level: %u, waits for: %u, last: %.4fms, avg: %.4fms%s\n",
+            i, static_cast<int>(name.length), name.chars, system.level, system.dependencies,
+            system.time * 1.e3, avg * 1.e3, system.exclusive ? ", exclusive" : "");
+    }
+}
+
+} // namespace hg
@@ -1,5 +1,7 @@
 #include "hg/pool.hpp"
 
+#include <algorithm>
+
 namespace hg {
 
 void HandlePool::reset()
@@ -37,4 +39,138 @@ void HandlePool::free(Handle handle)
     freed.push(handle.nextGeneration());
 }
 
+ConcurrentHandlePool::ConcurrentHandlePool(u32 slotCount)
+    : capacity{slotCount}
+{
+    HG_ASSERT(slotCount <= (u32)1 << Handle::idxBits);
+
+    handles = heapAlloc<std::atomic<u32>>(capacity);
+    freed = heapAlloc<u32>(capacity);
+    links = heapAlloc<std::atomic<u32>>(capacity);
+    for (u32 i = 0; i < capacity; ++i)
+    {
+        new (handles + i) std::atomic<u32>{nullHandle.id};
+        new (links + i) std::atomic<u32>{(u32)-1};
+    }
+}
+
+ConcurrentHandlePool::~ConcurrentHandlePool() noexcept
+{
+    if (capacity == 0)
+        return;
+
+    heapFree(handles, capacity);
+    heapFree(freed, capacity);
+    heapFree(links, capacity);
+}
+
+void ConcurrentHandlePool::reset()
+{
+    for (u32 i = 0; i < slots(); ++i)
+    {
+        handles[i].store(nullHandle.id, std::memory_order_relaxed);
+    }
+    freeTop.store((u32)-1, std::memory_order_relaxed);
+    fresh.store(0, std::memory_order_relaxed);
+}
+
+u32 ConcurrentHandlePool::slots() const
+{
+    return fresh.load(std::memory_order_relaxed);
+}
+
+Handle ConcurrentHandlePool::alloc()
+{
+    u64 top = freeTop.load(std::memory_order_acquire);
+    while (static_cast<u32>(top) != (u32)-1)
+    {
+        // The link may be stale if another thread took the slot first, but
+        // then the count has changed and the exchange fails
+        u32 idx = static_cast<u32>(top);
+        u64 next = ((top >> 32) + 1) << 32 | links[idx].load(std::memory_order_relaxed);
+        if (freeTop.compare_exchange_weak(top, next, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            Handle handle = {freed[idx]};
+            handles[idx].store(handle.id, std::memory_order_release);
+            return handle;
+        }
+    }
+
+    HandleBatch one = reserve(1);
+    if (one.next == one.end)
+        return nullHandle;
+
+    handles[one.next].store(one.next, std::memory_order_release);
+    return {one.next};
+}
+
+HandleBatch ConcurrentHandlePool::reserve(u32 count)
+{
+    // The count never passes the capacity, so a full pool stays full
+    u32 begin = fresh.load(std::memory_order_relaxed);
+    u32 end;
+    do
+    {
+        if (begin >= capacity)
+            return {};
+        end = begin + std::min(count, capacity - begin);
+    }
+    while (!fresh.compare_exchange_weak(begin, end, std::memory_order_relaxed));
+    return {begin, end};
+}
+
+Handle ConcurrentHandlePool::alloc(HandleBatch* batch)
+{
+    HG_ASSERT(batch != nullptr);
+    if (batch->next == batch->end)
+        return alloc();
+
+    u32 idx = batch->next++;
+    handles[idx].store(idx, std::memory_order_release);
+    return {idx};
+}
+
+void ConcurrentHandlePool::release(HandleBatch* batch)
+{
+    HG_ASSERT(batch != nullptr);
+    if (batch->next == batch->end)
+        return;
+
+    // The unused indices are linked in order and pushed all at once
+    for (u32 i = batch->next; i < batch->end; ++i)
+    {
+        freed[i] = i;
+        links[i].store(i + 1, std::memory_order_relaxed);
+    }
+    pushFreed(batch->next, batch->end - 1);
+    *batch = {};
+}
+
+bool ConcurrentHandlePool::alive(Handle handle) const
+{
+    u32 idx = handle.idx();
+    return idx < capacity && handles[idx].load(std::memory_order_acquire) == handle.id;
+}
+
+void ConcurrentHandlePool::free(Handle handle)
+{
+    HG_ASSERT(alive(handle));
+    u32 idx = handle.idx();
+    handles[idx].store(nullHandle.id, std::memory_order_relaxed);
+    freed[idx] = handle.nextGeneration().id;
+    pushFreed(idx, idx);
+}
+
+void ConcurrentHandlePool::pushFreed(u32 first, u32 last)
+{
+    u64 top = freeTop.load(std::memory_order_relaxed);
+    u64 next;
+    do
+    {
+        links[last].store(static_cast<u32>(top), std::memory_order_relaxed);
+        next = ((top >> 32) + 1) << 32 | first;
+    }
+    while (!freeTop.compare_exchange_weak(top, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
 } // namespace hg
@@ -130,7 +130,7 @@ Texture createTextureFromData(const TextureData& data)
 template<>
 void assetLoadImpl(AssetData<Texture>* data)
 {
-    Asset<TextureData> tex = load<TextureData>(data->path);
+    Asset<TextureData> tex = load<TextureData>(data->key);
     if (tex->pixels == nullptr)
         return;
 
@@ -154,7 +154,7 @@ void meshStoreGltf(MeshData* data, StringView path)
 template<>
 void assetLoadImpl(AssetData<Mesh>* data)
 {
-    Asset<MeshData> mesh = load<MeshData>(data->path);
+    Asset<MeshData> mesh = load<MeshData>(data->key);
 
     data->asset.vertexCount = static_cast<u32>(mesh->vertices.count);
     data->asset.vertexWidth = sizeof(MeshVertex);
@@ -341,7 +341,7 @@ void assetLoadImpl(AssetData<Atlas2D>* data)
 {
     ArenaScope scratch = getScratch();
 
-    Serializer s = readSerialBinary(scratch, *load<Binary>(data->path));
+    Serializer s = readSerialBinary(scratch, *load<Binary>(data->key));
     serialize(&s, &data->asset);
 }
 
@@ -549,17 +549,30 @@ void Layer2D::drawTilemap(const Tilemap2D& tilemap, Rect dst)
     }
 }
 
+// Fonts index glyphs by codepoint, codepoints past the end of the font draw
+// as '?', or the first glyph if the font has no '?'
+static Rect textGlyph(const Atlas2D& font, u32 codepoint)
+{
+    if (codepoint < font.sprites.count)
+        return font.sprites[codepoint];
+    if ('?' < font.sprites.count)
+        return font.sprites['?'];
+    return font.sprites[0];
+}
+
 StringView Layer2D::drawText(StringView text, Vec4 color, const TextBuilder& box)
 {
     Rect bounds{};
+    if (text.length == 0)
+        return text;
 
     HG_ASSERT(box.width != INFINITY || box.height != INFINITY);
 
     if (box.width == INFINITY)
     {
-        for (char c : text)
+        for (u64 head = 0; head < text.length;)
         {
-            Rect cRect = box.font->sprites[static_cast<u32>(c)];
+            Rect cRect = textGlyph(*box.font, utf8Next(text, &head));
             Vec2 size = cRect.end - cRect.begin;
             bounds.end.x += size.x * box.height / size.y;
         }
@@ -569,30 +582,32 @@ StringView Layer2D::drawText(StringView text, Vec4 color, const TextBuilder& box
     else if (box.height == INFINITY)
     {
         f32 width = 0;
-        for (char c : text)
+        for (u64 head = 0; head < text.length;)
         {
-            Rect cRect = box.font->sprites[static_cast<u32>(c)];
+            Rect cRect = textGlyph(*box.font, utf8Next(text, &head));
             Vec2 size = cRect.end - cRect.begin;
             width += size.x;
         }
 
         bounds.end.x = box.width;
 
-        Rect firstRect = box.font->sprites[static_cast<u32>(text[0])];
+        u64 firstHead = 0;
+        Rect firstRect = textGlyph(*box.font, utf8Next(text, &firstHead));
         Vec2 firstSize = firstRect.end - firstRect.begin;
 
         bounds.end.y = firstSize.y * box.width / width;
     }
     else
     {
-        Rect firstRect = box.font->sprites[static_cast<u32>(text[0])];
+        u64 firstHead = 0;
+        Rect firstRect = textGlyph(*box.font, utf8Next(text, &firstHead));
         Vec2 firstSize = firstRect.end - firstRect.begin;
 
         bounds.end.y = firstSize.y;
 
-        for (char c : text)
+        for (u64 head = 0; head < text.length;)
         {
-            Rect cRect = box.font->sprites[static_cast<u32>(c)];
+            Rect cRect = textGlyph(*box.font, utf8Next(text, &head));
             Vec2 size = cRect.end - cRect.begin;
             bounds.end.x += size.x;
         }
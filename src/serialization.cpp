@@ -1,7 +1,249 @@
 #include "hg/serialization.hpp"
+#include "hg/error.hpp"
+
+#include <cstdio>
 
 namespace hg {
 
+static constexpr char serialBinTag[] = "Data";
+static constexpr u32 serialBinVersionMajor = 0;
+static constexpr u32 serialBinVersionMinor = 0;
+static constexpr u32 serialBinVersionPatch = 0;
+
+static_assert(sizeof(SerialBinHeader::tag) == sizeof(serialBinTag));
+
+static SerialBinHeader serialBinMakeHeader()
+{
+    SerialBinHeader header{};
+    memcpy(header.tag, serialBinTag, sizeof(serialBinTag));
+    header.versionMajor = serialBinVersionMajor;
+    header.versionMinor = serialBinVersionMinor;
+    header.versionPatch = serialBinVersionPatch;
+    header.nodeBegin = sizeof(SerialBinHeader);
+    return header;
+}
+
+static void serialStreamAppend(SerialStream* stream, const void* src, u64 len)
+{
+    HG_ASSERT(stream->size + len <= (u32)-1);
+    if (len == 0)
+        return;
+
+    if (stream->bin != nullptr)
+    {
+        stream->bin->append(src, len);
+    }
+    else if (stream->file != nullptr && !stream->failed)
+    {
+        if (fwrite(src, 1, len, static_cast<FILE*>(stream->file)) != len)
+            stream->failed = true;
+    }
+    stream->size += len;
+}
+
+static Serializer serialStreamStart(SerialStream* stream)
+{
+    SerialBinHeader header = serialBinMakeHeader();
+    stream->size = 0;
+    stream->nodeBegin = header.nodeBegin;
+    stream->pending.reset();
+    stream->opened.reset();
+
+    // The root node is only known at the end, so space is left for it
+    SerialBinNode root{};
+    serialStreamAppend(stream, &header, sizeof(header));
+    serialStreamAppend(stream, &root, sizeof(root));
+
+    Serializer s{};
+    s.writing = true;
+    s.stream = stream;
+    return s;
+}
+
+Serializer serialStreamWriter(SerialStream* stream, BinaryBuilder* bin)
+{
+    HG_ASSERT(bin != nullptr);
+    stream->bin = bin;
+    stream->file = nullptr;
+    stream->failed = false;
+    return serialStreamStart(stream);
+}
+
+Serializer serialStreamWriter(SerialStream* stream, StringView path)
+{
+    ArenaScope scratch = getScratch();
+    char* cpath = cString(scratch, path);
+
+    stream->bin = nullptr;
+    stream->file = fopen(cpath, "wb");
+    stream->failed = stream->file == nullptr;
+    if (stream->failed)
+        setError("Failed to create file to write binary: %s", cpath);
+    return serialStreamStart(stream);
+}
+
+bool serialStreamEnd(SerialStream* stream)
+{
+    HG_ASSERT(stream->opened.count == 0);
+    HG_ASSERT(stream->pending.count == 1);
+    SerialBinNode root = stream->pending[0];
+    stream->pending.reset();
+
+    if (stream->bin != nullptr)
+    {
+        stream->bin->overwrite(stream->nodeBegin, root);
+        return true;
+    }
+
+    FILE* file = static_cast<FILE*>(stream->file);
+    stream->file = nullptr;
+    if (file == nullptr)
+        return false;
+
+    if (!stream->failed)
+    {
+        stream->failed = fseek(file, stream->nodeBegin, SEEK_SET) != 0
+            || fwrite(&root, 1, sizeof(root), file) != sizeof(root);
+    }
+    stream->failed = fclose(file) != 0 || stream->failed;
+    if (stream->failed)
+        setError("Failed to write binary data to file");
+    return !stream->failed;
+}
+
+static SerialBinNode& serialStreamPush(SerialStream* stream)
+{
+    // Only a single root value may be written
+    HG_ASSERT(stream->opened.count > 0 || stream->pending.count == 0);
+    SerialBinNode& node = stream->pending.push();
+    node = {};
+    return node;
+}
+
+static bool serialBinReadHeader(BinaryView bin, SerialBinHeader* header)
+{
+    if (bin.size < sizeof(SerialBinHeader) + sizeof(SerialBinNode))
+    {
+        HG_WARN("Serial binary could not be read, too small for a header\n");
+        return false;
+    }
+
+    *header = bin.read<SerialBinHeader>(0);
+    if (memcmp(header->tag, serialBinTag, sizeof(serialBinTag)) != 0)
+    {
+        HG_WARN("Serial binary could not be read, does not have a header\n");
+        return false;
+    }
+    else if (header->versionMajor != serialBinVersionMajor)
+    {
+        HG_WARN("Serial binary has wrong major version: %d instead of %d", header->versionMajor, serialBinVersionMajor);
+    }
+    else if (header->versionMinor != serialBinVersionMinor)
+    {
+        HG_WARN("Serial binary has wrong minor version: %d instead of %d", header->versionMinor, serialBinVersionMinor);
+    }
+    else if (header->versionPatch != serialBinVersionPatch)
+    {
+        HG_WARN("Serial binary has wrong patch version: %d instead of %d", header->versionPatch, serialBinVersionPatch);
+    }
+    return true;
+}
+
+SerialBinNode SerialBinValue::node() const
+{
+    HG_ASSERT(valid());
+    return bin.read<SerialBinNode>(offset);
+}
+
+u32 SerialBinValue::count() const
+{
+    SerialBinNode n = node();
+    HG_ASSERT(n.type == SerialData::typeIdx<SerialObject>);
+    return n.object.fieldCount;
+}
+
+SerialBinValue SerialBinValue::field(u32 idx) const
+{
+    SerialBinNode n = node();
+    HG_ASSERT(n.type == SerialData::typeIdx<SerialObject>);
+    HG_ASSERT(idx < n.object.fieldCount);
+    return {bin, n.object.fieldsBegin + idx * static_cast<u32>(sizeof(SerialBinNode))};
+}
+
+i64 SerialBinValue::integer() const
+{
+    SerialBinNode n = node();
+    HG_ASSERT(n.type == SerialData::typeIdx<i64>);
+    return n.integer;
+}
+
+f64 SerialBinValue::floating() const
+{
+    SerialBinNode n = node();
+    HG_ASSERT(n.type == SerialData::typeIdx<f64>);
+    return n.floating;
+}
+
+bool SerialBinValue::boolean() const
+{
+    SerialBinNode n = node();
+    HG_ASSERT(n.type == SerialData::typeIdx<bool>);
+    return n.boolean;
+}
+
+StringView SerialBinValue::string() const
+{
+    SerialBinNode n = node();
+    HG_ASSERT(n.type == SerialData::typeIdx<StringView>);
+    HG_ASSERT(static_cast<u64>(n.string.begin) + n.string.length <= bin.size);
+    return {static_cast<const char*>(bin.data) + n.string.begin, n.string.length};
+}
+
+BinaryView SerialBinValue::blob() const
+{
+    StringView str = string();
+    return {str.chars, str.length};
+}
+
+SerialBinValue serialBinRoot(BinaryView bin)
+{
+    SerialBinHeader header{};
+    if (!serialBinReadHeader(bin, &header))
+        return {};
+    return {bin, header.nodeBegin};
+}
+
+Serializer serialBinReader(SerialBinReader* reader, SerialBinValue value)
+{
+    HG_ASSERT(value.valid());
+    reader->bin = value.bin;
+    reader->root = value.offset;
+    reader->parents.reset();
+    reader->current = 0;
+
+    Serializer s{};
+    s.writing = false;
+    s.reader = reader;
+    return s;
+}
+
+static u32 serialBinReaderNext(SerialBinReader* reader)
+{
+    if (reader->parents.count == 0)
+    {
+        // Only a single root value may be read
+        HG_ASSERT(reader->current == 0);
+        reader->current = reader->root;
+        return reader->current;
+    }
+
+    SerialBinObject object = reader->bin.read<SerialBinNode>(reader->parents[reader->parents.count - 1]).object;
+    u32 next = reader->current == 0 ? object.fieldsBegin : reader->current + static_cast<u32>(sizeof(SerialBinNode));
+    HG_ASSERT(next < object.fieldsBegin + object.fieldCount * sizeof(SerialBinNode));
+    reader->current = next;
+    return next;
+}
+
 Serializer serialWriter(Arena* arena)
 {
     Serializer s{};
@@ -82,6 +324,25 @@ void serializeNodeStart(Serializer* s)
 
 void serializeBegin(Serializer* s, u32* size)
 {
+    if (s->stream != nullptr)
+    {
+        serialStreamPush(s->stream).type = SerialData::typeIdx<SerialObject>;
+        s->stream->opened.push(static_cast<u32>(s->stream->pending.count));
+        return;
+    }
+
+    if (s->reader != nullptr)
+    {
+        SerialBinReader* reader = s->reader;
+        SerialBinValue object{reader->bin, serialBinReaderNext(reader)};
+        u32 count = object.count();
+        if (size != nullptr)
+            *size = count;
+        reader->parents.push(object.offset);
+        reader->current = 0;
+        return;
+    }
+
     serializeNodeStart(s);
 
     if (s->writing)
@@ -100,41 +361,130 @@ void serializeBegin(Serializer* s, u32* size)
 
 void serializeEnd(Serializer* s)
 {
+    if (s->stream != nullptr)
+    {
+        // The object's fields are written together now they are all known
+        SerialStream* stream = s->stream;
+        u32 first = stream->opened.pop();
+        u32 count = static_cast<u32>(stream->pending.count) - first;
+
+        SerialBinNode& object = stream->pending[first - 1];
+        object.object.fieldCount = count;
+        object.object.fieldsBegin = static_cast<u32>(stream->size);
+        serialStreamAppend(stream, stream->pending.vals + first, count * sizeof(SerialBinNode));
+        stream->pending.count = first;
+        return;
+    }
+
+    if (s->reader != nullptr)
+    {
+        s->reader->current = s->reader->parents.pop();
+        return;
+    }
+
     HG_ASSERT(s->parent != nullptr);
 
     s->current = s->parent;
     s->parent = s->parent->parent;
 }
 
-void serializeVoid(Serializer* s, Span<void> data)
+void serializeWrite(Serializer* s, const SerialData& data)
 {
-    serializeNodeStart(s);
+    HG_ASSERT(s->writing);
+    HG_ASSERT(!data.is<SerialObject>());
+
+    if (s->stream == nullptr)
+    {
+        serializeNodeStart(s);
+        if (data.is<StringView>())
+            s->current->data = StringView{StringBuilder{s->arena, data.get<StringView>()}};
+        else
+            s->current->data = data;
+        return;
+    }
+
+    SerialStream* stream = s->stream;
+    SerialBinNode& node = serialStreamPush(stream);
+    node.type = data.tag;
+    switch (data.tag)
+    {
+        case SerialData::typeIdx<StringView>:
+        {
+            StringView str = data.get<StringView>();
+            node.string.begin = static_cast<u32>(stream->size);
+            node.string.length = static_cast<u32>(str.length);
+            serialStreamAppend(stream, str.chars, str.length);
+            return;
+        }
+        case SerialData::typeIdx<i64>:
+            node.integer = data.get<i64>();
+            return;
+        case SerialData::typeIdx<f64>:
+            node.floating = data.get<f64>();
+            return;
+        case SerialData::typeIdx<bool>:
+            node.boolean = data.get<bool>();
+            return;
+        default:
+            HG_PANIC("Invalid SerialType: %d\n", data.tag);
+    }
+}
+
+SerialData serializeRead(Serializer* s)
+{
+    HG_ASSERT(!s->writing);
+
+    if (s->reader == nullptr)
+    {
+        serializeNodeStart(s);
+        return s->current->data;
+    }
+
+    SerialBinValue value{s->reader->bin, serialBinReaderNext(s->reader)};
+    SerialBinNode node = value.node();
+    switch (node.type)
+    {
+        case SerialData::typeIdx<StringView>:
+            return value.string();
+        case SerialData::typeIdx<i64>:
+            return i64{node.integer};
+        case SerialData::typeIdx<f64>:
+            return f64{node.floating};
+        case SerialData::typeIdx<bool>:
+            return bool{node.boolean};
+        default:
+            HG_PANIC("Invalid SerialType: %d\n", node.type);
+    }
+}
 
+void serializeVoid(Serializer* s, Span<void> data)
+{
     if (s->writing)
     {
-        s->current->data = StringView{StringBuilder{s->arena, {static_cast<char*>(data.data), data.size}}};
+        serializeWrite(s, StringView{static_cast<char*>(data.data), data.size});
     }
     else
     {
-        HG_ASSERT(s->current->data.is<StringView>());
-        HG_ASSERT(s->current->data.get<StringView>().length == data.size);
-        memcpy(data.data, s->current->data.get<StringView>().chars, data.size);
+        SerialData read = serializeRead(s);
+        HG_ASSERT(read.is<StringView>());
+        HG_ASSERT(read.get<StringView>().length == data.size);
+        if (data.size > 0)
+            memcpy(data.data, read.get<StringView>().chars, data.size);
     }
 }
 
 template<>
 void serialize(Serializer* s, bool* val)
 {
-    serializeNodeStart(s);
-
     if (s->writing)
     {
-        s->current->data = bool{*val};
+        serializeWrite(s, bool{*val});
     }
     else
     {
-        HG_ASSERT(s->current->data.is<bool>());
-        *val = s->current->data.get<bool>();
+        SerialData data = serializeRead(s);
+        HG_ASSERT(data.is<bool>());
+        *val = data.get<bool>();
     }
 }
 
@@ -213,70 +563,64 @@ void serialize(Serializer* s, Quat* val)
 template<>
 void serialize(Serializer* s, String* val)
 {
-    serializeNodeStart(s);
-
     if (s->writing)
     {
-        s->current->data = StringView{StringBuilder{s->arena, *val}};
+        serializeWrite(s, StringView{*val});
     }
     else
     {
-        HG_ASSERT(s->current->data.is<StringView>());
-        *val = String::create(s->current->data.get<StringView>());
+        SerialData data = serializeRead(s);
+        HG_ASSERT(data.is<StringView>());
+        *val = String::create(data.get<StringView>());
     }
 }
 
 template<>
 void serialize(Serializer* s, Binary* val)
 {
-    serializeNodeStart(s);
-
     if (s->writing)
     {
-        s->current->data = StringView{StringBuilder{s->arena, {static_cast<char*>(val->data), val->size}}};
+        serializeWrite(s, StringView{static_cast<char*>(val->data), val->size});
     }
     else
     {
-        HG_ASSERT(s->current->data.is<StringView>());
-        StringView str = s->current->data.get<StringView>();
+        SerialData data = serializeRead(s);
+        HG_ASSERT(data.is<StringView>());
+        StringView str = data.get<StringView>();
         *val = Binary::create({str.chars, str.length});
     }
 }
 
-static constexpr char serialBinTag[] = "Data";
-static constexpr u32 serialBinVersionMajor = 0;
-static constexpr u32 serialBinVersionMinor = 0;
-static constexpr u32 serialBinVersionPatch = 0;
+template<>
+void serialize(Serializer* s, StringView* val)
+{
+    if (s->writing)
+    {
+        serializeWrite(s, StringView{*val});
+    }
+    else
+    {
+        SerialData data = serializeRead(s);
+        HG_ASSERT(data.is<StringView>());
+        *val = data.get<StringView>();
+    }
+}
 
-struct SerialBinHeader {
-    char tag[sizeof(serialBinTag)] = {};
-    u32 versionMajor = 0;
-    u32 versionMinor = 0;
-    u32 versionPatch = 0;
-
-    u32 nodeBegin = 0;
-};
-
-struct SerialBinObject {
-    u32 fieldCount;
-    u32 fieldsBegin;
-};
-
-struct SerialBinString {
-    u32 begin;
-    u32 length;
-};
-
-struct SerialBinNode {
-    u32 type = {};
-    union {
-        SerialBinObject object;
-        SerialBinString string;
-        i64 integer;
-        f64 floating;
-        bool boolean;
-    };
-};
+template<>
+void serialize(Serializer* s, BinaryView* val)
+{
+    if (s->writing)
+    {
+        serializeWrite(s, StringView{static_cast<const char*>(val->data), val->size});
+    }
+    else
+    {
+        SerialData data = serializeRead(s);
+        HG_ASSERT(data.is<StringView>());
+        StringView str = data.get<StringView>();
+        *val = {str.chars, str.length};
+    }
+}
 
 static void serialBinWriteNode(BinaryBuilder* bin, u32 idx, SerialNode* node);
 
@@ -349,12 +693,7 @@ BinaryView writeSerialBinary(Arena* arena, Serializer* serial)
 {
     BinaryBuilder bin{arena, sizeof(SerialBinHeader)};
 
-    SerialBinHeader header{};
-    memcpy(header.tag, serialBinTag, sizeof(serialBinTag));
-    header.versionMajor = serialBinVersionMajor;
-    header.versionMinor = serialBinVersionMinor;
-    header.versionPatch = serialBinVersionPatch;
-    header.nodeBegin = static_cast<u32>(bin.size);
+    SerialBinHeader header = serialBinMakeHeader();
     bin.overwrite(0, header);
 
     bin.resize(bin.size + sizeof(SerialBinNode));
@@ -406,25 +745,9 @@ static void serialBinReadNode(BinaryView bin, u32 idx, Serializer* s)
 
 Serializer readSerialBinary(Arena* arena, BinaryView bin)
 {
-    SerialBinHeader header = bin.read<SerialBinHeader>(0);
-
-    if (memcmp(header.tag, serialBinTag, sizeof(serialBinTag)) != 0)
-    {
-        HG_WARN("Serial binary could not be read, does not have a header\n");
+    SerialBinHeader header{};
+    if (!serialBinReadHeader(bin, &header))
         return {};
-    }
-    else if (header.versionMajor != serialBinVersionMajor)
-    {
-        HG_WARN("Serial binary has wrong major version: %d instead of %d", header.versionMajor, serialBinVersionMajor);
-    }
-    else if (header.versionMinor != serialBinVersionMinor)
-    {
-        HG_WARN("Serial binary has wrong minor version: %d instead of %d", header.versionMinor, serialBinVersionMinor);
-    }
-    else if (header.versionPatch != serialBinVersionPatch)
-    {
-        HG_WARN("Serial binary has wrong patch version: %d instead of %d", header.versionPatch, serialBinVersionPatch);
-    }
 
     Serializer s = serialWriter(arena);
     serialBinReadNode(bin, header.nodeBegin, &s);
@@ -1,5 +1,15 @@
 #include "hg/strings.hpp"
 
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#ifdef HG_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
 namespace hg {
 
 char* cString(Arena* arena, StringView str)
@@ -147,163 +157,1441 @@ bool isFloat(StringView str)
     return hasDigit && (hasDecimal || hasExponent);
 }
 
+// Numbers are converted with the usual fast techniques:
+// - Integers are parsed and formatted eight digits at a time within a u64
+//   (SWAR)
+// - Floats are parsed with the Eisel-Lemire algorithm, which finds the
+//   correctly rounded double from one or two 64x64 bit multiplications by a
+//   truncated 128 bit power of five
+// - Floats are formatted with Ryu, which finds the shortest decimal that
+//   rounds back to the same double
+//
+// The power of five tables both algorithms need are computed exactly with a
+// small big integer the first time they are used, rather than being embedded
+
+struct FloatUint128 {
+    u64 lo = 0;
+    u64 hi = 0;
+};
+
+static u64 floatMul128(u64 a, u64 b, u64* hi)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128;
+    u128 product = static_cast<u128>(a) * b;
+    *hi = static_cast<u64>(product >> 64);
+    return static_cast<u64>(product);
+#else
+    u64 aLo = a & 0xffffffff;
+    u64 aHi = a >> 32;
+    u64 bLo = b & 0xffffffff;
+    u64 bHi = b >> 32;
+
+    u64 ll = aLo * bLo;
+    u64 lh = aLo * bHi;
+    u64 hl = aHi * bLo;
+    u64 hh = aHi * bHi;
+
+    u64 mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return (mid << 32) | (ll & 0xffffffff);
+#endif
+}
+
+struct FloatBigInt {
+    static constexpr u32 maxLimbs = 36;
+
+    u32 limbs[maxLimbs] = {};
+    u32 count = 0;
+
+    u32 bitLength() const
+    {
+        if (count == 0)
+            return 0;
+        return 32 * (count - 1) + static_cast<u32>(std::bit_width(limbs[count - 1]));
+    }
+
+    bool bit(i64 idx) const
+    {
+        if (idx < 0 || idx >= 32 * static_cast<i64>(count))
+            return false;
+        return (limbs[idx / 32] >> (idx % 32)) & 1;
+    }
+
+    void mulSmall(u32 factor)
+    {
+        u64 carry = 0;
+        for (u32 i = 0; i < count; ++i)
+        {
+            u64 product = static_cast<u64>(limbs[i]) * factor + carry;
+            limbs[i] = static_cast<u32>(product);
+            carry = product >> 32;
+        }
+        if (carry != 0)
+        {
+            HG_ASSERT(count < maxLimbs);
+            limbs[count++] = static_cast<u32>(carry);
+        }
+    }
+
+    void shiftLeftOne()
+    {
+        u32 carry = 0;
+        for (u32 i = 0; i < count; ++i)
+        {
+            u32 next = limbs[i] >> 31;
+            limbs[i] = (limbs[i] << 1) | carry;
+            carry = next;
+        }
+        if (carry != 0)
+        {
+            HG_ASSERT(count < maxLimbs);
+            limbs[count++] = carry;
+        }
+    }
+
+    bool lessThan(const FloatBigInt& other) const
+    {
+        if (count != other.count)
+            return count < other.count;
+        for (u32 i = count; i > 0; --i)
+        {
+            if (limbs[i - 1] != other.limbs[i - 1])
+                return limbs[i - 1] < other.limbs[i - 1];
+        }
+        return false;
+    }
+
+    void subtract(const FloatBigInt& other)
+    {
+        u64 borrow = 0;
+        for (u32 i = 0; i < count; ++i)
+        {
+            u64 sub = static_cast<u64>(i < other.count ? other.limbs[i] : 0) + borrow;
+            borrow = limbs[i] < sub;
+            limbs[i] = static_cast<u32>(static_cast<u64>(limbs[i]) - sub);
+        }
+        while (count > 0 && limbs[count - 1] == 0)
+        {
+            --count;
+        }
+    }
+
+    // Set this to val << shift
+    void setShifted(u64 val, u32 shift)
+    {
+        HG_ASSERT(shift / 32 + 3 <= maxLimbs);
+        u32 offset = shift % 32;
+        u64 low = val << offset;
+        u64 high = offset == 0 ? 0 : val >> (64 - offset);
+
+        count = shift / 32;
+        for (u32 i = 0; i < count; ++i)
+        {
+            limbs[i] = 0;
+        }
+        limbs[count++] = static_cast<u32>(low);
+        limbs[count++] = static_cast<u32>(low >> 32);
+        limbs[count++] = static_cast<u32>(high);
+        while (count > 0 && limbs[count - 1] == 0)
+        {
+            --count;
+        }
+    }
+
+    // Divide this in place, returning the remainder
+    u32 divSmall(u32 divisor)
+    {
+        u64 rem = 0;
+        for (u32 i = count; i > 0; --i)
+        {
+            u64 cur = (rem << 32) | limbs[i - 1];
+            limbs[i - 1] = static_cast<u32>(cur / divisor);
+            rem = cur % divisor;
+        }
+        while (count > 0 && limbs[count - 1] == 0)
+        {
+            --count;
+        }
+        return static_cast<u32>(rem);
+    }
+
+    // Remove and return the bits from idx up, which must fit in 32 bits
+    u32 takeAbove(u32 idx)
+    {
+        u32 limb = idx / 32;
+        u32 offset = idx % 32;
+        if (limb >= count)
+            return 0;
+        HG_ASSERT(limb + 2 >= count);
+
+        u64 window = limbs[limb];
+        if (limb + 1 < count)
+            window |= static_cast<u64>(limbs[limb + 1]) << 32;
+        u32 ret = static_cast<u32>(window >> offset);
+
+        limbs[limb] &= ((u32)1 << offset) - 1;
+        count = limb + 1;
+        while (count > 0 && limbs[count - 1] == 0)
+        {
+            --count;
+        }
+        return ret;
+    }
+
+    // Whether any bit below idx is set
+    bool anyBelow(u32 idx) const
+    {
+        for (u32 i = 0; i < idx / 32 && i < count; ++i)
+        {
+            if (limbs[i] != 0)
+                return true;
+        }
+        return idx / 32 < count && (limbs[idx / 32] & (((u32)1 << (idx % 32)) - 1)) != 0;
+    }
+
+    // The 128 bits of this starting at bit shift, which may be negative
+    FloatUint128 bits128(i64 shift) const
+    {
+        FloatUint128 ret{};
+        for (i64 i = 0; i < 64; ++i)
+        {
+            ret.lo |= static_cast<u64>(bit(shift + i)) << i;
+            ret.hi |= static_cast<u64>(bit(shift + 64 + i)) << i;
+        }
+        return ret;
+    }
+
+    // floor(2^exponent / this), which must be less than 2^128
+    FloatUint128 divideInto(u32 exponent) const
+    {
+        FloatBigInt rem{};
+        if (exponent >= 128)
+        {
+            rem.count = (exponent - 128) / 32 + 1;
+            rem.limbs[rem.count - 1] = (u32)1 << ((exponent - 128) % 32);
+        }
+
+        FloatUint128 ret{};
+        for (u32 k = 128; k > 0; --k)
+        {
+            rem.shiftLeftOne();
+            if (k - 1 == exponent)
+            {
+                if (rem.count == 0)
+                    rem.count = 1;
+                rem.limbs[0] |= 1;
+            }
+            if (!rem.lessThan(*this))
+            {
+                rem.subtract(*this);
+                if (k - 1 >= 64)
+                    ret.hi |= (u64)1 << (k - 1 - 64);
+                else
+                    ret.lo |= (u64)1 << (k - 1);
+            }
+        }
+        return ret;
+    }
+};
+
+static constexpr i32 lemireMinPower = -342;
+static constexpr i32 lemireMaxPower = 308;
+static constexpr u32 ryuPow5Count = 326;
+static constexpr u32 ryuInvPow5Count = 342;
+static constexpr i32 ryuPow5Bits = 125;
+static constexpr i32 ryuInvPow5Bits = 125;
+
+struct FloatTables {
+    // 5^q normalized to 128 bits, truncated, and for negative q the
+    // reciprocal, rounded up for q >= -27 where it can be exact
+    FloatUint128 lemire[lemireMaxPower - lemireMinPower + 1];
+    // 5^i normalized to ryuPow5Bits bits
+    FloatUint128 ryuPow5[ryuPow5Count];
+    // 2^(bitLength(5^i) - 1 + ryuInvPow5Bits) / 5^i, rounded up
+    FloatUint128 ryuInvPow5[ryuInvPow5Count];
+
+    FloatTables()
+    {
+        FloatBigInt pow5{};
+        pow5.limbs[0] = 1;
+        pow5.count = 1;
+        for (u32 i = 0; i < ryuInvPow5Count + 1; ++i)
+        {
+            i64 length = pow5.bitLength();
+
+            if (i <= static_cast<u32>(lemireMaxPower))
+                lemire[static_cast<i32>(i) - lemireMinPower] = pow5.bits128(length - 128);
+
+            if (i > 0 && i <= static_cast<u32>(-lemireMinPower))
+            {
+                FloatUint128 inv = pow5.divideInto(static_cast<u32>(length + 127));
+                if (i <= 27)
+                {
+                    if (++inv.lo == 0)
+                        ++inv.hi;
+                }
+                lemire[-static_cast<i32>(i) - lemireMinPower] = inv;
+            }
+
+            if (i < ryuPow5Count)
+                ryuPow5[i] = pow5.bits128(length - ryuPow5Bits);
+
+            if (i < ryuInvPow5Count)
+            {
+                FloatUint128 inv = pow5.divideInto(static_cast<u32>(length - 1 + ryuInvPow5Bits));
+                if (++inv.lo == 0)
+                    ++inv.hi;
+                ryuInvPow5[i] = inv;
+            }
+
+            pow5.mulSmall(5);
+        }
+    }
+};
+
+static const FloatTables& floatTables()
+{
+    static const FloatTables tables{};
+    return tables;
+}
+
+static constexpr f64 floatExactPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static constexpr u64 integerPow10[] = {
+    1ull,
+    10ull,
+    100ull,
+    1000ull,
+    10000ull,
+    100000ull,
+    1000000ull,
+    10000000ull,
+    100000000ull,
+    1000000000ull,
+    10000000000ull,
+    100000000000ull,
+    1000000000000ull,
+    10000000000000ull,
+    100000000000000ull,
+    1000000000000000ull,
+    10000000000000000ull,
+    100000000000000000ull,
+    1000000000000000000ull,
+    10000000000000000000ull,
+};
+
+static u32 decimalLength(u64 val)
+{
+    u32 length = 1;
+    while (length < 20 && val >= integerPow10[length])
+    {
+        ++length;
+    }
+    return length;
+}
+
+static bool swarIsEightDigits(const char* chars)
+{
+    u64 val;
+    memcpy(&val, chars, 8);
+    return ((val & 0xf0f0f0f0f0f0f0f0) | (((val + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) >> 4)) == 0x3333333333333333;
+}
+
+static u64 swarParseEightDigits(const char* chars)
+{
+    u64 val;
+    memcpy(&val, chars, 8);
+    val -= 0x3030303030303030;
+    val = (val * 10) + (val >> 8);
+    val = (((val & 0x000000ff000000ff) * (100 + (1000000ull << 32)))
+        + (((val >> 16) & 0x000000ff000000ff) * (1 + (10000ull << 32)))) >> 32;
+    return val & 0xffffffff;
+}
+
+static void swarFormatEightDigits(char* chars, u64 val)
+{
+    HG_ASSERT(val < 100000000);
+
+    // Split into two four digit lanes, then each lane into two two digit
+    // lanes, then each of those into digits, dividing with multiply-shifts
+    u64 merged = (val / 10000) | ((val % 10000) << 32);
+    u64 top = ((merged * 10486) >> 20) & ((0x7full << 32) | 0x7full);
+    u64 bottom = merged - 100 * top;
+    u64 hundreds = (bottom << 16) + top;
+    u64 tens = ((hundreds * 103) >> 10) & ((0xfull << 48) | (0xfull << 32) | (0xfull << 16) | 0xfull);
+    tens += (hundreds - 10 * tens) << 8;
+    tens += 0x3030303030303030;
+    memcpy(chars, &tens, 8);
+}
+
+// Write the low length digits of val, zero padded
+static void formatDigits(char* chars, u64 val, u32 length)
+{
+    while (length >= 8)
+    {
+        swarFormatEightDigits(chars + length - 8, val % 100000000);
+        val /= 100000000;
+        length -= 8;
+    }
+    if (length > 0)
+    {
+        char last[8];
+        swarFormatEightDigits(last, val % 100000000);
+        memcpy(chars, last + 8 - length, length);
+    }
+}
+
+// Returns the number of chars written, at most 20
+static u32 formatInteger(char* chars, i64 num)
+{
+    u32 head = 0;
+    u64 unum = static_cast<u64>(num);
+    if (num < 0)
+    {
+        chars[head++] = '-';
+        unum = 0 - unum;
+    }
+
+    u32 length = decimalLength(unum);
+    formatDigits(chars + head, unum, length);
+    return head + length;
+}
+
+static u64 lemireCompute(i64 q, u64 w)
+{
+    static constexpr u32 mantissaBits = 52;
+    static constexpr i32 infinitePower = 0x7ff;
+
+    if (w == 0 || q < lemireMinPower)
+        return 0;
+    if (q > lemireMaxPower)
+        return static_cast<u64>(infinitePower) << mantissaBits;
+
+    i32 lz = std::countl_zero(w);
+    w <<= lz;
+
+    const FloatUint128& pow5 = floatTables().lemire[q - lemireMinPower];
+
+    // The first product is enough unless the bits below the mantissa are all
+    // ones, in which case the low half of the power may carry into them
+    u64 productHi;
+    u64 productLo = floatMul128(w, pow5.hi, &productHi);
+    static constexpr u64 precisionMask = 0xffffffffffffffff >> (mantissaBits + 3);
+    if ((productHi & precisionMask) == precisionMask)
+    {
+        u64 secondHi;
+        floatMul128(w, pow5.lo, &secondHi);
+        productLo += secondHi;
+        if (secondHi > productLo)
+            ++productHi;
+    }
+
+    i32 upperBit = static_cast<i32>(productHi >> 63);
+    i32 shift = upperBit + 64 - static_cast<i32>(mantissaBits) - 3;
+    u64 mantissa = productHi >> shift;
+    i32 power2 = ((((152170 + 65536) * static_cast<i32>(q)) >> 16) + 63) + upperBit - lz + 1023;
+
+    if (power2 <= 0)
+    {
+        if (-power2 + 1 >= 64)
+            return 0;
+
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        return mantissa;
+    }
+
+    // Exactly halfway between two doubles, round to even
+    if (productLo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == productHi)
+        mantissa &= ~(u64)1;
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (u64)2 << mantissaBits)
+    {
+        mantissa = (u64)1 << mantissaBits;
+        ++power2;
+    }
+    mantissa &= ~((u64)1 << mantissaBits);
+
+    if (power2 >= infinitePower)
+        return static_cast<u64>(infinitePower) << mantissaBits;
+
+    return mantissa | (static_cast<u64>(power2) << mantissaBits);
+}
+
 i64 stringToInteger(StringView str)
 {
     HG_ASSERT(isInteger(str));
 
-    i64 power = 1;
-    i64 ret = 0;
+    const char* head = str.chars;
+    const char* end = str.chars + str.length;
 
-    u64 head = str.length - 1;
-    while (head > 0)
+    bool isNegative = *head == '-';
+    if (isNegative || *head == '+')
+        ++head;
+
+    u64 ret = 0;
+    while (end - head >= 8)
     {
-            ret += static_cast<i64>(str[head] - '0') * power;
-        power *= 10;
-        --head;
+        ret = ret * 100000000 + swarParseEightDigits(head);
+        head += 8;
     }
-
-    if (str[head] != '+')
+    while (head < end)
     {
-        if (str[head] == '-')
-            ret *= -1;
-        else
-        ret += static_cast<i64>(str[head] - '0') * power;
+        ret = ret * 10 + static_cast<u64>(*head - '0');
+        ++head;
     }
 
-    return ret;
+    return static_cast<i64>(isNegative ? 0 - ret : ret);
 }
 
 f64 stringToFloat(StringView str)
 {
     HG_ASSERT(isFloat(str));
 
-    f64 ret = 0.0;
-    u64 head = 0;
+    static constexpr u32 maxDigits = 19;
+
+    const char* head = str.chars;
+    const char* end = str.chars + str.length;
 
-    bool isNegative = str[head] == '-';
-    if (isNegative || str[head] == '+')
+    bool isNegative = *head == '-';
+    if (isNegative || *head == '+')
         ++head;
 
-    if (isNumeral(str[head]))
+    // Gather up to 19 significant digits, the rest only move the exponent
+    u64 digits = 0;
+    u32 digitCount = 0;
+    i64 exp = 0;
+    bool truncated = false;
+
+    while (head < end && *head == '0')
     {
-        u64 intPartBegin = head;
-        while (head < str.length && str[head] != '.' && str[head] != 'e')
+        ++head;
+    }
+    while (end - head >= 8 && digitCount + 8 <= maxDigits && swarIsEightDigits(head))
+    {
+        digits = digits * 100000000 + swarParseEightDigits(head);
+        digitCount += 8;
+        head += 8;
+    }
+    while (head < end && isNumeral(*head))
+    {
+        if (digitCount < maxDigits)
         {
-            ++head;
+            digits = digits * 10 + static_cast<u64>(*head - '0');
+            ++digitCount;
+        }
+        else
+        {
+            ++exp;
+            truncated = truncated || *head != '0';
         }
-        ret += static_cast<f64>(stringToInteger({&str[intPartBegin], &str[head]}));
+        ++head;
     }
 
-    if (head < str.length && str[head] == '.')
+    if (head < end && *head == '.')
     {
         ++head;
 
-        f64 power = 0.1;
-        while (head < str.length && isNumeral(str[head]))
+        if (digitCount == 0)
+        {
+            while (head < end && *head == '0')
+            {
+                --exp;
+                ++head;
+            }
+        }
+        while (end - head >= 8 && digitCount + 8 <= maxDigits && swarIsEightDigits(head))
+        {
+            digits = digits * 100000000 + swarParseEightDigits(head);
+            digitCount += 8;
+            exp -= 8;
+            head += 8;
+        }
+        while (head < end && isNumeral(*head))
         {
-            ret += static_cast<f64>(str[head] - '0') * power;
-            power *= 0.1;
+            if (digitCount < maxDigits)
+            {
+                digits = digits * 10 + static_cast<u64>(*head - '0');
+                ++digitCount;
+                --exp;
+            }
+            else
+            {
+                truncated = truncated || *head != '0';
+            }
             ++head;
         }
     }
 
-    if (head < str.length && str[head] == 'e')
+    if (head < end && *head == 'e')
     {
         ++head;
 
-        bool expIsNegative = str[head] == '-';
-        if (expIsNegative || str[head] == '+')
+        bool expIsNegative = *head == '-';
+        if (expIsNegative || *head == '+')
             ++head;
 
-        u64 expBegin = head;
-        while (head < str.length && isNumeral(str[head]))
+        i64 exponent = 0;
+        while (head < end && isNumeral(*head))
         {
+            if (exponent < 100000)
+                exponent = exponent * 10 + (*head - '0');
             ++head;
         }
+        exp += expIsNegative ? -exponent : exponent;
+    }
 
-        i64 exp = stringToInteger({&str[expBegin], str.chars + head});
-        if (exp != 0)
+    f64 ret;
+    if (digits == 0)
+    {
+        ret = 0.0;
+    }
+    else if (!truncated && exp >= -22 && exp <= 22 && digits <= (u64)1 << 53)
+    {
+        // Both operands are exact, so one correctly rounded operation is
+        // the correctly rounded result
+        ret = exp < 0
+            ? static_cast<f64>(digits) / floatExactPow10[-exp]
+            : static_cast<f64>(digits) * floatExactPow10[exp];
+    }
+    else
+    {
+        u64 bits = lemireCompute(exp, digits);
+        if (truncated && bits != lemireCompute(exp, digits + 1))
         {
-            if (expIsNegative)
+            // The dropped digits decide the rounding, rare enough to hand off
+            ArenaScope scratch = getScratch();
+            return strtod(cString(scratch, str), nullptr);
+        }
+        memcpy(&ret, &bits, sizeof(ret));
+    }
+
+    return isNegative ? -ret : ret;
+}
+
+// The shortest decimal mantissa and exponent that round to a double
+struct FloatDecimal {
+    u64 mantissa = 0;
+    i32 exponent = 0;
+};
+
+static u64 ryuMulShift(u64 m, const FloatUint128& mul, i32 j)
+{
+    u64 high1;
+    u64 low1 = floatMul128(m, mul.hi, &high1);
+    u64 high0;
+    floatMul128(m, mul.lo, &high0);
+    u64 sum = high0 + low1;
+    if (sum < high0)
+        ++high1;
+
+    HG_ASSERT(j >= 64 && j < 128);
+    u32 dist = static_cast<u32>(j - 64);
+    return dist == 0 ? sum : (high1 << (64 - dist)) | (sum >> dist);
+}
+
+static u32 ryuPow5Factor(u64 val)
+{
+    u32 count = 0;
+    while (val % 5 == 0)
+    {
+        val /= 5;
+        ++count;
+    }
+    return count;
+}
+
+static i32 ryuPow5Length(i32 e)
+{
+    return static_cast<i32>((static_cast<u32>(e) * 1217359) >> 19) + 1;
+}
+
+static u32 ryuLog10Pow2(i32 e)
+{
+    return (static_cast<u32>(e) * 78913) >> 18;
+}
+
+static u32 ryuLog10Pow5(i32 e)
+{
+    return (static_cast<u32>(e) * 732923) >> 20;
+}
+
+static FloatDecimal ryuShortest(u64 ieeeMantissa, u32 ieeeExponent)
+{
+    const FloatTables& tables = floatTables();
+
+    // Work with two extra bits so the bounds halfway to the neighboring
+    // doubles are integers
+    i32 e2;
+    u64 m2;
+    if (ieeeExponent == 0)
+    {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieeeMantissa;
+    }
+    else
+    {
+        e2 = static_cast<i32>(ieeeExponent) - 1023 - 52 - 2;
+        m2 = ((u64)1 << 52) | ieeeMantissa;
+    }
+    bool acceptBounds = (m2 & 1) == 0;
+
+    u64 mv = 4 * m2;
+    u32 mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+
+    // Scale the value and its bounds to a decimal exponent
+    u64 vr;
+    u64 vp;
+    u64 vm;
+    i32 e10;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+    if (e2 >= 0)
+    {
+        u32 q = ryuLog10Pow2(e2) - (e2 > 3);
+        e10 = static_cast<i32>(q);
+        i32 k = ryuInvPow5Bits + ryuPow5Length(static_cast<i32>(q)) - 1;
+        i32 i = -e2 + static_cast<i32>(q) + k;
+        const FloatUint128& mul = tables.ryuInvPow5[q];
+        vr = ryuMulShift(4 * m2, mul, i);
+        vp = ryuMulShift(4 * m2 + 2, mul, i);
+        vm = ryuMulShift(4 * m2 - 1 - mmShift, mul, i);
+        if (q <= 21)
+        {
+            if (mv % 5 == 0)
+                vrIsTrailingZeros = ryuPow5Factor(mv) >= q;
+            else if (acceptBounds)
+                vmIsTrailingZeros = ryuPow5Factor(mv - 1 - mmShift) >= q;
+            else
+                vp -= ryuPow5Factor(mv + 2) >= q;
+        }
+    }
+    else
+    {
+        u32 q = ryuLog10Pow5(-e2) - (-e2 > 1);
+        e10 = static_cast<i32>(q) + e2;
+        i32 i = -e2 - static_cast<i32>(q);
+        i32 k = ryuPow5Length(i) - ryuPow5Bits;
+        i32 j = static_cast<i32>(q) - k;
+        const FloatUint128& mul = tables.ryuPow5[i];
+        vr = ryuMulShift(4 * m2, mul, j);
+        vp = ryuMulShift(4 * m2 + 2, mul, j);
+        vm = ryuMulShift(4 * m2 - 1 - mmShift, mul, j);
+        if (q <= 1)
+        {
+            vrIsTrailingZeros = true;
+            if (acceptBounds)
+                vmIsTrailingZeros = mmShift == 1;
+            else
+                --vp;
+        }
+        else if (q < 63)
+        {
+            vrIsTrailingZeros = (mv & (((u64)1 << q) - 1)) == 0;
+        }
+    }
+
+    // Remove digits while the bounds still differ
+    i32 removed = 0;
+    u64 output;
+    if (vmIsTrailingZeros || vrIsTrailingZeros)
+    {
+        u64 lastRemovedDigit = 0;
+        while (vp / 10 > vm / 10)
+        {
+            vmIsTrailingZeros = vmIsTrailingZeros && vm % 10 == 0;
+            vrIsTrailingZeros = vrIsTrailingZeros && lastRemovedDigit == 0;
+            lastRemovedDigit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        if (vmIsTrailingZeros)
+        {
+            while (vm % 10 == 0)
             {
-                for (i64 i = 0; i < exp; ++i)
-                {
-                    ret *= 0.1;
-                }
-            } else {
-                for (i64 i = 0; i < exp; ++i)
-                {
-                    ret *= 10.0;
-                }
+                vrIsTrailingZeros = vrIsTrailingZeros && lastRemovedDigit == 0;
+                lastRemovedDigit = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
             }
-        } else {
-            ret = 1.0;
         }
-    }
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+            lastRemovedDigit = 4;
 
-    if (isNegative)
-        ret *= -1.0;
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+    }
+    else
+    {
+        bool roundUp = false;
+        if (vp / 100 > vm / 100)
+        {
+            roundUp = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10)
+        {
+            roundUp = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        output = vr + (vr == vm || roundUp);
+    }
 
-    return ret;
+    return {output, e10 + removed};
 }
 
-StringBuilder integerToString(Arena* arena, i64 num)
+// Returns the number of chars written, at most 32
+static u32 formatFloat(char* chars, f64 num)
 {
-    HG_ASSERT(arena != nullptr);
+    u64 bits;
+    memcpy(&bits, &num, sizeof(bits));
+    u64 ieeeMantissa = bits & (((u64)1 << 52) - 1);
+    u32 ieeeExponent = static_cast<u32>((bits >> 52) & 0x7ff);
 
-    ArenaScope scratch = getScratch(&arena, 1);
+    if (ieeeExponent == 0x7ff && ieeeMantissa != 0)
+    {
+        memcpy(chars, "nan", 3);
+        return 3;
+    }
+
+    u32 head = 0;
+    if (bits >> 63)
+        chars[head++] = '-';
+
+    if (ieeeExponent == 0x7ff)
+    {
+        memcpy(chars + head, "inf", 3);
+        return head + 3;
+    }
+    if (ieeeExponent == 0 && ieeeMantissa == 0)
+    {
+        memcpy(chars + head, "0.0", 3);
+        return head + 3;
+    }
 
-    if (num == 0)
-        return {arena, "0"};
+    FloatDecimal dec = ryuShortest(ieeeMantissa, ieeeExponent);
+    u32 length = decimalLength(dec.mantissa);
+    i32 sciExp = dec.exponent + static_cast<i32>(length) - 1;
 
-    bool isNegative = num < 0;
-    u64 unum = static_cast<u64>(std::abs(num));
+    if (sciExp >= -5 && sciExp <= 16)
+    {
+        if (dec.exponent >= 0)
+        {
+            // 1230.0
+            formatDigits(chars + head, dec.mantissa, length);
+            head += length;
+            memset(chars + head, '0', static_cast<u64>(dec.exponent));
+            head += static_cast<u32>(dec.exponent);
+            memcpy(chars + head, ".0", 2);
+            head += 2;
+        }
+        else if (sciExp >= 0)
+        {
+            // 12.3
+            u32 intLength = static_cast<u32>(sciExp) + 1;
+            formatDigits(chars + head + 1, dec.mantissa, length);
+            memmove(chars + head, chars + head + 1, intLength);
+            chars[head + intLength] = '.';
+            head += length + 1;
+        }
+        else
+        {
+            // 0.00123
+            u32 zeros = static_cast<u32>(-sciExp) - 1;
+            memcpy(chars + head, "0.", 2);
+            head += 2;
+            memset(chars + head, '0', zeros);
+            head += zeros;
+            formatDigits(chars + head, dec.mantissa, length);
+            head += length;
+        }
+        return head;
+    }
 
-    StringBuilder reverse{scratch};
-    while (unum != 0)
+    // 1.23e-45
+    formatDigits(chars + head + 1, dec.mantissa, length);
+    chars[head] = chars[head + 1];
+    if (length > 1)
+    {
+        chars[head + 1] = '.';
+        head += length + 1;
+    }
+    else
     {
-        u64 digit = unum % 10;
-        unum /= 10;
-        reverse.append('0' + static_cast<char>(digit));
+        head += 1;
     }
 
-    StringBuilder ret{arena};
-    if (isNegative)
-        ret.append('-');
-    for (u64 i = reverse.length - 1; i < reverse.length; --i)
+    chars[head++] = 'e';
+    if (sciExp < 0)
     {
-        ret.append(reverse[i]);
+        chars[head++] = '-';
+        sciExp = -sciExp;
     }
-    return ret;
+    u32 expLength = decimalLength(static_cast<u64>(sciExp));
+    formatDigits(chars + head, static_cast<u64>(sciExp), expLength);
+    return head + expLength;
 }
 
-StringBuilder floatToString(Arena* arena, f64 num, u32 decimalCount)
+StringBuilder integerToString(Arena* arena, i64 num)
 {
     HG_ASSERT(arena != nullptr);
 
-    ArenaScope scratch = getScratch(&arena, 1);
+    char chars[20];
+    u32 length = formatInteger(chars, num);
+    return {arena, {chars, length}};
+}
+
+StringBuilder floatToString(Arena* arena, f64 num)
+{
+    HG_ASSERT(arena != nullptr);
+
+    char chars[32];
+    u32 length = formatFloat(chars, num);
+    return {arena, {chars, length}};
+}
+
+StringBuilder floatToString(Arena* arena, f64 num, u32 decimalCount)
+{
+    HG_ASSERT(arena != nullptr);
 
     if (num == 0.0)
         return {arena, "0.0"};
+    if (std::isinf(num))
+        return {arena, num < 0.0 ? "-inf" : "inf"};
+    if (std::isnan(num))
+        return {arena, "nan"};
 
-    StringBuilder intStr = integerToString(scratch, static_cast<i64>(std::abs(num)));
-
-    StringBuilder decStr{scratch};
-    decStr.append('.');
+    // The float is exactly mantissa * 2^exponent, so the digits are taken
+    // from that with integers only, and the remainder below the last decimal
+    // rounds half to even, the same as printf
+    u64 bits;
+    memcpy(&bits, &num, sizeof(bits));
+    u32 ieeeExponent = static_cast<u32>(bits >> 52) & 0x7ff;
+    u64 mantissa = bits & (((u64)1 << 52) - 1);
+    i32 exponent = -1074;
+    if (ieeeExponent != 0)
+    {
+        mantissa |= (u64)1 << 52;
+        exponent = static_cast<i32>(ieeeExponent) - 1075;
+    }
 
-    f64 decPart = std::abs(num);
-    for (u64 i = 0; i < decimalCount; ++i)
+    if (exponent > -64 && exponent < 12 && decimalCount <= 19)
     {
-        decPart *= 10.0;
-        decStr.append('0' + static_cast<char>(static_cast<u64>(decPart) % 10));
+        // The integer part fits in a u64, and the fraction times
+        // 10^decimalCount in 128 bits
+        u64 intPart = exponent >= 0 ? mantissa << exponent : 0;
+        u64 decPart = 0;
+        if (exponent < 0)
+        {
+            u32 shift = static_cast<u32>(-exponent);
+            u64 mask = ((u64)1 << shift) - 1;
+            intPart = mantissa >> shift;
+
+            u64 hi;
+            u64 lo = floatMul128(mantissa & mask, integerPow10[decimalCount], &hi);
+            decPart = (lo >> shift) | (hi << (64 - shift));
+
+            u64 rem = lo & mask;
+            u64 half = (u64)1 << (shift - 1);
+            bool odd = ((decimalCount > 0 ? decPart : intPart) & 1) != 0;
+            if (rem > half || (rem == half && odd))
+            {
+                if (++decPart == integerPow10[decimalCount])
+                {
+                    decPart = 0;
+                    ++intPart;
+                }
+            }
+        }
+
+        char chars[48];
+        u32 head = 0;
+        if (num < 0.0)
+            chars[head++] = '-';
+        u32 intLength = decimalLength(intPart);
+        formatDigits(chars + head, intPart, intLength);
+        head += intLength;
+        chars[head++] = '.';
+        formatDigits(chars + head, decPart, decimalCount);
+        head += decimalCount;
+        return {arena, {chars, head}};
     }
 
+    ArenaScope scratch = getScratch(&arena, 1);
+
     StringBuilder ret{arena};
     if (num < 0.0)
         ret.append('-');
-    ret.append(intStr);
-    ret.append(decStr);
+
+    if (exponent >= 0)
+    {
+        // A whole number beyond a u64, printed 9 digits at a time
+        FloatBigInt val{};
+        val.setShifted(mantissa, static_cast<u32>(exponent));
+
+        char chars[320];
+        u32 begin = sizeof(chars);
+        while (val.count > 0)
+        {
+            begin -= 9;
+            formatDigits(chars + begin, val.divSmall(1000000000), 9);
+        }
+        while (chars[begin] == '0')
+        {
+            ++begin;
+        }
+        ret.append({chars + begin, sizeof(chars) - begin});
+        ret.append('.');
+        for (u32 i = 0; i < decimalCount; ++i)
+        {
+            ret.append('0');
+        }
+        return ret;
+    }
+
+    // The fraction is shift bits wide, so each decimal is the bits above it
+    // after a multiply by ten
+    u32 shift = static_cast<u32>(-exponent);
+    u64 intPart = shift < 64 ? mantissa >> shift : 0;
+    FloatBigInt fraction{};
+    fraction.setShifted(shift < 64 ? mantissa & (((u64)1 << shift) - 1) : mantissa, 0);
+
+    StringBuilder decimals{scratch};
+    for (u32 i = 0; i < decimalCount; ++i)
+    {
+        fraction.mulSmall(10);
+        decimals.append('0' + static_cast<char>(fraction.takeAbove(shift)));
+    }
+
+    bool odd = ((decimalCount > 0 ? static_cast<u64>(decimals[decimalCount - 1] - '0') : intPart) & 1) != 0;
+    if (fraction.bit(shift - 1) && (fraction.anyBelow(shift - 1) || odd))
+    {
+        u64 i = decimalCount;
+        while (i > 0 && decimals[i - 1] == '9')
+        {
+            decimals[--i] = '0';
+        }
+        if (i > 0)
+            ++decimals[i - 1];
+        else
+            ++intPart;
+    }
+
+    char chars[20];
+    u32 intLength = decimalLength(intPart);
+    formatDigits(chars, intPart, intLength);
+    ret.append({chars, intLength});
+    ret.append('.');
+    ret.append(decimals);
     return ret;
 }
 
+// Text scanning handles 16 bytes per step with SSE2, which every x86-64
+// target has. Full UTF-8 validation needs byte shuffles, so it uses SSSE3
+// when the CPU supports it, checked once at runtime.
+
+static u32 simdMask(__m128i bytes)
+{
+    return static_cast<u32>(_mm_movemask_epi8(bytes));
+}
+
+static __m128i simdLoad(const char* chars)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars));
+}
+
+bool isAscii(StringView str)
+{
+    u64 head = 0;
+    __m128i bits = _mm_setzero_si128();
+    for (; head + 16 <= str.length; head += 16)
+    {
+        bits = _mm_or_si128(bits, simdLoad(str.chars + head));
+    }
+    if (simdMask(bits) != 0)
+        return false;
+
+    for (; head < str.length; ++head)
+    {
+        if (static_cast<u8>(str.chars[head]) >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+u32 utf8Next(StringView str, u64* head)
+{
+    HG_ASSERT(head != nullptr);
+    HG_ASSERT(*head < str.length);
+
+    const u8* bytes = reinterpret_cast<const u8*>(str.chars) + *head;
+    u64 available = str.length - *head;
+
+    u32 lead = bytes[0];
+    if (lead < 0x80)
+    {
+        *head += 1;
+        return lead;
+    }
+
+    u32 length;
+    u32 codepoint;
+    u32 min;
+    if (lead >= 0xc2 && lead <= 0xdf)
+    {
+        length = 2;
+        codepoint = lead & 0x1f;
+        min = 0x80;
+    }
+    else if (lead >= 0xe0 && lead <= 0xef)
+    {
+        length = 3;
+        codepoint = lead & 0x0f;
+        min = 0x800;
+    }
+    else if (lead >= 0xf0 && lead <= 0xf4)
+    {
+        length = 4;
+        codepoint = lead & 0x07;
+        min = 0x10000;
+    }
+    else
+    {
+        *head += 1;
+        return utf8Replacement;
+    }
+
+    if (available < length)
+    {
+        *head += 1;
+        return utf8Replacement;
+    }
+
+    for (u32 i = 1; i < length; ++i)
+    {
+        if ((bytes[i] & 0xc0) != 0x80)
+        {
+            *head += 1;
+            return utf8Replacement;
+        }
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3f);
+    }
+
+    if (codepoint < min || codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint <= 0xdfff))
+    {
+        *head += 1;
+        return utf8Replacement;
+    }
+
+    *head += length;
+    return codepoint;
+}
+
+static bool isUtf8Scalar(StringView str)
+{
+    u64 head = 0;
+    while (head < str.length)
+    {
+        u64 begin = head;
+        u32 codepoint = utf8Next(str, &head);
+        if (codepoint == utf8Replacement && head == begin + 1 && static_cast<u8>(str.chars[begin]) >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+// Keiser and Lemire's lookup algorithm: every error in a UTF-8 stream can
+// be recognized from the high and low nibbles of a byte and the high nibble
+// of the byte before it, plus a check that the continuation bytes of 3 and 4
+// byte sequences are present
+#if defined(HG_COMPILER_GCC) || defined(HG_COMPILER_CLANG)
+__attribute__((target("ssse3")))
+#endif
+static bool isUtf8Ssse3(StringView str)
+{
+    static constexpr u8 tooShort = 1 << 0;
+    static constexpr u8 tooLong = 1 << 1;
+    static constexpr u8 overlong3 = 1 << 2;
+    static constexpr u8 tooLarge = 1 << 3;
+    static constexpr u8 surrogate = 1 << 4;
+    static constexpr u8 overlong2 = 1 << 5;
+    static constexpr u8 tooLarge1000 = 1 << 6;
+    static constexpr u8 overlong4 = 1 << 6;
+    static constexpr u8 twoConts = 1 << 7;
+    static constexpr u8 carry = tooShort | tooLong | twoConts;
+
+    const __m128i byte1HighTable = _mm_setr_epi8(
+        tooLong, tooLong, tooLong, tooLong,
+        tooLong, tooLong, tooLong, tooLong,
+        static_cast<char>(twoConts), static_cast<char>(twoConts),
+        static_cast<char>(twoConts), static_cast<char>(twoConts),
+        tooShort | overlong2,
+        tooShort,
+        tooShort | overlong3 | surrogate,
+        static_cast<char>(tooShort | tooLarge | tooLarge1000 | overlong4));
+    const __m128i byte1LowTable = _mm_setr_epi8(
+        static_cast<char>(carry | overlong3 | overlong2 | overlong4),
+        static_cast<char>(carry | overlong2),
+        static_cast<char>(carry),
+        static_cast<char>(carry),
+        static_cast<char>(carry | tooLarge),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000 | surrogate),
+        static_cast<char>(carry | tooLarge | tooLarge1000),
+        static_cast<char>(carry | tooLarge | tooLarge1000));
+    const __m128i byte2HighTable = _mm_setr_epi8(
+        tooShort, tooShort, tooShort, tooShort,
+        tooShort, tooShort, tooShort, tooShort,
+        static_cast<char>(tooLong | overlong2 | twoConts | overlong3 | tooLarge1000 | overlong4),
+        static_cast<char>(tooLong | overlong2 | twoConts | overlong3 | tooLarge),
+        static_cast<char>(tooLong | overlong2 | twoConts | surrogate | tooLarge),
+        static_cast<char>(tooLong | overlong2 | twoConts | surrogate | tooLarge),
+        tooShort, tooShort, tooShort, tooShort);
+    const __m128i incompleteMax = _mm_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1,
+        static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+
+    __m128i error = _mm_setzero_si128();
+    __m128i prev = _mm_setzero_si128();
+    __m128i prevIncomplete = _mm_setzero_si128();
+    for (u64 head = 0; head < str.length; head += 16)
+    {
+        __m128i input;
+        if (head + 16 <= str.length)
+        {
+            input = simdLoad(str.chars + head);
+        }
+        else
+        {
+            // Zero padding is ASCII, so a truncated last sequence is still caught
+            char tail[16] = {};
+            memcpy(tail, str.chars + head, str.length - head);
+            input = simdLoad(tail);
+        }
+
+        if (simdMask(input) == 0)
+        {
+            error = _mm_or_si128(error, prevIncomplete);
+            prev = input;
+            continue;
+        }
+
+        __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+        __m128i byte1High = _mm_shuffle_epi8(byte1HighTable, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+        __m128i byte1Low = _mm_shuffle_epi8(byte1LowTable, _mm_and_si128(prev1, nibble));
+        __m128i byte2High = _mm_shuffle_epi8(byte2HighTable, _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+        __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+        __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+        __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+        __m128i isThird = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+        __m128i isFourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+        __m128i mustContinue = _mm_and_si128(_mm_or_si128(isThird, isFourth), _mm_set1_epi8(static_cast<char>(0x80)));
+
+        error = _mm_or_si128(error, _mm_xor_si128(mustContinue, special));
+        prevIncomplete = _mm_subs_epu8(input, incompleteMax);
+        prev = input;
+    }
+    error = _mm_or_si128(error, prevIncomplete);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+}
+
+static bool cpuHasSsse3()
+{
+#ifdef HG_COMPILER_MSVC
+    i32 info[4];
+    __cpuid(info, 1);
+    return (info[2] >> 9) & 1;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+bool isUtf8(StringView str)
+{
+    static const bool hasSsse3 = cpuHasSsse3();
+    return hasSsse3 ? isUtf8Ssse3(str) : isUtf8Scalar(str);
+}
+
+u64 utf8Length(StringView str)
+{
+    // Continuation bytes are 0x80 to 0xbf, -128 to -65 as signed bytes
+    u64 count = 0;
+    u64 head = 0;
+    __m128i lastContinuation = _mm_set1_epi8(-65);
+    for (; head + 16 <= str.length; head += 16)
+    {
+        count += static_cast<u64>(std::popcount(simdMask(_mm_cmpgt_epi8(simdLoad(str.chars + head), lastContinuation))));
+    }
+    for (; head < str.length; ++head)
+    {
+        count += (static_cast<u8>(str.chars[head]) & 0xc0) != 0x80;
+    }
+    return count;
+}
+
+u64 utf8Decode(StringView str, u32* codepoints)
+{
+    HG_ASSERT(codepoints != nullptr || str.length == 0);
+
+    u64 count = 0;
+    u64 head = 0;
+    while (head < str.length)
+    {
+        // Widen runs of ASCII straight to codepoints
+        while (head + 16 <= str.length)
+        {
+            __m128i input = simdLoad(str.chars + head);
+            if (simdMask(input) != 0)
+                break;
+
+            __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_unpacklo_epi8(input, zero);
+            __m128i hi = _mm_unpackhi_epi8(input, zero);
+            __m128i* out = reinterpret_cast<__m128i*>(codepoints + count);
+            _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+            count += 16;
+            head += 16;
+        }
+        if (head >= str.length)
+            break;
+
+        codepoints[count++] = utf8Next(str, &head);
+    }
+    return count;
+}
+
+u32 utf8Encode(u32 codepoint, char* chars)
+{
+    HG_ASSERT(chars != nullptr);
+
+    if (codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint <= 0xdfff))
+        codepoint = utf8Replacement;
+
+    if (codepoint < 0x80)
+    {
+        chars[0] = static_cast<char>(codepoint);
+        return 1;
+    }
+    if (codepoint < 0x800)
+    {
+        chars[0] = static_cast<char>(0xc0 | (codepoint >> 6));
+        chars[1] = static_cast<char>(0x80 | (codepoint & 0x3f));
+        return 2;
+    }
+    if (codepoint < 0x10000)
+    {
+        chars[0] = static_cast<char>(0xe0 | (codepoint >> 12));
+        chars[1] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+        chars[2] = static_cast<char>(0x80 | (codepoint & 0x3f));
+        return 3;
+    }
+    chars[0] = static_cast<char>(0xf0 | (codepoint >> 18));
+    chars[1] = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+    chars[2] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+    chars[3] = static_cast<char>(0x80 | (codepoint & 0x3f));
+    return 4;
+}
+
+u64 findChar(StringView str, char c, u64 begin)
+{
+    HG_ASSERT(begin <= str.length);
+
+    u64 head = begin;
+    __m128i target = _mm_set1_epi8(c);
+    for (; head + 16 <= str.length; head += 16)
+    {
+        u32 mask = simdMask(_mm_cmpeq_epi8(simdLoad(str.chars + head), target));
+        if (mask != 0)
+            return head + static_cast<u64>(std::countr_zero(mask));
+    }
+    for (; head < str.length; ++head)
+    {
+        if (str.chars[head] == c)
+            return head;
+    }
+    return str.length;
+}
+
+u64 findNewline(StringView str, u64 begin)
+{
+    return findChar(str, '\n', begin);
+}
+
+static __m128i simdWhitespace(__m128i input)
+{
+    __m128i space = _mm_cmpeq_epi8(input, _mm_set1_epi8(' '));
+    __m128i tab = _mm_cmpeq_epi8(input, _mm_set1_epi8('\t'));
+    __m128i newline = _mm_cmpeq_epi8(input, _mm_set1_epi8('\n'));
+    __m128i ret = _mm_cmpeq_epi8(input, _mm_set1_epi8('\r'));
+    return _mm_or_si128(_mm_or_si128(space, tab), _mm_or_si128(newline, ret));
+}
+
+u64 findWhitespace(StringView str, u64 begin)
+{
+    HG_ASSERT(begin <= str.length);
+
+    u64 head = begin;
+    for (; head + 16 <= str.length; head += 16)
+    {
+        u32 mask = simdMask(simdWhitespace(simdLoad(str.chars + head)));
+        if (mask != 0)
+            return head + static_cast<u64>(std::countr_zero(mask));
+    }
+    for (; head < str.length; ++head)
+    {
+        if (isWhitespace(str.chars[head]))
+            return head;
+    }
+    return str.length;
+}
+
+u64 skipWhitespace(StringView str, u64 begin)
+{
+    HG_ASSERT(begin <= str.length);
+
+    u64 head = begin;
+    for (; head + 16 <= str.length; head += 16)
+    {
+        u32 mask = ~simdMask(simdWhitespace(simdLoad(str.chars + head))) & 0xffff;
+        if (mask != 0)
+            return head + static_cast<u64>(std::countr_zero(mask));
+    }
+    for (; head < str.length; ++head)
+    {
+        if (!isWhitespace(str.chars[head]))
+            return head;
+    }
+    return str.length;
+}
+
 } // namespace hg
@@ -0,0 +1,120 @@
+#include "tests.hpp"
+#include "hg/atom.hpp"
+
+void testAtom()
+{
+    // ============================================================================
+    // Atom
+    // ============================================================================
+    //
+    // Atoms are ids into a global intern table. Equal strings intern to the
+    // same atom, and the string and its hash can be looked up from the atom.
+
+    // ------------------------------------------------------------------
+    // Interning
+    // ------------------------------------------------------------------
+
+    // Empty string is the null atom
+    {
+        TEST(atom("") == nullAtom);
+        TEST(atomString(nullAtom) == "");
+        TEST(atomHash(nullAtom) == atomHash(StringView{}));
+    }
+
+    // Equal strings intern to the same atom
+    {
+        Atom a = atom("test_atom_equal");
+        Atom b = atom(String::create("test_atom_equal"));
+        TEST(a != nullAtom);
+        TEST(a == b);
+    }
+
+    // Different strings intern to different atoms
+    {
+        Atom a = atom("test_atom_a");
+        Atom b = atom("test_atom_b");
+        TEST(a != b);
+    }
+
+    // Interned string and hash are recovered from the atom
+    {
+        Atom a = atom("test_atom_string");
+        TEST(atomString(a) == "test_atom_string");
+        TEST(atomHash(a) == atomHash("test_atom_string"));
+    }
+
+    // Interned string does not alias the source
+    {
+        char chars[] = "test_atom_copy";
+        Atom a = atom(chars);
+        chars[0] = 'X';
+        TEST(atomString(a) == "test_atom_copy");
+    }
+
+    // atomFind does not intern
+    {
+        u32 before = atomCount();
+        TEST(atomFind("test_atom_never_interned") == nullAtom);
+        TEST(atomCount() == before);
+        Atom a = atom("test_atom_found");
+        TEST(atomFind("test_atom_found") == a);
+    }
+
+    // HG_ATOM hashes literals at compile time
+    {
+        static_assert(atomHash("abc") == atomHash(StringView{"abc", 3}));
+        TEST(HG_ATOM("test_atom_literal") == atom("test_atom_literal"));
+    }
+
+    // Many atoms across several pages stay distinct
+    {
+        ArenaScope scratch = getScratch();
+        Array<Atom> atoms{};
+        for (u32 i = 0; i < 5000; ++i)
+        {
+            StringBuilder name{scratch, "test_atom_many_"};
+            name.append(integerToString(scratch, i));
+            atoms.push(atom(name));
+        }
+        bool distinct = true;
+        for (u32 i = 1; i < 5000; ++i)
+            distinct = distinct && atoms[i] != atoms[i - 1];
+        TEST(distinct);
+        TEST(atomString(atoms[4321]) == "test_atom_many_4321");
+        TEST(atom("test_atom_many_17") == atoms[17]);
+    }
+
+    // ------------------------------------------------------------------
+    // Concurrency
+    // ------------------------------------------------------------------
+
+    // Concurrent interning of the same strings agrees
+    {
+        Atom atoms[1024];
+        forPar(0, 1024, [&](u64 i)
+        {
+            char name[] = "test_atom_par_00";
+            name[14] = static_cast<char>('a' + i % 16);
+            name[15] = static_cast<char>('a' + (i / 16) % 16);
+            atoms[i] = atom(name);
+        });
+        bool agree = true;
+        for (u32 i = 256; i < 1024; ++i)
+            agree = agree && atoms[i] == atoms[i % 256];
+        TEST(agree);
+        TEST(atomString(atoms[17]) == "test_atom_par_bb");
+    }
+
+    // ------------------------------------------------------------------
+    // Hashing
+    // ------------------------------------------------------------------
+
+    // Atoms can key a map
+    {
+        Map<Atom, u32> map{};
+        map.add(atom("test_atom_key_a"), 1);
+        map.add(atom("test_atom_key_b"), 2);
+        TEST(*map.get(atom("test_atom_key_a")) == 1);
+        TEST(*map.get(atom("test_atom_key_b")) == 2);
+    }
+}
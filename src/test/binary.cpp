@@ -1,5 +1,6 @@
 #include "tests.hpp"
 #include "hg/binary.hpp"
+#include "hg/assets.hpp"
 
 void testBinary()
 {
@@ -249,5 +250,32 @@ void testBinary()
         Binary b2 = Binary::create(BinaryView{});
         TEST(b2.size == 0);
     }
-}
 
+    // ============================================================================
+    // MappedBinary
+    // ============================================================================
+    //
+    // MappedBinary maps a file read only, unmapping it on destruction.
+
+    // A stored file maps with the same contents, and moves keep the mapping
+    {
+        u64 vals[3] = {7, 8, 9};
+        TEST(binaryStore({vals, sizeof(vals)}, "/tmp/hg_binary_mapped_test"));
+        Maybe<MappedBinary> mapped = MappedBinary::map("/tmp/hg_binary_mapped_test");
+        TEST(mapped.has);
+        TEST(mapped->size == sizeof(vals));
+        MappedBinary moved = std::move(*mapped);
+        TEST(mapped->data == nullptr);
+        BinaryView bv = moved;
+        TEST(bv.read<u64>(16) == 9);
+    }
+
+    // Empty files map as empty, missing files do not map
+    {
+        TEST(binaryStore({}, "/tmp/hg_binary_mapped_empty"));
+        Maybe<MappedBinary> empty = MappedBinary::map("/tmp/hg_binary_mapped_empty");
+        TEST(empty.has);
+        TEST(empty->size == 0);
+        TEST(!MappedBinary::map("/tmp/hg_binary_missing_dir/file").has);
+    }
+}
@@ -0,0 +1,294 @@
+#include "tests.hpp"
+#include "hg/cache.hpp"
+
+struct CacheEvictions {
+    u32 count = 0;
+    u32 lastKey = 0;
+};
+
+static void cacheRecordEvict(void* data, u32* key, u32*)
+{
+    CacheEvictions* evictions = static_cast<CacheEvictions*>(data);
+    ++evictions->count;
+    evictions->lastKey = *key;
+}
+
+static u64 cacheValueCost(const u32&, const u32& val)
+{
+    return val;
+}
+
+void testCache()
+{
+    // ============================================================================
+    // LruCache
+    // ============================================================================
+    //
+    // LruCache maps keys to values and evicts the least recently used entries
+    // once the total cost exceeds its capacity.
+
+    // ------------------------------------------------------------------
+    // Get and put
+    // ------------------------------------------------------------------
+
+    // Default-constructed cache is empty
+    {
+        LruCache<u32, u32> cache;
+        TEST(cache.count() == 0);
+        TEST(cache.size == 0);
+        TEST(cache.get(1) == nullptr);
+    }
+
+    // put then get returns the value
+    {
+        LruCache<u32, u32> cache{4};
+        cache.put(1, 10);
+        cache.put(2, 20);
+        TEST(cache.count() == 2);
+        TEST(*cache.get(1) == 10);
+        TEST(*cache.get(2) == 20);
+        TEST(cache.get(3) == nullptr);
+    }
+
+    // put replaces an existing value
+    {
+        LruCache<u32, u32> cache{4};
+        cache.put(1, 10);
+        cache.put(1, 11);
+        TEST(cache.count() == 1);
+        TEST(*cache.get(1) == 11);
+    }
+
+    // ------------------------------------------------------------------
+    // Eviction
+    // ------------------------------------------------------------------
+
+    // Least recently put entry is evicted
+    {
+        LruCache<u32, u32> cache{2};
+        cache.put(1, 10);
+        cache.put(2, 20);
+        cache.put(3, 30);
+        TEST(cache.count() == 2);
+        TEST(!cache.has(1));
+        TEST(cache.has(2));
+        TEST(cache.has(3));
+    }
+
+    // get marks an entry most recently used
+    {
+        LruCache<u32, u32> cache{2};
+        cache.put(1, 10);
+        cache.put(2, 20);
+        cache.get(1);
+        cache.put(3, 30);
+        TEST(cache.has(1));
+        TEST(!cache.has(2));
+    }
+
+    // touch marks an entry most recently used
+    {
+        LruCache<u32, u32> cache{2};
+        cache.put(1, 10);
+        cache.put(2, 20);
+        TEST(cache.touch(1));
+        TEST(!cache.touch(5));
+        cache.put(3, 30);
+        TEST(cache.has(1));
+        TEST(!cache.has(2));
+    }
+
+    // peek does not change recency
+    {
+        LruCache<u32, u32> cache{2};
+        cache.put(1, 10);
+        cache.put(2, 20);
+        TEST(*cache.peek(1) == 10);
+        cache.put(3, 30);
+        TEST(!cache.has(1));
+    }
+
+    // onEvict is called with each evicted entry
+    {
+        CacheEvictions evictions{};
+        LruCache<u32, u32> cache{3};
+        cache.onEvict = cacheRecordEvict;
+        cache.evictData = &evictions;
+        for (u32 i = 0; i < 10; ++i)
+            cache.put(i, i);
+        TEST(evictions.count == 7);
+        TEST(evictions.lastKey == 6);
+        cache.remove(9);
+        TEST(evictions.count == 7);
+    }
+
+    // Cost function limits total cost instead of entry count
+    {
+        LruCache<u32, u32> cache{100, cacheValueCost};
+        cache.put(1, 40);
+        cache.put(2, 40);
+        TEST(cache.size == 80);
+        cache.put(3, 30);
+        TEST(!cache.has(1));
+        TEST(cache.size == 70);
+        cache.put(2, 10);
+        TEST(cache.size == 40);
+        TEST(cache.count() == 2);
+    }
+
+    // An entry costing more than the capacity is kept alone
+    {
+        LruCache<u32, u32> cache{50, cacheValueCost};
+        cache.put(1, 10);
+        cache.put(2, 80);
+        TEST(cache.count() == 1);
+        TEST(*cache.get(2) == 80);
+    }
+
+    // trim evicts down to a budget
+    {
+        LruCache<u32, u32> cache{10};
+        for (u32 i = 0; i < 10; ++i)
+            cache.put(i, i);
+        cache.trim(4);
+        TEST(cache.count() == 4);
+        TEST(!cache.has(5));
+        TEST(cache.has(6));
+        cache.trim(0);
+        TEST(cache.count() == 0);
+        TEST(cache.head == (u32)-1);
+        TEST(cache.tail == (u32)-1);
+    }
+
+    // ------------------------------------------------------------------
+    // Remove
+    // ------------------------------------------------------------------
+
+    // remove returns the value and frees the node for reuse
+    {
+        LruCache<u32, u32> cache{4};
+        cache.put(1, 10);
+        cache.put(2, 20);
+        u32 val = 0;
+        TEST(cache.remove(1, &val));
+        TEST(val == 10);
+        TEST(!cache.remove(1));
+        TEST(cache.count() == 1);
+        cache.put(3, 30);
+        TEST(cache.nodes.count == 2);
+    }
+
+    // forEach visits from most to least recently used
+    {
+        LruCache<u32, u32> cache{4};
+        cache.put(1, 10);
+        cache.put(2, 20);
+        cache.put(3, 30);
+        cache.get(1);
+        u32 order[3] = {};
+        u32 i = 0;
+        cache.forEach([&](u32* key, u32*)
+        {
+            order[i++] = *key;
+        });
+        TEST(i == 3);
+        TEST(order[0] == 1);
+        TEST(order[1] == 3);
+        TEST(order[2] == 2);
+    }
+
+    // Recency list stays consistent through churn
+    {
+        LruCache<u32, u32> cache{64};
+        for (u32 i = 0; i < 4096; ++i)
+        {
+            u32 key = (i * 7919) % 200;
+            if (cache.get(key) == nullptr)
+                cache.put(key, i);
+            if (i % 5 == 0)
+                cache.remove((i * 31) % 200);
+        }
+        u64 walked = 0;
+        u32 prev = (u32)-1;
+        bool linked = true;
+        for (u32 idx = cache.head; idx != (u32)-1; idx = cache.nodes[idx].next)
+        {
+            linked = linked && cache.nodes[idx].prev == prev;
+            prev = idx;
+            ++walked;
+        }
+        TEST(linked);
+        TEST(prev == cache.tail);
+        TEST(walked == cache.count());
+        TEST(cache.count() <= 64);
+    }
+
+    // Values are destroyed when evicted and when the cache is destroyed
+    {
+        Lifecycle::stats.reset();
+        {
+            LruCache<u32, Lifecycle> cache{2};
+            cache.put(1, Lifecycle{});
+            cache.put(2, Lifecycle{});
+            cache.put(3, Lifecycle{});
+            TEST(Lifecycle::stats.copies == 0);
+        }
+        TEST(Lifecycle::stats.alive == 0);
+    }
+
+    // Move construct
+    {
+        LruCache<u32, u32> a{4};
+        a.put(1, 10);
+        LruCache<u32, u32> b = std::move(a);
+        TEST(a.count() == 0);
+        TEST(a.head == (u32)-1);
+        TEST(b.capacity == 4);
+        TEST(*b.get(1) == 10);
+    }
+
+    // ============================================================================
+    // LruCacheSharded
+    // ============================================================================
+    //
+    // LruCacheSharded splits a cache into shards by key hash, each guarded by
+    // its own lock, so it can be used from many threads at once.
+
+    // put then get copies out the value
+    {
+        LruCacheSharded<u32, u32> cache{64};
+        cache.put(1, 10);
+        u32 val = 0;
+        TEST(cache.get(1, &val));
+        TEST(val == 10);
+        TEST(!cache.get(2, &val));
+        TEST(cache.remove(1));
+        TEST(cache.count() == 0);
+    }
+
+    // Capacity is split between shards
+    {
+        LruCacheSharded<u32, u32, 4> cache{16};
+        for (u32 i = 0; i < 1000; ++i)
+            cache.put(i, i);
+        TEST(cache.count() <= 16);
+        for (u32 i = 0; i < 4; ++i)
+            TEST(cache.shards[i].capacity == 4);
+    }
+
+    // Concurrent puts and gets stay consistent
+    {
+        LruCacheSharded<u32, u32> cache{256};
+        std::atomic<u32> mismatches = 0;
+        forPar(0, 4096, [&](u64 i)
+        {
+            u32 key = static_cast<u32>(i % 512);
+            cache.put(key, key * 3);
+            u32 val = 0;
+            if (cache.get(key, &val) && val != key * 3)
+                mismatches.fetch_add(1);
+        });
+        TEST(mismatches.load() == 0);
+        TEST(cache.count() <= 256);
+    }
+}
@@ -1,11 +1,32 @@
 #include "tests.hpp"
 #include "hg/ecs.hpp"
+#include "hg/noise.hpp"
 
 struct EntityRefComp {
     Entity target;
     u32 data;
 };
 
+struct Enemy {};
+
+struct Selected {};
+
+struct Owned {
+    u32* val = nullptr;
+
+    Owned() = default;
+    explicit Owned(u32* valVal) : val{valVal} {}
+    Owned(const Owned&) = delete;
+    Owned& operator=(const Owned&) = delete;
+    Owned(Owned&& other) noexcept : val{other.val} { other.val = nullptr; }
+    Owned& operator=(Owned&& other) noexcept
+    {
+        val = other.val;
+        other.val = nullptr;
+        return *this;
+    }
+};
+
 namespace hg {
 
 template<>
@@ -15,6 +36,12 @@ void ecsSerialize(Serializer* s, EntityRefComp* val, EntitySerializer* ecs)
     serialize(s, &val->data);
 }
 
+template<>
+void ecsRemap(EntityRefComp* val, const EcsEntityMap* map)
+{
+    ecsRemap(&val->target, map);
+}
+
 } // namespace hg
 
 void testEcs()
@@ -607,6 +634,104 @@ void testEcs()
         TEST(!ecs.alive(e));
     }
 
+    // ============================================================================
+    // Component masks / despawnMany
+    // ============================================================================
+
+    // Each entity's mask follows its components
+    {
+        using World = Ecs<u32, f32, u64>;
+        World ecs{};
+        Entity a = ecs.spawn();
+        Entity b = ecs.spawn();
+        ecs.add<u32>(a);
+        ecs.add<u64>(a);
+        ecs.add<f32>(b);
+        TEST(ecs.masks[a.handle.idx()] == (World::bit<u32>() | World::bit<u64>()));
+        TEST(ecs.masks[b.handle.idx()] == World::bit<f32>());
+
+        ecs.remove<u32>(a);
+        TEST(ecs.masks[a.handle.idx()] == World::bit<u64>());
+        ecs.clear<u64>();
+        TEST(ecs.masks[a.handle.idx()] == 0);
+
+        ecs.add<u32>(b);
+        ecs.despawn(b);
+        Entity c = ecs.spawn();
+        TEST(c.handle.idx() == b.handle.idx());
+        TEST(ecs.masks[c.handle.idx()] == 0);
+        TEST((!ecs.hasAny<u32, f32>(c)));
+    }
+
+    // despawnMany removes every component of a batch, keeping groups and
+    // change logs consistent
+    {
+        Ecs<u32, f32, u64> ecs{};
+        ecs.group<u32, f32>();
+        ecs.track<u64>();
+
+        Array<Entity> es{};
+        for (u32 i = 0; i < 200; ++i)
+        {
+            Entity e = ecs.spawn();
+            es.push(e);
+            ecs.add<u32>(e, i);
+            if (i % 2 == 0)
+                ecs.add<f32>(e, (f32)i);
+            if (i % 5 == 0)
+                ecs.add<u64>(e, i);
+        }
+
+        Array<Entity> dead{};
+        for (u32 i = 0; i < 200; i += 3)
+            dead.push(es[i]);
+        ecs.despawnMany(dead);
+
+        bool despawned = true;
+        for (Entity e : dead)
+            despawned = despawned && !ecs.alive(e);
+        TEST(despawned);
+        TEST(ecs.count<u32>() == 133);
+        TEST(ecs.count<f32>() == 66);
+        TEST(ecs.count<u64>() == 26);
+        TEST(ecs.groups[0].count == 66);
+
+        u32 removed = 0;
+        ecs.forEachRemoved<u64>(0, [&](Entity) { ++removed; });
+        TEST(removed == 14);
+
+        bool intact = true;
+        ecs.forEach<u32, f32>([&](u32& v, f32& f)
+        {
+            intact = intact && v % 3 != 0 && (f32)v == f;
+        });
+        TEST(intact);
+
+        ecs.despawnMany(Span<const Entity>{});
+        TEST(ecs.count<u32>() == 133);
+
+        // Despawning everything left clears each type at once
+        Array<Entity> rest{};
+        for (u32 i = 0; i < 200; ++i)
+        {
+            if (ecs.alive(es[i]))
+                rest.push(es[i]);
+        }
+        ecs.despawnMany(rest);
+        TEST(ecs.count<u32>() == 0);
+        TEST(ecs.count<f32>() == 0);
+        TEST(ecs.count<u64>() == 0);
+        TEST(ecs.groups[0].count == 0);
+        removed = 0;
+        ecs.forEachRemoved<u64>(0, [&](Entity) { ++removed; });
+        TEST(removed == 40);
+
+        Entity e = ecs.spawn();
+        TEST(ecs.masks[e.handle.idx()] == 0);
+        ecs.add<u32, f32>(e, 1u, 2.0f);
+        TEST(ecs.groups[0].count == 1);
+    }
+
     // ============================================================================
     // Query zero-component state
     // ============================================================================
@@ -667,6 +792,1145 @@ void testEcs()
         TEST(!cs.has(e));
     }
 
+    // ============================================================================
+    // Paged sparse indices
+    // ============================================================================
+
+    {
+        EcsSparse sparse{};
+        TEST(sparse.get(0) == (u32)-1);
+        TEST(sparse.get(1000000) == (u32)-1);
+        sparse.set(5, 1);
+        sparse.set(1000000, 2);
+        TEST(sparse.get(5) == 1);
+        TEST(sparse.get(1000000) == 2);
+        TEST(sparse.get(6) == (u32)-1);
+        TEST(sparse.get(999999) == (u32)-1);
+        TEST(sparse.get(2000000) == (u32)-1);
+        TEST(sparse.allocated == 2);
+
+        // Pages between the two written ones share the empty page
+        TEST(sparse.pages[1] == EcsSparse::emptyPage.vals);
+        TEST(sparse.memoryUsage() < 2 * EcsSparse::pageSize * sizeof(u32) + 16384);
+
+        sparse.set(5, (u32)-1);
+        TEST(sparse.get(5) == (u32)-1);
+        sparse.reset();
+        TEST(sparse.get(1000000) == (u32)-1);
+        TEST(sparse.allocated == 0);
+    }
+
+    {
+        Ecs<u32, f32> ecs{};
+        Entity last{};
+        for (u32 i = 0; i < 100000; ++i)
+        {
+            last = ecs.spawn();
+            ecs.add<u32>(last, i);
+        }
+        ecs.add<f32>(last, 1.0f);
+
+        // A component on one high index entity costs one page
+        TEST(ecs.getComponentSystem<f32>().indices.allocated == 1);
+        TEST(ecs.getComponentSystem<u32>().indices.allocated == 98);
+        TEST(ecs.get<u32>(last) == 99999);
+        TEST(ecs.get<f32>(last) == 1.0f);
+        TEST(!ecs.has<f32>(Entity{Handle{0}}));
+    }
+
+    // ============================================================================
+    // Owning groups
+    // ============================================================================
+
+    {
+        // The group members lead each owned array, in the same order
+        auto partitioned = [](Ecs<u32, f32, u64>& ecs)
+        {
+            u32 g = ecs.getGroup<u32, f32>();
+            if (g == (u32)-1)
+                return false;
+
+            u32 count = ecs.groups[g].count;
+            Span<const Entity> us = ecs.getEntities<u32>();
+            Span<const Entity> fs = ecs.getEntities<f32>();
+            for (u32 i = 0; i < count; ++i)
+            {
+                if (us[i] != fs[i])
+                    return false;
+            }
+            for (u64 i = count; i < us.count; ++i)
+            {
+                if (ecs.has<f32>(us[i]))
+                    return false;
+            }
+            for (u64 i = count; i < fs.count; ++i)
+            {
+                if (ecs.has<u32>(fs[i]))
+                    return false;
+            }
+            return true;
+        };
+
+        Ecs<u32, f32, u64> ecs{};
+        Entity es[64];
+        for (u32 i = 0; i < 64; ++i)
+        {
+            es[i] = ecs.spawn();
+            if (i % 2 == 0)
+                ecs.add<u32>(es[i], i);
+            if (i % 3 == 0)
+                ecs.add<f32>(es[i], (f32)i);
+        }
+
+        ecs.group<u32, f32>();
+        ecs.group<u32, f32>();
+        TEST(ecs.groups.count == 1);
+        TEST(ecs.groups[0].count == 11);
+        TEST(partitioned(ecs));
+
+        // Adding the last owned type joins the group and returns the moved component
+        u32& joined = ecs.add<u32>(es[3], 3);
+        TEST(joined == 3);
+        TEST(&joined == &ecs.get<u32>(es[3]));
+        TEST(ecs.groups[0].count == 12);
+        TEST(partitioned(ecs));
+
+        // Removing an owned type or despawning leaves the group
+        ecs.remove<f32>(es[0]);
+        ecs.despawn(es[6]);
+        TEST(ecs.groups[0].count == 10);
+        TEST(partitioned(ecs));
+
+        // Queries over exactly the owned types walk the group
+        u64 sum = 0;
+        u64 visits = 0;
+        ecs.forEach<u32, f32>([&](Entity e, u32& a, f32& b)
+        {
+            sum += a + (u64)b;
+            visits += ecs.has<u32>(e);
+        });
+        TEST(visits == 10);
+        TEST(sum == 2 * (12 + 18 + 24 + 30 + 36 + 42 + 48 + 54 + 60 + 3));
+
+        const Ecs<u32, f32, u64>& constEcs = ecs;
+        u64 constVisits = 0;
+        constEcs.forEach<u32, f32>([&](const u32&, const f32&) { ++constVisits; });
+        TEST(constVisits == 10);
+
+        std::atomic<u64> parVisits{0};
+        ecs.forEachPar<u32, f32>([&](Entity) { ++parVisits; });
+        TEST(parVisits.load() == 10);
+
+        ecs.clear<f32>();
+        TEST(ecs.groups[0].count == 0);
+        ecs.add<f32>(es[2], 2.0f);
+        TEST(ecs.groups[0].count == 1);
+        TEST(partitioned(ecs));
+    }
+
+    {
+        // Random changes keep the partition and match a full scan
+        Ecs<u32, f32, u64> ecs{};
+        ecs.group<u32, f32>();
+
+        Rng rng{34};
+        Array<Entity> alive{};
+        bool valid = true;
+        for (u32 i = 0; i < 20000; ++i)
+        {
+            u32 op = rng.next() % 8;
+            if (op == 0 || alive.count == 0)
+            {
+                alive.push(ecs.spawn());
+                continue;
+            }
+
+            u64 idx = rng.next() % alive.count;
+            Entity e = alive[idx];
+            if (op == 1)
+            {
+                ecs.despawn(e);
+                alive.removeSwap(idx);
+            }
+            else if (op < 4)
+            {
+                if (ecs.has<u32>(e))
+                    ecs.remove<u32>(e);
+                else
+                    ecs.add<u32>(e, i);
+            }
+            else if (op < 6)
+            {
+                if (ecs.has<f32>(e))
+                    ecs.remove<f32>(e);
+                else
+                    ecs.add<f32>(e, (f32)(i % 1000));
+            }
+            else if (!ecs.has<u64>(e))
+            {
+                ecs.add<u64>(e, i);
+            }
+
+            if (i % 1000 == 0)
+            {
+                u64 expected = 0;
+                for (Entity a : alive)
+                    expected += ecs.hasAll<u32, f32>(a);
+                valid = valid && ecs.groups[0].count == expected;
+                u64 grouped = 0;
+                ecs.forEach<u32, f32>([&](Entity e2, u32& a, f32&)
+                {
+                    grouped += ecs.get<u32>(e2) == a;
+                });
+                valid = valid && grouped == expected;
+            }
+        }
+        TEST(valid);
+    }
+
+    {
+        Lifecycle::stats.reset();
+        {
+            Ecs<Lifecycle, u32> ecs{};
+            ecs.group<Lifecycle, u32>();
+            Entity es[16];
+            for (u32 i = 0; i < 16; ++i)
+            {
+                es[i] = ecs.spawn();
+                ecs.add<Lifecycle>(es[i]);
+                if (i % 2 == 0)
+                    ecs.add<u32>(es[i], i);
+            }
+            TEST(ecs.groups[0].count == 8);
+            for (u32 i = 0; i < 16; i += 4)
+            {
+                ecs.despawn(es[i]);
+            }
+            TEST(Lifecycle::stats.alive == 12);
+            TEST(ecs.groups[0].count == 4);
+
+            u64 valid = 0;
+            ecs.forEach<Lifecycle, u32>([&](Lifecycle& l, u32&) { valid += l.valid; });
+            TEST(valid == 4);
+        }
+        TEST(Lifecycle::stats.alive == 0);
+    }
+
+    // ============================================================================
+    // System scheduler
+    // ============================================================================
+
+    {
+        using World = Ecs<u32, f32, u64>;
+        World ecs{};
+        for (u32 i = 0; i < 1000; ++i)
+        {
+            Entity e = ecs.spawn();
+            ecs.add<u32>(e, i);
+            ecs.add<f32>(e, 0.0f);
+        }
+
+        u64 sum = 0;
+        ecs.addSystem<EcsReads<>, EcsWrites<u32>>("double", [](World* w, void*)
+        {
+            w->forEach<u32>([](u32& v) { v *= 2; });
+        });
+        ecs.addSystem<EcsReads<u32>, EcsWrites<f32>>("copy", [](World* w, void*)
+        {
+            w->forEach<u32, f32>([](u32& a, f32& b) { b = (f32)a; });
+        });
+        ecs.addSystem<EcsReads<>, EcsWrites<u64>>("count", [](World* w, void*)
+        {
+            w->forEach<u64>([](u64& v) { ++v; });
+        });
+        ecs.addSystem<EcsReads<u32>, EcsWrites<>>("sum", [](World* w, void* data)
+        {
+            u64* total = static_cast<u64*>(data);
+            *total = 0;
+            w->forEach<u32>([&](u32& v) { *total += v; });
+        }, &sum);
+        ecs.addExclusiveSystem("spawn", [](World* w, void*)
+        {
+            w->add<u64>(w->spawn(), 0);
+        });
+        ecs.addSystem<EcsReads<f32>, EcsWrites<u64>>("last", [](World* w, void*)
+        {
+            w->forEach<u64>([](u64& v) { v += 10; });
+        });
+
+        ecs.runSystems();
+
+        // Systems wait only for the earlier systems they conflict with
+        EcsScheduler& sched = ecs.scheduler;
+        TEST(sched.systems.count == 6);
+        TEST(sched.systems[0].level == 0 && sched.systems[0].dependencies == 0);
+        TEST(sched.systems[1].level == 1 && sched.systems[1].dependencies == 1);
+        TEST(sched.systems[2].level == 0 && sched.systems[2].dependencies == 0);
+        TEST(sched.systems[3].level == 1 && sched.systems[3].dependencies == 1);
+        TEST(sched.systems[4].level == 2 && sched.systems[4].dependencies == 4);
+        TEST(sched.systems[5].level == 3 && sched.systems[5].dependencies == 3);
+        TEST(atomString(sched.systems[3].name) == "sum");
+
+        // Results match running in registration order
+        TEST(sum == 2 * 499500);
+        TEST(ecs.count<u64>() == 1);
+        bool copied = true;
+        ecs.forEach<u32, f32>([&](u32& a, f32& b) { copied = copied && (f32)a == b; });
+        TEST(copied);
+
+        ecs.runSystems();
+        TEST(sum == 4 * 499500);
+        TEST(ecs.count<u64>() == 2);
+        u64 total = 0;
+        ecs.forEach<u64>([&](u64& v) { total += v; });
+        TEST(total == 10 + 11 + 10);
+
+        bool timed = true;
+        for (const EcsSystem& system : sched.systems)
+            timed = timed && system.runs == 2 && system.time >= 0.0 && system.totalTime >= system.time;
+        TEST(timed);
+        TEST(sched.time > 0.0);
+    }
+
+    {
+        // Independent systems run concurrently, each waits to see the other start
+        using World = Ecs<u32, f32>;
+        World ecs{};
+        std::atomic<u32> started{0};
+        auto meet = [](World*, void* data)
+        {
+            std::atomic<u32>* count = static_cast<std::atomic<u32>*>(data);
+            ++*count;
+            Clock clock{};
+            f64 waited = 0.0;
+            while (count->load() < 2 && (waited += clock.tick()) < 1.0)
+                std::this_thread::yield();
+        };
+        ecs.addSystem<EcsReads<>, EcsWrites<u32>>("a", meet, &started);
+        ecs.addSystem<EcsReads<>, EcsWrites<f32>>("b", meet, &started);
+        ecs.runSystems();
+        TEST(started.load() == 2);
+        TEST(ecs.scheduler.time < 1.0);
+    }
+
+    // ============================================================================
+    // Command buffers
+    // ============================================================================
+
+    {
+        using World = Ecs<u32, f32, u64>;
+        World ecs{};
+        Entity a = ecs.spawn();
+        Entity b = ecs.spawn();
+        Entity c = ecs.spawn();
+        ecs.add<u32>(a, 1);
+        ecs.add<u32>(b, 2);
+        ecs.despawn(c);
+
+        EcsCommands<u32, f32, u64> cmds{&ecs};
+        TEST(cmds.empty());
+
+        // Reserved entities reuse freed handles first, and are not alive until played
+        Entity r0 = cmds.spawn();
+        Entity r1 = cmds.spawn();
+        TEST(r0.handle.idx() == c.handle.idx() && r0 != c);
+        TEST(r1.handle.idx() == 3);
+        TEST(!ecs.alive(r0) && !ecs.alive(r1));
+
+        cmds.add<f32>(r0, 0.5f);
+        cmds.add<u32>(r1, 7);
+        cmds.add<u32>(a, 10);
+        cmds.remove<u32>(b);
+        cmds.add<u32>(b, 20);
+        cmds.remove<u32>(b);
+        cmds.add<u64>(a, 3);
+        cmds.remove<u64>(a);
+        cmds.remove<f32>(a);
+        cmds.despawn(b);
+        cmds.despawn(b);
+        cmds.add<f32>(c, 1.0f);
+        TEST(!cmds.empty());
+        TEST(ecs.get<u32>(a) == 1);
+
+        ecs.playCommands(cmds);
+        TEST(cmds.empty());
+        TEST(ecs.reserved == 0);
+
+        TEST(ecs.alive(r0) && ecs.alive(r1));
+        TEST(ecs.get<f32>(r0) == 0.5f);
+        TEST(ecs.get<u32>(r1) == 7);
+        TEST(ecs.get<u32>(a) == 10);
+        TEST(!ecs.has<u64>(a));
+        TEST(!ecs.has<f32>(a));
+        TEST(!ecs.alive(b));
+        TEST(ecs.count<u32>() == 2);
+        TEST(ecs.count<f32>() == 1);
+        TEST(ecs.count<u64>() == 0);
+
+        // Spawning after playback continues past the reserved handles
+        TEST(ecs.spawn().handle.idx() == b.handle.idx());
+    }
+
+    {
+        // Removes from the back of the packed array keep the survivors in order
+        Ecs<u32> ecs{};
+        EcsCommands<u32> cmds{&ecs};
+        for (u32 i = 0; i < 10; ++i)
+            ecs.add<u32>(ecs.spawn(), i);
+        for (u32 i = 0; i < 10; i += 3)
+            cmds.remove<u32>(Entity{Handle{i}});
+        ecs.playCommands(cmds);
+
+        Span<u32> vals = ecs.getComponents<u32>();
+        TEST(vals.count == 6);
+        TEST(vals[0] == 8 && vals[1] == 1 && vals[2] == 2 && vals[3] == 7 && vals[4] == 4 && vals[5] == 5);
+    }
+
+    {
+        // Buffers recorded in parallel, one per task, play back as one
+        using World = Ecs<u32, f32>;
+        World ecs{};
+        for (u32 i = 0; i < 10000; ++i)
+            ecs.add<u32>(ecs.spawn(), i);
+
+        static constexpr u32 tasks = 16;
+        Array<EcsCommands<u32, f32>> buffers{};
+        for (u32 i = 0; i < tasks; ++i)
+            buffers.push({&ecs});
+
+        Span<const Entity> es = ecs.getComponentSystem<u32>().entities;
+        forPar(0, tasks, [&](u64 t)
+        {
+            EcsCommands<u32, f32>& cmds = buffers[t];
+            for (u64 i = t; i < es.count; i += tasks)
+            {
+                u32 val = ecs.get<u32>(es[i]);
+                if (val % 2 == 1)
+                {
+                    cmds.remove<u32>(es[i]);
+                    cmds.add<f32>(es[i], (f32)val);
+                }
+                if (val % 100 == 0)
+                    cmds.add<u32>(cmds.spawn(), val + 1);
+                if (val % 10 == 2)
+                    cmds.despawn(es[i]);
+            }
+        });
+        ecs.playCommands(buffers);
+
+        TEST(ecs.entities.handles.count == 10100);
+        TEST(ecs.count<f32>() == 5000);
+        TEST(ecs.count<u32>() == 5000 - 1000 + 100);
+
+        u64 sum = 0;
+        ecs.forEach<u32>([&](u32& v) { sum += v; });
+        u64 expected = 0;
+        for (u32 i = 0; i < 10000; i += 2)
+            expected += i % 10 == 2 ? 0 : i;
+        for (u32 i = 0; i < 10000; i += 100)
+            expected += i + 1;
+        TEST(sum == expected);
+
+        bool emptied = true;
+        for (const EcsCommands<u32, f32>& cmds : buffers)
+            emptied = emptied && cmds.empty();
+        TEST(emptied);
+    }
+
+    {
+        // Lifetimes of buffered values
+        Lifecycle::stats.reset();
+        {
+            Ecs<Lifecycle> ecs{};
+            EcsCommands<Lifecycle> cmds{&ecs};
+            Entity e = ecs.spawn();
+            cmds.add<Lifecycle>(e);
+            cmds.add<Lifecycle>(e);
+            cmds.add<Lifecycle>(cmds.spawn());
+            ecs.playCommands(cmds);
+            TEST(ecs.count<Lifecycle>() == 2);
+        }
+        TEST(Lifecycle::stats.alive == 0);
+    }
+
+    // ============================================================================
+    // Change detection
+    // ============================================================================
+
+    {
+        Ecs<u32, f32, u64> ecs{};
+        Entity a = ecs.spawn();
+        Entity b = ecs.spawn();
+        Entity c = ecs.spawn();
+        ecs.add<u32>(a, 1);
+
+        // Components present before tracking count as unchanged
+        ecs.track<u32>();
+        ecs.track<u32>();
+        u32 seen = 0;
+        u32 visits = 0;
+        ecs.forEachChanged<u32>(seen, [&](u32&) { ++visits; });
+        TEST(visits == 0);
+
+        ecs.add<u32>(b, 2);
+        ecs.add<u32>(c, 3);
+        ecs.add<f32>(c, 0.5f);
+        seen = ecs.advanceTick();
+
+        // Unchanged since the last tick
+        visits = 0;
+        ecs.forEachChanged<u32>(seen, [&](u32&) { ++visits; });
+        TEST(visits == 0);
+
+        // Mutable get and markChanged mark, const get and forEach do not
+        ecs.get<u32>(a) += 10;
+        ecs.markChanged<u32>(c);
+        static_cast<const Ecs<u32, f32, u64>&>(ecs).get<u32>(b);
+        ecs.forEach<u32>([](u32& v) { v += 0; });
+
+        Array<Entity> changed{};
+        ecs.forEachChanged<u32>(seen, [&](Entity e) { changed.push(e); });
+        TEST(changed.count == 2);
+        TEST(changed[0] == a && changed[1] == c);
+
+        // Filters combine with other components
+        u32 sum = 0;
+        ecs.forEachChanged<u32, f32>(seen, [&](Entity e, u32& v, f32& f)
+        {
+            TEST(e == c);
+            sum += v + (u32)(f * 2.0f);
+        });
+        TEST(sum == 4);
+
+        // Added only reports new components
+        u32 tickBefore = seen;
+        seen = ecs.advanceTick();
+        Entity d = ecs.spawn();
+        ecs.add<u32>(d, 4);
+        changed.reset();
+        ecs.forEachAdded<u32>(seen, [&](Entity e, u32&) { changed.push(e); });
+        TEST(changed.count == 1 && changed[0] == d);
+        changed.reset();
+        ecs.forEachAdded<u32>(0, [&](Entity e) { changed.push(e); });
+        TEST(changed.count == 3);
+
+        // Ticks follow the components through removeSwap
+        ecs.remove<u32>(a);
+        changed.reset();
+        ecs.forEachChanged<u32>(tickBefore, [&](Entity e) { changed.push(e); });
+        TEST(changed.count == 2);
+        TEST((changed[0] == d && changed[1] == c) || (changed[0] == c && changed[1] == d));
+
+        // Removals are logged, including by despawn
+        ecs.despawn(b);
+        changed.reset();
+        ecs.forEachRemoved<u32>(seen, [&](Entity e) { changed.push(e); });
+        TEST(changed.count == 2 && changed[0] == a && changed[1] == b);
+
+        seen = ecs.advanceTick();
+        ecs.remove<u32>(c);
+        changed.reset();
+        ecs.forEachRemoved<u32>(seen, [&](Entity e) { changed.push(e); });
+        TEST(changed.count == 1 && changed[0] == c);
+
+        ecs.trimRemoved<u32>(seen);
+        TEST(ecs.getComponentSystem<u32>().removed.count == 1);
+        ecs.clear<u32>();
+        TEST(ecs.getComponentSystem<u32>().removed.count == 2);
+
+        // Untracked types are unaffected
+        TEST(!ecs.getComponentSystem<f32>().tracked);
+        TEST(ecs.getComponentSystem<f32>().changed.count == 0);
+    }
+
+    {
+        // Ticks stay parallel through group swaps and command playback
+        Ecs<u32, f32> ecs{};
+        ecs.track<u32>();
+        ecs.group<u32, f32>();
+        for (u32 i = 0; i < 100; ++i)
+        {
+            Entity e = ecs.spawn();
+            ecs.add<u32>(e, i);
+            if (i % 3 == 0)
+                ecs.add<f32>(e, (f32)i);
+        }
+        u32 seen = ecs.advanceTick();
+
+        EcsCommands<u32, f32> cmds{&ecs};
+        for (u32 i = 0; i < 100; i += 10)
+            cmds.add<u32>(Entity{Handle{i}}, i * 2);
+        ecs.playCommands(cmds);
+
+        u32 visits = 0;
+        bool doubled = true;
+        ecs.forEachChanged<u32>(seen, [&](Entity e, u32& v)
+        {
+            ++visits;
+            doubled = doubled && v == e.handle.idx() * 2;
+        });
+        TEST(visits == 10);
+        TEST(doubled);
+        TEST(ecs.getComponentSystem<u32>().changed.count == 100);
+    }
+
+    // ============================================================================
+    // Sorting
+    // ============================================================================
+
+    {
+        using World = Ecs<u32, f32>;
+        World ecs{};
+        Rng rng{42};
+        for (u32 i = 0; i < 1000; ++i)
+        {
+            Entity e = ecs.spawn();
+            ecs.add<u32>(e, rng.next() % 5000);
+            if (i % 2 == 0)
+                ecs.add<f32>(e, (f32)i - 500.0f);
+        }
+        for (u32 i = 0; i < 1000; i += 7)
+            ecs.remove<u32>(Entity{Handle{i}});
+        ecs.track<u32>();
+        u32 seen = ecs.advanceTick();
+        ecs.markChanged<u32>(Entity{Handle{500}});
+
+        auto lookupsValid = [&]
+        {
+            bool valid = true;
+            Span<const Entity> es = ecs.getEntities<u32>();
+            Span<u32> vals = ecs.getComponents<u32>();
+            const World& view = ecs;
+            for (u64 i = 0; i < es.count; ++i)
+                valid = valid && &view.get<u32>(es[i]) == &vals[i];
+            return valid;
+        };
+
+        // By key, stable
+        ecs.sort<u32>([](const u32& v) { return v / 10; });
+        Span<u32> vals = ecs.getComponents<u32>();
+        bool sorted = true;
+        for (u64 i = 1; i < vals.count; ++i)
+            sorted = sorted && vals[i - 1] / 10 <= vals[i] / 10;
+        TEST(sorted);
+        TEST(lookupsValid());
+
+        // By comparison
+        ecs.sort<u32>([](const u32& a, const u32& b) { return a > b; });
+        vals = ecs.getComponents<u32>();
+        sorted = true;
+        for (u64 i = 1; i < vals.count; ++i)
+            sorted = sorted && vals[i - 1] >= vals[i];
+        TEST(sorted);
+        TEST(lookupsValid());
+
+        // By entity, restoring creation order
+        ecs.sort<u32>();
+        Span<const Entity> es = ecs.getEntities<u32>();
+        sorted = true;
+        for (u64 i = 1; i < es.count; ++i)
+            sorted = sorted && es[i - 1].handle.id < es[i].handle.id;
+        TEST(sorted);
+        TEST(es.count == 1000 - 143);
+        TEST(lookupsValid());
+
+        // Change ticks follow the components
+        u32 visits = 0;
+        ecs.forEachChanged<u32>(seen, [&](Entity e) { ++visits; TEST(e.handle.idx() == 500); });
+        TEST(visits == 1);
+
+        // By f32 key, negative values first
+        ecs.sort<f32>([](Entity, const f32& v) { return -v; });
+        Span<f32> floats = ecs.getComponents<f32>();
+        sorted = true;
+        for (u64 i = 1; i < floats.count; ++i)
+            sorted = sorted && floats[i - 1] >= floats[i];
+        TEST(sorted);
+        TEST(floats[0] == 498.0f);
+
+        // To match another type, shared entities first in its order
+        ecs.sortToMatch<u32, f32>();
+        es = ecs.getEntities<u32>();
+        Span<const Entity> fs = ecs.getEntities<f32>();
+        u64 shared = 0;
+        bool matched = true;
+        for (Entity e : fs)
+        {
+            if (ecs.has<u32>(e))
+                matched = matched && es[shared++] == e;
+        }
+        for (u64 i = shared; i < es.count; ++i)
+            matched = matched && !ecs.has<f32>(es[i]);
+        TEST(matched);
+        TEST(lookupsValid());
+
+        u64 pairs = 0;
+        ecs.forEach<u32, f32>([&](Entity e, u32&, f32&)
+        {
+            matched = matched && es[pairs++] == e;
+        });
+        TEST(matched);
+        TEST(pairs == shared);
+    }
+
+    // ============================================================================
+    // spawnMany / instantiate
+    // ============================================================================
+
+    // Instantiated components join groups, are stamped and are copy
+    // constructed when not trivially copyable
+    {
+        Ecs<u32, f32, Lifecycle> ecs{};
+        ecs.group<u32, f32>();
+        ecs.track<u32>();
+        ecs.advanceTick();
+
+        Lifecycle::stats.reset();
+        {
+            EcsPrefab<u32, f32, Lifecycle> prefab{};
+            prefab.set<u32>(2u);
+            prefab.set<Lifecycle>(Lifecycle{});
+
+            Array<Entity> es{};
+            es.resize(50);
+            ecs.instantiate(prefab, es);
+            TEST(ecs.count<Lifecycle>() == 50);
+            TEST(Lifecycle::stats.alive == 51);
+            TEST(ecs.groups[0].count == 0);
+
+            ecs.addMany<f32>(Span<const Entity>{es.vals, 20}, 0.5f);
+            TEST(ecs.groups[0].count == 20);
+            u32 grouped = 0;
+            ecs.forEach<u32, f32>([&](Entity e, u32& v, f32& f)
+            {
+                grouped += v == 2 && f == 0.5f && e.handle.idx() < es[20].handle.idx();
+            });
+            TEST(grouped == 20);
+
+            u32 added = 0;
+            ecs.forEachAdded<u32>(1, [&](u32&) { ++added; });
+            TEST(added == 50);
+        }
+        TEST(Lifecycle::stats.alive == 50);
+        ecs.reset();
+        TEST(Lifecycle::stats.alive == 0);
+    }
+
+    // ============================================================================
+    // Chunked queries
+    // ============================================================================
+
+    // Single types and groups are passed in place, other queries are gathered,
+    // tags are placeholders
+    {
+        Ecs<u32, f32, Enemy> ecs{};
+        for (u32 i = 0; i < 2500; ++i)
+        {
+            Entity e = ecs.spawn();
+            ecs.add<u32>(e, i);
+            if (i % 2 == 0)
+                ecs.add<f32>(e, 0.0f);
+            if (i % 5 == 0)
+                ecs.add<Enemy>(e);
+        }
+
+        bool inPlace = true;
+        u64 chunks = 0;
+        ecs.forEachChunk<u32>([&](Span<const Entity> es, Span<u32> a)
+        {
+            inPlace = inPlace && a.data == ecs.getComponents<u32>().data + chunks * ecsChunkSize;
+            inPlace = inPlace && es.data == ecs.getEntities<u32>().data + chunks * ecsChunkSize;
+            ++chunks;
+        });
+        TEST(inPlace);
+        TEST(chunks == 3);
+
+        // Gathered, the changes are moved back
+        u64 enemies = 0;
+        ecs.forEachChunk<u32, Enemy>([&](Span<const Entity> es, Span<u32> a, Span<Enemy> tags)
+        {
+            TEST(tags.count == es.count);
+            for (u32& v : a)
+                v += 10000;
+            enemies += es.count;
+        });
+        TEST(enemies == 500);
+        u32 moved = 0;
+        const Ecs<u32, f32, Enemy>& view = ecs;
+        view.forEach<u32, Enemy>([&](const u32& v, const Enemy&) { moved += v >= 10000; });
+        TEST(moved == 500);
+
+        ecs.group<u32, f32>();
+        inPlace = true;
+        u64 grouped = 0;
+        ecs.forEachChunk<u32, f32>([&](Span<const Entity>, Span<u32> a, Span<f32> b)
+        {
+            inPlace = inPlace && a.data == ecs.getComponents<u32>().data + grouped;
+            inPlace = inPlace && b.data == ecs.getComponents<f32>().data + grouped;
+            for (u64 i = 0; i < a.count; ++i)
+                b[i] = (f32)(a[i] % 10000);
+            grouped += a.count;
+        });
+        TEST(inPlace);
+        TEST(grouped == 1250);
+
+        std::atomic<u64> tagged{0};
+        ecs.forEachChunkPar<f32, Enemy>([&](Span<const Entity> es, Span<f32> b, Span<Enemy>)
+        {
+            for (u64 i = 0; i < es.count; ++i)
+                b[i] = -b[i];
+            tagged += es.count;
+        });
+        TEST(tagged.load() == 250);
+        f64 sum = 0.0;
+        view.forEach<f32>([&](const f32& v) { sum += v; });
+        // The evens sum to 1249 * 1250, the negated multiples of 10 to
+        // 249 * 125 * 10
+        TEST(sum == 1249.0 * 1250.0 - 2.0 * 249.0 * 125.0 * 10.0);
+    }
+
+    // Gathered components are moved, not copied, so move only types work
+    {
+        Lifecycle::stats.reset();
+        u32 vals[300] = {};
+        {
+            Ecs<u32, Owned, Lifecycle> ecs{};
+            for (u32 i = 0; i < 300; ++i)
+            {
+                Entity e = ecs.spawn();
+                ecs.add<u32>(e, i);
+                ecs.add<Owned>(e, Owned{&vals[i]});
+                if (i % 3 == 0)
+                    ecs.add<Lifecycle>(e);
+            }
+
+            bool owned = true;
+            ecs.forEachChunk<Owned, u32, Lifecycle>([&](Span<const Entity>, Span<Owned> o, Span<u32> a, Span<Lifecycle> l)
+            {
+                for (u64 i = 0; i < o.count; ++i)
+                {
+                    owned = owned && o[i].val == &vals[a[i]] && l[i].valid;
+                    ++*o[i].val;
+                }
+            });
+            TEST(owned);
+            TEST(Lifecycle::stats.copies == 0);
+            TEST(Lifecycle::stats.alive == 100);
+
+            u32 held = 0;
+            u32 touched = 0;
+            ecs.forEach<Owned>([&](Owned& o)
+            {
+                held += o.val != nullptr;
+                touched += o.val != nullptr && *o.val == 1;
+            });
+            TEST(held == 300);
+            TEST(touched == 100);
+        }
+        TEST(Lifecycle::stats.alive == 0);
+    }
+
+    // ============================================================================
+    // merge
+    // ============================================================================
+
+    // A world built on a worker thread is moved into the live world, with its
+    // entity references remapped
+    {
+        using World = Ecs<u32, Entity, EntityRefComp, Lifecycle>;
+        World live{};
+        live.group<u32, EntityRefComp>();
+        live.track<u32>();
+        Entity existing = live.spawn();
+        live.add<u32>(existing, 1000u);
+        live.advanceTick();
+
+        Lifecycle::stats.reset();
+        World staged{};
+        Fence fence{};
+        callPar(&fence, &staged, [](void* data)
+        {
+            World& ecs = *static_cast<World*>(data);
+            Entity es[100];
+            for (u32 i = 0; i < 100; ++i)
+            {
+                es[i] = ecs.spawn();
+                ecs.add<u32>(es[i], i);
+                if (i > 0)
+                    ecs.add<EntityRefComp>(es[i], EntityRefComp{es[i - 1], i});
+                if (i % 10 == 0)
+                    ecs.add<Lifecycle>(es[i]);
+            }
+            ecs.add<Entity>(es[99], es[0]);
+            // A dangling reference and a freed slot
+            ecs.despawn(es[50]);
+        });
+        helpThreads(&fence, INFINITY);
+        TEST(Lifecycle::stats.alive == 9);
+
+        Array<Entity> remapped{};
+        live.merge(staged, &remapped);
+        TEST(staged.count<u32>() == 0);
+        TEST(staged.entities.handles.count == 0);
+        TEST(remapped.count == 100);
+        TEST(remapped[50] == nullEntity);
+        TEST(live.count<u32>() == 100);
+        TEST(live.count<EntityRefComp>() == 98);
+        TEST(live.count<Lifecycle>() == 9);
+        TEST(Lifecycle::stats.alive == 9);
+        TEST(live.get<u32>(existing) == 1000);
+
+        const World& view = live;
+        bool linked = true;
+        view.forEach<EntityRefComp>([&](Entity e, const EntityRefComp& ref)
+        {
+            if (ref.data == 51)
+            {
+                linked = linked && ref.target == nullEntity;
+                return;
+            }
+            linked = linked && ref.target == remapped[ref.data - 1];
+            linked = linked && e == remapped[ref.data];
+            linked = linked && view.get<u32>(ref.target) == ref.data - 1;
+        });
+        TEST(linked);
+        TEST(view.get<Entity>(remapped[99]) == remapped[0]);
+        TEST((view.hasAll<u32, EntityRefComp>(remapped[10])));
+        TEST(!view.has<Lifecycle>(remapped[11]));
+
+        // Merged components join groups and are stamped as added
+        TEST(live.groups[0].count == 98);
+        u32 added = 0;
+        live.forEachAdded<u32>(live.changeTick - 1, [&](u32&) { ++added; });
+        TEST(added == 99);
+
+        live.despawn(remapped[10]);
+        TEST(live.count<Lifecycle>() == 8);
+        live.reset();
+        TEST(Lifecycle::stats.alive == 0);
+    }
+
+    // ============================================================================
+    // Tags
+    // ============================================================================
+    //
+    // Empty component types are stored as only their entities.
+
+    // Tags are counted without a component array and queried as entities
+    {
+        using World = Ecs<u32, Enemy, Selected>;
+        static_assert(ecsTag<Enemy> && !ecsTag<u32>);
+        static_assert(sizeof(EcsComponent<Enemy>::components) == sizeof(u64));
+
+        World ecs{};
+        ecs.track<Enemy>();
+        Entity es[10];
+        for (u32 i = 0; i < 10; ++i)
+        {
+            es[i] = ecs.spawn();
+            ecs.add<u32>(es[i], i);
+            if (i % 2 == 0)
+                ecs.add<Enemy>(es[i]);
+        }
+        ecs.add<Selected>(es[3], Selected{});
+        TEST(ecs.count<Enemy>() == 5);
+        TEST(ecs.has<Enemy>(es[4]));
+        TEST(!ecs.has<Enemy>(es[5]));
+        TEST((ecs.hasAll<u32, Selected>(es[3])));
+
+        ecs.remove<Enemy>(es[0]);
+        ecs.despawn(es[8]);
+        TEST(ecs.count<Enemy>() == 3);
+        Span<const Entity> enemies = ecs.getEntities<Enemy>();
+        TEST(enemies.count == 3);
+        u32 sum = 0;
+        for (Entity e : enemies)
+            sum += ecs.get<u32>(e);
+        TEST(sum == 2 + 4 + 6);
+
+        u32 visited = 0;
+        ecs.forEach<Enemy>([&](Entity, Enemy&) { ++visited; });
+        ecs.forEach<u32, Enemy>([&](u32& v, Enemy&) { visited += v; });
+        TEST(visited == 3 + 12);
+        u32 removed = 0;
+        ecs.forEachRemoved<Enemy>(0, [&](Entity) { ++removed; });
+        TEST(removed == 2);
+
+        // Owned, sorted and batch added like other components
+        ecs.group<u32, Enemy>();
+        TEST(ecs.groups[0].count == 3);
+        Array<Entity> more{};
+        more.resize(4);
+        ecs.spawnMany(more);
+        ecs.addMany<u32>(more, 100u);
+        ecs.addMany<Enemy>(more, Enemy{});
+        TEST(ecs.groups[0].count == 7);
+        visited = 0;
+        ecs.forEach<u32, Enemy>([&](u32& v, Enemy&) { visited += v; });
+        TEST(visited == 412);
+
+        ecs.sortToMatch<Selected, u32>();
+        TEST(ecs.has<Selected>(es[3]));
+
+        // Serialized as only the entities
+        World copy{};
+        ArenaScope arena = getScratch();
+        Serializer w = serialWriter(arena);
+        serialize(&w, &ecs);
+        Serializer r = serialReader(arena, w.current);
+        serialize(&r, &copy);
+        TEST(copy.count<Enemy>() == 7);
+        TEST(copy.count<Selected>() == 1);
+        u32 copied = 0;
+        copy.forEach<u32, Enemy>([&](u32& v, Enemy&) { copied += v; });
+        TEST(copied == 412);
+
+        // Streamed and read in place the same
+        SerialStream stream{};
+        BinaryBuilder bin{arena};
+        Serializer sw = serialStreamWriter(&stream, &bin);
+        serialize(&sw, &ecs);
+        TEST(serialStreamEnd(&stream));
+        SerialBinReader reader{};
+        Serializer sr = serialBinReader(&reader, serialBinRoot(bin));
+        World inPlace{};
+        serialize(&sr, &inPlace);
+        TEST(inPlace.count<Enemy>() == 7);
+        TEST(inPlace.count<Selected>() == 1);
+        copied = 0;
+        inPlace.forEach<u32, Enemy>([&](u32& v, Enemy&) { copied += v; });
+        TEST(copied == 412);
+
+        // Snapshots and merges restore and move the counts with the entities
+        EcsSnapshots<u32, Enemy, Selected> snapshots{2};
+        snapshots.snapshot(ecs);
+        ecs.despawn(es[2]);
+        ecs.remove<Selected>(es[3]);
+        snapshots.restore(ecs);
+        TEST(ecs.count<Enemy>() == 7);
+        TEST(ecs.has<Enemy>(es[2]));
+        TEST(ecs.has<Selected>(es[3]));
+
+        ecs.merge(copy);
+        TEST(ecs.count<Enemy>() == 14);
+        TEST(ecs.count<Selected>() == 2);
+        TEST(ecs.groups[0].count == 14);
+    }
+
+    // ============================================================================
+    // Snapshots
+    // ============================================================================
+
+    // Deltas reproduce frames of different lengths
+    {
+        u64 a[] = {1, 2, 3, 0, 0, 5, 6};
+        u64 b[] = {1, 7, 3, 0, 9};
+        Array<u64> delta{};
+        Array<u64> frame{};
+        for (u64 w : a)
+            frame.push(w);
+
+        ecsDeltaEncode(&delta, a, 7, b, 5);
+        ecsDeltaApply(&frame, delta);
+        TEST(frame.count == 5);
+        TEST(memcmp(frame.vals, b, sizeof(b)) == 0);
+
+        ecsDeltaEncode(&delta, b, 5, a, 7);
+        ecsDeltaApply(&frame, delta);
+        TEST(frame.count == 7);
+        TEST(memcmp(frame.vals, a, sizeof(a)) == 0);
+
+        ecsDeltaEncode(&delta, a, 7, a, 7);
+        TEST(delta.count == 1);
+    }
+
+    // Restoring returns the world to each snapshot, back to the capacity
+    {
+        using World = Ecs<u32, Vec3, f32>;
+        World ecs{};
+        ecs.group<u32, Vec3>();
+        ecs.track<f32>();
+        Rng rng{7};
+
+        auto checksum = [&]
+        {
+            u64 sum = ecs.entities.handles.count * 1000003 + ecs.entities.freed.count;
+            const World& view = ecs;
+            view.forEach<u32>([&](Entity e, const u32& v) { sum += (u64)e.handle.id * 31 + v; });
+            view.forEach<Vec3>([&](Entity e, const Vec3& v) { sum += (u64)e.handle.id * 17 + (u64)v.x; });
+            view.forEach<f32>([&](Entity e, const f32& v) { sum += (u64)e.handle.id * 13 + (u64)v; });
+            return sum;
+        };
+        auto step = [&]
+        {
+            for (u32 i = 0; i < 20; ++i)
+            {
+                Entity e = ecs.spawn();
+                ecs.add<u32>(e, rng.next() % 100);
+                if (rng.next() % 2 == 0)
+                    ecs.add<Vec3>(e, Vec3{(f32)(rng.next() % 100)});
+                if (rng.next() % 3 == 0)
+                    ecs.add<f32>(e, (f32)(rng.next() % 100));
+            }
+            for (u32 i = 0; i < 8; ++i)
+            {
+                Entity e{ecs.entities.handles[rng.next() % ecs.entities.handles.count]};
+                if (ecs.alive(e))
+                    ecs.despawn(e);
+            }
+            ecs.forEach<u32>([&](u32& v) { v += 1; });
+            ecs.advanceTick();
+        };
+
+        EcsSnapshots<u32, Vec3, f32> snapshots{4};
+        TEST(snapshots.capacity() == 4);
+        u64 sums[8];
+        for (u32 i = 0; i < 8; ++i)
+        {
+            step();
+            sums[i] = checksum();
+            snapshots.snapshot(ecs);
+        }
+        TEST(snapshots.count == 4);
+
+        step();
+        snapshots.restore(ecs);
+        TEST(checksum() == sums[7]);
+        TEST(ecs.changeTick == 9);
+
+        snapshots.restore(ecs, 2);
+        TEST(checksum() == sums[5]);
+        TEST(snapshots.count == 2);
+
+        // Lookups, groups and the pool match the restored storage
+        bool valid = true;
+        const World& view = ecs;
+        Span<const Entity> es = ecs.getEntities<u32>();
+        for (u64 i = 0; i < es.count; ++i)
+            valid = valid && view.has<u32>(es[i]) && &view.get<u32>(es[i]) == &ecs.getComponents<u32>()[i];
+        TEST(valid);
+        u32 grouped = 0;
+        ecs.forEach<u32, Vec3>([&](u32&, Vec3&) { ++grouped; });
+        u32 both = 0;
+        for (Entity e : es)
+            both += view.has<Vec3>(e);
+        TEST(grouped == both);
+        TEST(ecs.getComponentSystem<f32>().added.count == ecs.count<f32>());
+
+        // Snapshots continue from the restored one, and replaying the same
+        // steps from a restore gives the same world
+        Rng replay = rng;
+        step();
+        u64 after = checksum();
+        snapshots.snapshot(ecs);
+        step();
+        snapshots.restore(ecs, 1);
+        TEST(checksum() == sums[5]);
+        rng = replay;
+        step();
+        TEST(checksum() == after);
+    }
+
     // ============================================================================
     // getSmallestEntities
     // ============================================================================
@@ -1413,4 +2677,362 @@ void testEcs()
         });
         TEST(sum == 33);
     }
+
+    // ============================================================================
+    // ECS Serialization: Bulk components
+    // ============================================================================
+
+    // Arithmetic and math types are written as an index blob and a value
+    // blob, other types only if they opt in
+    {
+        static_assert(!ecsSerializeBulk<EntityRefComp>);
+        Ecs<u32, Vec3, EntityRefComp> ecs{};
+        Entity es[100];
+        for (u32 i = 0; i < 100; ++i)
+        {
+            es[i] = ecs.spawn();
+            ecs.add<u32>(es[i], i);
+            if (i % 3 == 0)
+                ecs.add<Vec3>(es[i], Vec3{(f32)i, 1.0f, 2.0f});
+        }
+        ecs.add<EntityRefComp>(es[4], EntityRefComp{es[6], 9});
+        for (u32 i = 0; i < 100; i += 10)
+            ecs.despawn(es[i]);
+
+        ArenaScope arena = getScratch();
+        Serializer w = serialWriter(arena);
+        serialize(&w, &ecs);
+
+        // Entity count, then a count and two blobs per bulk type, then a
+        // count and an index and the target and data fields per reference
+        TEST(w.current->data.get<SerialObject>().childCount == 1 + 3 + 3 + 4);
+
+        BinaryView bin = writeSerialBinary(arena, &w);
+        Serializer r = readSerialBinary(arena, bin);
+        Ecs<u32, Vec3, EntityRefComp> copy{};
+        copy.track<Vec3>();
+        copy.group<u32, Vec3>();
+        Entity existing = copy.spawn();
+        copy.add<u32>(existing, 1000);
+        copy.add<Vec3>(existing, Vec3{-1.0f});
+        serialize(&r, &copy);
+
+        TEST(copy.count<u32>() == 91);
+        TEST(copy.count<Vec3>() == 31);
+        TEST(copy.count<EntityRefComp>() == 1);
+        TEST(copy.groups[0].count == 31);
+
+        bool matches = true;
+        u32 sum = 0;
+        copy.forEach<u32, Vec3>([&](u32& v, Vec3& p)
+        {
+            matches = matches && (v == 1000 ? p.x == -1.0f : p == Vec3{(f32)v, 1.0f, 2.0f});
+            sum += v;
+        });
+        TEST(matches);
+        u32 expected = 1000;
+        for (u32 i = 0; i < 100; ++i)
+        {
+            if (i % 3 == 0 && i % 10 != 0)
+                expected += i;
+        }
+        TEST(sum == expected);
+
+        u32 added = 0;
+        copy.forEachAdded<Vec3>(0, [&](Vec3&) { ++added; });
+        TEST(added == 31);
+
+        copy.forEach<EntityRefComp>([&](Entity e, EntityRefComp& ref)
+        {
+            TEST(copy.get<u32>(e) == 4);
+            TEST(copy.get<u32>(ref.target) == 6);
+        });
+    }
+
+    // ============================================================================
+    // Archetype storage
+    // ============================================================================
+    //
+    // EcsArchetype shares the entity, component and query API with Ecs, so the
+    // same checks run against both storages before the archetype specifics.
+
+    auto sharedApi = []<template<typename...> typename World>()
+    {
+        // Add, get and remove keep other components intact
+        {
+            World<u32, f32, u64> ecs{};
+            Entity a = ecs.spawn();
+            Entity b = ecs.spawn();
+            ecs.template add<u32>(a, 1);
+            ecs.template add<f32>(a, 2.0f);
+            ecs.template add<u32>(b, 3);
+            ecs.template add<u64>(a, 4);
+            TEST((ecs.template hasAll<u32, f32, u64>(a)));
+            TEST(ecs.template get<u32>(a) == 1 && ecs.template get<f32>(a) == 2.0f && ecs.template get<u64>(a) == 4);
+
+            ecs.template remove<f32>(a);
+            TEST(!ecs.template has<f32>(a));
+            TEST(ecs.template get<u32>(a) == 1 && ecs.template get<u64>(a) == 4);
+            TEST(ecs.template get<u32>(b) == 3);
+            TEST(ecs.template count<u32>() == 2);
+            TEST(ecs.template count<f32>() == 0);
+            TEST(ecs.getEntity(ecs.template get<u32>(b)) == b);
+
+            ecs.despawn(a);
+            TEST(!ecs.alive(a));
+            TEST(ecs.template get<u32>(b) == 3);
+            TEST(ecs.template count<u64>() == 0);
+        }
+
+        // Despawning a batch
+        {
+            World<u32, f32, u64> ecs{};
+            Entity es[6];
+            for (u32 i = 0; i < 6; ++i)
+            {
+                es[i] = ecs.spawn();
+                ecs.template add<u32>(es[i], i);
+                if (i % 2 == 0)
+                    ecs.template add<f32>(es[i], (f32)i);
+            }
+            ecs.despawnMany(Span<const Entity>{es + 1, 3});
+            TEST(!ecs.alive(es[1]) && !ecs.alive(es[2]) && !ecs.alive(es[3]));
+            TEST(ecs.template count<u32>() == 3);
+            TEST(ecs.template count<f32>() == 2);
+            TEST(ecs.template get<f32>(es[4]) == 4.0f);
+        }
+
+        // Spawning a batch and instantiating prefabs
+        {
+            World<u32, f32, u64> ecs{};
+            Entity gone = ecs.spawn();
+            ecs.despawn(gone);
+
+            Entity empty[3];
+            ecs.spawnMany(empty);
+            TEST(empty[0].handle.idx() == gone.handle.idx() && empty[0] != gone);
+            TEST(ecs.alive(empty[2]));
+            TEST((!ecs.template hasAny<u32, f32, u64>(empty[2])));
+
+            EcsPrefab<u32, f32, u64> prefab{};
+            prefab.set<u32>(7u);
+            prefab.set<f32>(1.5f);
+            TEST(prefab.has<u32>() && !prefab.has<u64>());
+
+            Array<Entity> es{};
+            es.resize(100);
+            ecs.instantiate(prefab, es);
+            TEST(ecs.template count<u32>() == 100);
+            TEST(ecs.template count<f32>() == 100);
+            TEST(ecs.template count<u64>() == 0);
+            u32 sum = 0;
+            ecs.template forEach<u32, f32>([&](u32& v, f32& f) { sum += v + (u32)(f * 2.0f); });
+            TEST(sum == 1000);
+
+            ecs.template get<u32>(es[10]) = 3;
+            ecs.template add<u64>(es[10], 4);
+            EcsPrefab<u32, f32, u64> copied = ecs.prefab(es[10]);
+            TEST(copied.get<u32>() == 3 && copied.get<f32>() == 1.5f && copied.get<u64>() == 4);
+            copied.remove<f32>();
+            Entity one[1];
+            ecs.instantiate(copied, one);
+            TEST((ecs.template hasAll<u32, u64>(one[0])));
+            TEST(!ecs.template has<f32>(one[0]));
+            TEST(ecs.template get<u64>(one[0]) == 4);
+        }
+
+        // Pack add and remove
+        {
+            World<u32, f32, u64> ecs{};
+            Entity e = ecs.spawn();
+            ecs.template add<u32, f32>(e, 5u, 6.0f);
+            TEST(ecs.template get<u32>(e) == 5 && ecs.template get<f32>(e) == 6.0f);
+            ecs.template add<u64>(e);
+            ecs.template remove<u32, u64>(e);
+            TEST((!ecs.template hasAny<u32, u64>(e)));
+            TEST(ecs.template get<f32>(e) == 6.0f);
+        }
+
+        // Queries visit exactly the entities with every component
+        {
+            World<u32, f32, u64> ecs{};
+            for (u32 i = 0; i < 1000; ++i)
+            {
+                Entity e = ecs.spawn();
+                ecs.template add<u32>(e, i);
+                if (i % 2 == 0)
+                    ecs.template add<f32>(e, (f32)i);
+                if (i % 3 == 0)
+                    ecs.template add<u64>(e, i);
+            }
+
+            u64 sum = 0;
+            u64 visits = 0;
+            ecs.template forEach<u32, f32>([&](Entity e, u32& a, f32& b)
+            {
+                sum += a + (u64)b;
+                visits += ecs.template has<u32>(e);
+            });
+            TEST(visits == 500);
+            TEST(sum == 2 * 249500);
+
+            u64 triples = 0;
+            ecs.template forEach<u32, f32, u64>([&](u32&, f32&, u64&) { ++triples; });
+            TEST(triples == 167);
+
+            u64 singles = 0;
+            ecs.template forEach<u64>([&](Entity) { ++singles; });
+            TEST(singles == 334);
+
+            const auto& constEcs = ecs;
+            u64 constSum = 0;
+            constEcs.template forEach<u32>([&](const u32& a) { constSum += a; });
+            TEST(constSum == 499500);
+
+            std::atomic<u64> parSum{0};
+            ecs.template forEachPar<u32, u64>([&](u32& a, u64&) { parSum += a; });
+            TEST(parSum.load() == 166833);
+        }
+
+        // Chunks hold the entities and components of the queries, and writes
+        // to them persist
+        {
+            World<u32, f32, u64> ecs{};
+            for (u32 i = 0; i < 3000; ++i)
+            {
+                Entity e = ecs.spawn();
+                ecs.template add<u32>(e, i);
+                if (i % 2 == 0)
+                    ecs.template add<f32>(e, 1.0f);
+            }
+
+            u64 chunks = 0;
+            u64 visits = 0;
+            bool matched = true;
+            ecs.template forEachChunk<u32, f32>([&](Span<const Entity> es, Span<u32> a, Span<f32> b)
+            {
+                matched = matched && es.count <= ecsChunkSize && a.count == es.count && b.count == es.count;
+                for (u64 i = 0; i < es.count; ++i)
+                {
+                    matched = matched && a[i] == es[i].handle.id;
+                    b[i] += (f32)a[i];
+                }
+                ++chunks;
+                visits += es.count;
+            });
+            TEST(matched);
+            TEST(visits == 1500);
+            TEST(chunks >= 2);
+
+            const auto& constEcs = ecs;
+            f64 sum = 0.0;
+            constEcs.template forEachChunk<f32>([&](Span<const Entity>, Span<const f32> b)
+            {
+                for (f32 v : b)
+                    sum += v;
+            });
+            TEST(sum == 1500.0 + 1499.0 * 1500.0);
+
+            std::atomic<u64> parVisits{0};
+            ecs.template forEachChunkPar<u32, f32>([&](Span<const Entity> es, Span<u32> a, Span<f32> b)
+            {
+                for (u64 i = 0; i < es.count; ++i)
+                    b[i] = (f32)a[i];
+                parVisits += es.count;
+            });
+            TEST(parVisits.load() == 1500);
+            f64 parSum = 0.0;
+            constEcs.template forEach<f32>([&](const f32& v) { parSum += v; });
+            TEST(parSum == 1499.0 * 1500.0);
+        }
+
+        // Components are destroyed exactly once
+        {
+            Lifecycle::stats.reset();
+            {
+                World<Lifecycle, u32> ecs{};
+                Entity a = ecs.spawn();
+                Entity b = ecs.spawn();
+                ecs.template add<Lifecycle>(a);
+                ecs.template add<Lifecycle>(b);
+                ecs.template add<u32>(a, 1);
+                ecs.template remove<u32>(a);
+                TEST(Lifecycle::stats.alive == 2);
+                ecs.despawn(a);
+                TEST(Lifecycle::stats.alive == 1);
+                ecs.template clear<Lifecycle>();
+                TEST(Lifecycle::stats.alive == 0);
+                ecs.template add<Lifecycle>(b);
+            }
+            TEST(Lifecycle::stats.alive == 0);
+        }
+    };
+    sharedApi.template operator()<Ecs>();
+    sharedApi.template operator()<EcsArchetype>();
+
+    // Entities with the same components share a table
+    {
+        EcsArchetype<u32, f32> ecs{};
+        Entity a = ecs.spawn();
+        Entity b = ecs.spawn();
+        Entity c = ecs.spawn();
+        ecs.add<u32, f32>(a);
+        ecs.add<u32, f32>(b);
+        ecs.add<u32>(c);
+        TEST(ecs.locations[a.handle.idx()].table == ecs.locations[b.handle.idx()].table);
+        TEST(ecs.locations[a.handle.idx()].table != ecs.locations[c.handle.idx()].table);
+        TEST(ecs.tables.count == 3);
+    }
+
+    // Moving a row out of a table fixes the location of the swapped row
+    {
+        EcsArchetype<u32, f32> ecs{};
+        Entity es[4];
+        for (u32 i = 0; i < 4; ++i)
+        {
+            es[i] = ecs.spawn();
+            ecs.add<u32>(es[i], i);
+        }
+        ecs.add<f32>(es[1], 1.0f);
+        ecs.despawn(es[0]);
+        for (u32 i = 1; i < 4; ++i)
+        {
+            TEST(ecs.get<u32>(es[i]) == i);
+        }
+        TEST(ecs.get<f32>(es[1]) == 1.0f);
+    }
+
+    // Serialized data is interchangeable between storages
+    {
+        Ecs<u32, EntityRefComp> ecs{};
+        Entity a = ecs.spawn();
+        Entity b = ecs.spawn();
+        ecs.add<u32>(a, 7);
+        ecs.add<EntityRefComp>(a, EntityRefComp{b, 42});
+        ecs.add<u32>(b, 8);
+
+        ArenaScope arena = getScratch();
+        Serializer w = serialWriter(arena);
+        serialize(&w, &ecs);
+        Serializer r = serialReader(arena, w.current);
+        EcsArchetype<u32, EntityRefComp> copy{};
+        serialize(&r, &copy);
+
+        TEST(copy.count<u32>() == 2);
+        TEST(copy.count<EntityRefComp>() == 1);
+        u32 sum = 0;
+        copy.forEach<u32, EntityRefComp>([&](u32& v, EntityRefComp& ref)
+        {
+            sum += v + ref.data + copy.get<u32>(ref.target);
+        });
+        TEST(sum == 57);
+
+        Serializer w2 = serialWriter(arena);
+        serialize(&w2, &copy);
+        Serializer r2 = serialReader(arena, w2.current);
+        Ecs<u32, EntityRefComp> back{};
+        serialize(&r2, &back);
+        TEST(back.count<u32>() == 2);
+        TEST(back.count<EntityRefComp>() == 1);
+    }
 }
@@ -0,0 +1,299 @@
+#include "tests.hpp"
+#include "hg/heap.hpp"
+
+struct HeapItem {
+    u32 key = 0;
+    Lifecycle life{};
+};
+
+static bool operator<(const HeapItem& lhs, const HeapItem& rhs)
+{
+    return lhs.key < rhs.key;
+}
+
+void testHeap()
+{
+    // ============================================================================
+    // Heap
+    // ============================================================================
+    //
+    // Heap is a move-only, heap-allocated 4-ary min heap ordered by operator<.
+    // Supports push, pushMany, peek, pop, reserve, and bulk heapify.
+
+    // Default-constructed heap is empty
+    {
+        Heap<u32> h;
+        TEST(h.vals == nullptr);
+        TEST(h.count == 0);
+        TEST(h.capacity == 0);
+    }
+
+    // Construct with initial capacity
+    {
+        Heap<u32> h{16};
+        TEST(h.vals != nullptr);
+        TEST(h.capacity == 16);
+        TEST(h.count == 0);
+    }
+
+    // pop returns values in ascending order
+    {
+        Heap<u32> h;
+        u32 vals[] = {5, 3, 9, 1, 7, 2, 8, 6, 4, 0};
+        for (u32 v : vals)
+            h.push(v);
+        TEST(h.count == 10);
+        TEST(h.peek() == 0);
+        for (u32 i = 0; i < 10; ++i)
+            TEST(h.pop() == i);
+        TEST(h.count == 0);
+    }
+
+    // Duplicate values are all returned
+    {
+        Heap<u32> h;
+        h.push(2);
+        h.push(1);
+        h.push(2);
+        h.push(1);
+        TEST(h.pop() == 1);
+        TEST(h.pop() == 1);
+        TEST(h.pop() == 2);
+        TEST(h.pop() == 2);
+    }
+
+    // Interleaved push and pop keeps heap order
+    {
+        Heap<u32> h;
+        h.push(10);
+        h.push(4);
+        TEST(h.pop() == 4);
+        h.push(7);
+        h.push(1);
+        TEST(h.pop() == 1);
+        TEST(h.pop() == 7);
+        TEST(h.pop() == 10);
+    }
+
+    // Many values across several levels
+    {
+        Heap<u32> h;
+        for (u32 i = 0; i < 1000; ++i)
+            h.push((i * 7919) % 1000);
+        bool ordered = true;
+        for (u32 i = 0; i < 1000; ++i)
+            ordered = ordered && h.pop() == i;
+        TEST(ordered);
+    }
+
+    // Construct from a span with bulk heapify
+    {
+        u32 vals[] = {9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+        Heap<u32> h{Span<const u32>{vals}};
+        TEST(h.count == 10);
+        for (u32 i = 0; i < 10; ++i)
+            TEST(h.pop() == i);
+    }
+
+    // pushMany into an empty heap
+    {
+        u32 vals[] = {3, 1, 2};
+        Heap<u32> h;
+        h.pushMany(Span<const u32>{vals});
+        TEST(h.count == 3);
+        TEST(h.pop() == 1);
+        TEST(h.pop() == 2);
+        TEST(h.pop() == 3);
+    }
+
+    // pushMany into a larger heap sifts each value
+    {
+        Heap<u32> h;
+        for (u32 i = 10; i < 20; ++i)
+            h.push(i);
+        u32 vals[] = {25, 5};
+        h.pushMany(Span<const u32>{vals});
+        TEST(h.count == 12);
+        TEST(h.pop() == 5);
+        TEST(h.pop() == 10);
+    }
+
+    // reset removes all values
+    {
+        Heap<u32> h;
+        h.push(1);
+        h.push(2);
+        h.reset();
+        TEST(h.count == 0);
+        h.push(3);
+        TEST(h.pop() == 3);
+    }
+
+    // Move construct
+    {
+        Heap<u32> a;
+        a.push(1);
+        u32* oldVals = a.vals;
+        Heap<u32> b = std::move(a);
+        TEST(a.vals == nullptr);
+        TEST(b.vals == oldVals);
+        TEST(b.pop() == 1);
+    }
+
+    // Destructor destroys remaining values
+    {
+        Lifecycle::stats.reset();
+        {
+            Heap<HeapItem> h;
+            h.push(HeapItem{3, {}});
+            h.push(HeapItem{1, {}});
+            h.push(HeapItem{2, {}});
+            TEST(h.pop().key == 1);
+        }
+        TEST(Lifecycle::stats.alive == 0);
+        TEST(Lifecycle::stats.copies == 0);
+    }
+
+    // ============================================================================
+    // HeapTemp
+    // ============================================================================
+    //
+    // HeapTemp is an arena-allocated 4-ary min heap.
+
+    // Default-constructed HeapTemp is empty
+    {
+        HeapTemp<u32> h;
+        TEST(h.arena == nullptr);
+        TEST(h.vals == nullptr);
+        TEST(h.count == 0);
+    }
+
+    // Create with arena and initial capacity
+    {
+        ArenaScope arena = getScratch();
+        HeapTemp<u32> h{arena, 16};
+        TEST(h.arena == arena);
+        TEST(h.vals != nullptr);
+        TEST(h.capacity == 16);
+    }
+
+    // pop returns values in ascending order
+    {
+        ArenaScope arena = getScratch();
+        HeapTemp<u32> h{arena, 0};
+        for (u32 i = 0; i < 200; ++i)
+            h.push((i * 37) % 200);
+        bool ordered = true;
+        for (u32 i = 0; i < 200; ++i)
+            ordered = ordered && h.pop() == i;
+        TEST(ordered);
+    }
+
+    // Construct from a span with bulk heapify
+    {
+        ArenaScope arena = getScratch();
+        u32 vals[] = {4, 2, 3, 1};
+        HeapTemp<u32> h{arena, Span<const u32>{vals}};
+        TEST(h.pop() == 1);
+        TEST(h.pop() == 2);
+        TEST(h.pop() == 3);
+        TEST(h.pop() == 4);
+    }
+
+    // Move construct
+    {
+        ArenaScope arena = getScratch();
+        HeapTemp<u32> a{arena, 0};
+        a.push(99);
+        HeapTemp<u32> b = std::move(a);
+        TEST(a.vals == nullptr);
+        TEST(b.pop() == 99);
+    }
+
+    // ============================================================================
+    // IndexedHeap
+    // ============================================================================
+    //
+    // IndexedHeap is a min heap of unique keys whose priorities can be changed
+    // or removed through an index map.
+
+    // Keys pop in priority order
+    {
+        IndexedHeap<u32, f32> h;
+        h.push(1, 3.0f);
+        h.push(2, 1.0f);
+        h.push(3, 2.0f);
+        TEST(h.count() == 3);
+        TEST(h.peek().key == 2);
+        TEST(h.pop().key == 2);
+        TEST(h.pop().key == 3);
+        TEST(h.pop().key == 1);
+        TEST(h.count() == 0);
+    }
+
+    // Decrease key moves a key to the top
+    {
+        IndexedHeap<u32, f32> h;
+        for (u32 i = 0; i < 50; ++i)
+            h.push(i, static_cast<f32>(i) + 10.0f);
+        h.update(40, 0.0f);
+        TEST(h.priority(40) == 0.0f);
+        TEST(h.pop().key == 40);
+        TEST(h.pop().key == 0);
+    }
+
+    // Increase key moves a key down
+    {
+        IndexedHeap<u32, f32> h;
+        h.push(1, 1.0f);
+        h.push(2, 2.0f);
+        h.push(3, 3.0f);
+        h.update(1, 5.0f);
+        TEST(h.pop().key == 2);
+        TEST(h.pop().key == 3);
+        TEST(h.pop().key == 1);
+    }
+
+    // Pushing an existing key updates its priority
+    {
+        IndexedHeap<u32, f32> h;
+        h.push(7, 9.0f);
+        h.push(8, 5.0f);
+        h.push(7, 1.0f);
+        TEST(h.count() == 2);
+        TEST(h.pop().key == 7);
+    }
+
+    // Remove a key from the middle of the heap
+    {
+        IndexedHeap<u32, u32> h;
+        for (u32 i = 0; i < 20; ++i)
+            h.push(i, 20 - i);
+        TEST(h.remove(10));
+        TEST(!h.remove(10));
+        TEST(!h.has(10));
+        TEST(h.count() == 19);
+        u32 prev = 0;
+        bool ordered = true;
+        while (h.count() > 0)
+        {
+            IndexedHeap<u32, u32>::Entry e = h.pop();
+            ordered = ordered && e.priority >= prev && e.key != 10;
+            prev = e.priority;
+        }
+        TEST(ordered);
+    }
+
+    // Indices stay consistent after many updates
+    {
+        IndexedHeap<u32, u32> h;
+        for (u32 i = 0; i < 256; ++i)
+            h.push(i, (i * 131) % 256);
+        for (u32 i = 0; i < 256; i += 3)
+            h.update(i, (i * 17) % 300);
+        bool consistent = true;
+        for (u64 i = 0; i < h.entries.count; ++i)
+            consistent = consistent && *h.indices.get(h.entries[i].key) == i;
+        TEST(consistent);
+    }
+}
@@ -1,5 +1,6 @@
 #include "tests.hpp"
 #include "hg/pool.hpp"
+#include "hg/concurrency.hpp"
 
 void testPool()
 {
@@ -127,5 +128,140 @@ void testPool()
         Handle c = pool.alloc();
         TEST(c.idx() == 0);
     }
+
+    // ============================================================================
+    // ConcurrentHandlePool
+    // ============================================================================
+    //
+    // ConcurrentHandlePool allocates and frees the same handles as HandlePool
+    // from many threads at once, within a capacity fixed at creation.
+
+    // Generations match HandlePool on one thread
+    {
+        ConcurrentHandlePool pool{16};
+        HandlePool reference{};
+        Handle a = pool.alloc();
+        Handle b = pool.alloc();
+        TEST(a == reference.alloc());
+        TEST(b == reference.alloc());
+
+        pool.free(a);
+        reference.free(a);
+        TEST(!pool.alive(a));
+        TEST(pool.alive(b));
+        Handle c = pool.alloc();
+        TEST(c == reference.alloc());
+        TEST(c.idx() == a.idx());
+        TEST(c.generation() == a.nextGeneration().generation());
+        TEST(pool.slots() == 2);
+
+        pool.reset();
+        TEST(!pool.alive(b));
+        TEST(!pool.alive(c));
+        TEST(pool.alloc().idx() == 0);
+    }
+
+    // Batches reserve fresh indices, and release the unused ones
+    {
+        ConcurrentHandlePool pool{64};
+        HandleBatch batch = pool.reserve(8);
+        TEST(batch.end - batch.next == 8);
+        Handle a = pool.alloc(&batch);
+        Handle b = pool.alloc(&batch);
+        TEST(a.idx() == 0);
+        TEST(b.idx() == 1);
+        TEST(pool.alloc().idx() == 8);
+
+        pool.release(&batch);
+        TEST(batch.next == batch.end);
+        bool reused = true;
+        for (u32 i = 2; i < 8; ++i)
+            reused = reused && pool.alloc().idx() == i;
+        TEST(reused);
+        TEST(pool.alloc().idx() == 9);
+
+        // Nearly full pools reserve what is left
+        HandleBatch rest = pool.reserve(100);
+        TEST(rest.next == 10);
+        TEST(rest.end == 64);
+        HandleBatch none = pool.reserve(4);
+        TEST(none.next == none.end);
+    }
+
+    // A full pool fails to allocate without using more slots
+    {
+        ConcurrentHandlePool pool{4};
+        HandleBatch batch = pool.reserve(3);
+        Handle last = pool.alloc();
+        TEST(last.idx() == 3);
+        TEST(pool.alloc() == nullHandle);
+        TEST(pool.slots() == 4);
+
+        for (u32 i = 0; i < 3; ++i)
+            pool.alloc(&batch);
+        TEST(pool.alloc(&batch) == nullHandle);
+        TEST(pool.slots() == 4);
+
+        // Freed slots can be allocated again
+        pool.free(last);
+        TEST(pool.alloc() == last.nextGeneration());
+        TEST(pool.alloc() == nullHandle);
+    }
+
+    // Concurrent allocation and freeing gives unique live handles
+    {
+        static constexpr u32 n = 1 << 14;
+        ConcurrentHandlePool pool{n};
+        Handle* handles = heapAlloc<Handle>(n);
+        HG_DEFER(heapFree(handles, n));
+
+        // Every other handle is freed and allocated again while the rest are
+        // still being allocated, from batches and from the pool
+        forPar(0, 64, [&](u64 task)
+        {
+            u32 begin = static_cast<u32>(task) * (n / 64);
+            HandleBatch batch = pool.reserve(task % 2 == 0 ? 64 : 0);
+            for (u32 i = begin; i < begin + n / 64; ++i)
+            {
+                handles[i] = pool.alloc(&batch);
+                if (i % 2 == 0)
+                {
+                    pool.free(handles[i]);
+                    handles[i] = pool.alloc();
+                }
+            }
+            pool.release(&batch);
+        });
+
+        u8* seen = heapAlloc<u8>(n);
+        HG_DEFER(heapFree(seen, n));
+        memset(seen, 0, n);
+        bool unique = true;
+        for (u32 i = 0; i < n; ++i)
+        {
+            u32 idx = handles[i].idx();
+            unique = unique && pool.alive(handles[i]) && seen[idx] == 0;
+            seen[idx] = 1;
+        }
+        TEST(unique);
+
+        // Every freed slot comes back at its next generation
+        Handle* byIdx = heapAlloc<Handle>(n);
+        HG_DEFER(heapFree(byIdx, n));
+        for (u32 i = 0; i < n; ++i)
+            byIdx[handles[i].idx()] = handles[i];
+        forPar(0, n, [&](u64 i)
+        {
+            pool.free(handles[i]);
+        });
+        bool generations = true;
+        for (u32 i = 0; i < n; ++i)
+        {
+            Handle handle = pool.alloc();
+            generations = generations && handle == byIdx[handle.idx()].nextGeneration();
+        }
+        TEST(generations);
+        TEST(pool.slots() == n);
+    }
 }
 
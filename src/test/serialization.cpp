@@ -422,6 +422,181 @@ void testSerialization()
         TEST(memcmp(copy.b.data, val.b.data, val.b.size) == 0);
     }
 
+    // Streamed binary matches the binary written from a node tree
+    {
+        struct Data {
+            i64 a;
+            String b;
+            Array<Vec3> c;
+            Maybe<f32> d;
+            bool e;
+        };
+
+        auto serializeData = [](Serializer* s, Data* val)
+        {
+            serializeObject(s,
+                &val->a,
+                &val->b,
+                &val->c,
+                &val->d,
+                &val->e);
+        };
+
+        ArenaScope arena = getScratch();
+        Data val{};
+        val.a = -77;
+        val.b = String::create("streamed");
+        val.c = Array<Vec3>{0, 4};
+        val.c.push({1.0f, 2.0f, 3.0f});
+        val.c.push({4.0f, 5.0f, 6.0f});
+        val.d = some<f32>(0.5f);
+        val.e = true;
+
+        SerialStream stream{};
+        BinaryBuilder streamed{arena};
+        Serializer w = serialStreamWriter(&stream, &streamed);
+        serializeData(&w, &val);
+        TEST(serialStreamEnd(&stream));
+
+        Serializer tree = serialWriter(arena);
+        serializeData(&tree, &val);
+        BinaryView bin = writeSerialBinary(arena, &tree);
+        TEST(streamed.size == bin.size);
+
+        Data copy{};
+        Serializer r = readSerialBinary(arena, streamed);
+        serializeData(&r, &copy);
+        TEST(copy.a == val.a);
+        TEST(copy.b == val.b);
+        TEST(copy.c.count == 2);
+        TEST(copy.c[1].z == 6.0f);
+        TEST(copy.d.has);
+        TEST(copy.d.val == 0.5f);
+        TEST(copy.e);
+    }
+
+    // Streamed binary written to a file
+    {
+        ArenaScope arena = getScratch();
+        Array<u32> val{0, 100};
+        for (u32 i = 0; i < 100; ++i)
+            val.push(i * i);
+
+        SerialStream stream{};
+        Serializer w = serialStreamWriter(&stream, "/tmp/hg_serial_stream_test");
+        serialize(&w, &val);
+        TEST(serialStreamEnd(&stream));
+
+        Asset<Binary> file = load<Binary>("/tmp/hg_serial_stream_test");
+        Array<u32> copy{};
+        Serializer r = readSerialBinary(arena, *file);
+        serialize(&r, &copy);
+        TEST(copy.count == 100);
+        TEST(copy[99] == 99 * 99);
+
+        // A file which cannot be created writes nothing and fails
+        SerialStream missing{};
+        Serializer m = serialStreamWriter(&missing, "/tmp/hg_serial_missing_dir/file");
+        serialize(&m, &val);
+        TEST(!serialStreamEnd(&missing));
+    }
+
+    // Mapped binary read in place, whole and one field at a time
+    {
+        struct Data {
+            i64 a;
+            String b;
+            Array<u32> c;
+            f64 d;
+        };
+
+        auto serializeData = [](Serializer* s, Data* val)
+        {
+            serializeObject(s,
+                &val->a,
+                &val->b,
+                &val->c,
+                &val->d);
+        };
+
+        Data val{};
+        val.a = 12;
+        val.b = String::create("mapped");
+        val.c = Array<u32>{0, 50};
+        for (u32 i = 0; i < 50; ++i)
+            val.c.push(i * 3);
+        val.d = 2.5;
+
+        SerialStream stream{};
+        Serializer w = serialStreamWriter(&stream, "/tmp/hg_serial_mapped_test");
+        serializeData(&w, &val);
+        TEST(serialStreamEnd(&stream));
+
+        Maybe<MappedBinary> file = MappedBinary::map("/tmp/hg_serial_mapped_test");
+        TEST(file.has);
+        SerialBinValue root = serialBinRoot(*file);
+        TEST(root.valid());
+        TEST(root.is<SerialObject>());
+        TEST(root.count() == 4);
+
+        // Fields are found without reading the ones before them
+        TEST(root.field(3).floating() == 2.5);
+        TEST(root.field(0).integer() == 12);
+        StringView name = root.field(1).string();
+        TEST(name == "mapped");
+        TEST((name.chars > static_cast<const char*>(file->data)));
+        TEST((name.chars < static_cast<const char*>(file->data) + file->size));
+        SerialBinValue arr = root.field(2);
+        TEST(arr.count() == 52);
+        TEST(arr.field(51).integer() == 147);
+
+        // The serialize API reads in place, from the root or any field
+        Data copy{};
+        SerialBinReader reader{};
+        Serializer r = serialBinReader(&reader, root);
+        serializeData(&r, &copy);
+        TEST(copy.a == val.a);
+        TEST(copy.b == val.b);
+        TEST(copy.c.count == 50);
+        TEST(copy.c[49] == 147);
+        TEST(copy.d == val.d);
+
+        Array<u32> onlyArray{};
+        r = serialBinReader(&reader, arr);
+        serialize(&r, &onlyArray);
+        TEST(onlyArray.count == 50);
+        TEST(onlyArray[10] == 30);
+
+        StringView view{};
+        r = serialBinReader(&reader, root.field(1));
+        serialize(&r, &view);
+        TEST(view.chars == name.chars);
+
+        // Binaries without a header have no root
+        u8 garbage[64] = {};
+        TEST(!serialBinRoot({garbage, sizeof(garbage)}).valid());
+        TEST(!MappedBinary::map("/tmp/hg_serial_missing_dir/file").has);
+    }
+
+    // StringView and BinaryView read as views into the node tree
+    {
+        ArenaScope arena = getScratch();
+        u8 raw[3] = {1, 2, 3};
+        StringView str = "view";
+        BinaryView blob{raw, sizeof(raw)};
+
+        Serializer w = serialWriter(arena);
+        serializeObject(&w, &str, &blob);
+        BinaryView bin = writeSerialBinary(arena, &w);
+        Serializer r = readSerialBinary(arena, bin);
+        StringView strCopy{};
+        BinaryView blobCopy{};
+        serializeObject(&r, &strCopy, &blobCopy);
+        TEST(strCopy == "view");
+        TEST(blobCopy.size == 3);
+        TEST(static_cast<const u8*>(blobCopy.data)[2] == 3);
+    }
+
     {
         // Round-trip Product with primitive types (i64, f64, bool)
         {
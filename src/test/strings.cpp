@@ -1,5 +1,11 @@
 #include "tests.hpp"
 #include "hg/strings.hpp"
+#include "hg/noise.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 void testStrings()
 {
@@ -810,6 +816,21 @@ void testStrings()
         TEST(stringToInteger("-2147483648") == -2147483648);  // i32 min
     }
 
+    // i64 limits
+    {
+        TEST(stringToInteger("9223372036854775807") == INT64_MAX);
+        TEST(stringToInteger("-9223372036854775808") == INT64_MIN);
+    }
+
+    // Lengths around the eight digit chunks
+    {
+        TEST(stringToInteger("1234567") == 1234567);
+        TEST(stringToInteger("12345678") == 12345678);
+        TEST(stringToInteger("123456789") == 123456789);
+        TEST(stringToInteger("-1234567890123456") == -1234567890123456);
+        TEST(stringToInteger("00000000000000000007") == 7);
+    }
+
     // ============================================================================
     // stringToFloat
     // ============================================================================
@@ -872,6 +893,70 @@ void testStrings()
         TEST(std::abs(stringToFloat("0.")) <= FLT_EPSILON);
     }
 
+    // Zero exponent
+    {
+        TEST(stringToFloat("1e0") == 1.0);
+        TEST(stringToFloat("5e0") == 5.0);
+        TEST(stringToFloat("2.5e-0") == 2.5);
+    }
+
+    // Results are correctly rounded
+    {
+        TEST(stringToFloat("0.1") == 0.1);
+        TEST(stringToFloat("99.99") == 99.99);
+        TEST(stringToFloat("1e-3") == 0.001);
+        TEST(stringToFloat("1.7976931348623157e308") == DBL_MAX);
+        TEST(stringToFloat("2.2250738585072014e-308") == DBL_MIN);
+        TEST(stringToFloat("4.9406564584124654e-324") == DBL_TRUE_MIN);
+        TEST(stringToFloat("9007199254740993.0") == 9007199254740992.0);
+    }
+
+    // Out of range exponents
+    {
+        TEST(stringToFloat("1e-400") == 0.0);
+        TEST(std::isinf(stringToFloat("1e400")));
+        TEST(std::isinf(stringToFloat("-1e400")));
+        TEST(stringToFloat("0.0e99999999") == 0.0);
+    }
+
+    // More than 19 significant digits
+    {
+        TEST(stringToFloat("123456789012345678901234567890.0") == 123456789012345678901234567890.0);
+        TEST(stringToFloat("1.00000000000000011102230246251565404236316680908203125") == 1.0);
+        TEST(stringToFloat("1.00000000000000011102230246251565404236316680908203126") == 1.0000000000000002);
+    }
+
+    // Random decimal strings match strtod
+    {
+        Rng rng{42};
+        bool matches = true;
+        for (u32 i = 0; i < 10000; ++i)
+        {
+            char chars[64];
+            u32 length = 0;
+            u32 digitCount = rng.next() % 24 + 1;
+            u32 point = rng.next() % (digitCount + 1);
+            if (rng.next() % 2 == 0)
+                chars[length++] = '-';
+            for (u32 j = 0; j < digitCount; ++j)
+            {
+                if (j == point)
+                    chars[length++] = '.';
+                chars[length++] = static_cast<char>('0' + rng.next() % 10);
+            }
+            if (point == digitCount)
+                chars[length++] = '.';
+            if (rng.next() % 2 == 0)
+                length += static_cast<u32>(snprintf(chars + length, 16, "e%d", static_cast<i32>(rng.next() % 700) - 350));
+            chars[length] = '\0';
+
+            f64 expected = strtod(chars, nullptr);
+            f64 parsed = stringToFloat(chars);
+            matches = matches && memcmp(&expected, &parsed, sizeof(f64)) == 0;
+        }
+        TEST(matches);
+    }
+
     // ============================================================================
     // integerToString
     // ============================================================================
@@ -917,23 +1002,140 @@ void testStrings()
         TEST(integerToString(arena, -1000000) == "-1000000");
     }
 
-    // Large values (within f64 exact-representation range to avoid
-    // precision loss in the f64 division used by integerToString)
+    // Large values
     {
         ArenaScope arena = getScratch();
         TEST(integerToString(arena, 9000000000000000LL) == "9000000000000000");
+        TEST(integerToString(arena, 12345678901234567LL) == "12345678901234567");
+    }
+
+    // i64 limits
+    {
+        ArenaScope arena = getScratch();
+        TEST(integerToString(arena, INT64_MAX) == "9223372036854775807");
+        TEST(integerToString(arena, INT64_MIN) == "-9223372036854775808");
+    }
+
+    // Random integers match printf
+    {
+        ArenaScope arena = getScratch();
+        Rng rng{7};
+        bool matches = true;
+        for (u32 i = 0; i < 10000; ++i)
+        {
+            i64 num = static_cast<i64>(rng.next64()) >> (rng.next() % 64);
+            char expected[32];
+            snprintf(expected, sizeof(expected), "%lld", static_cast<long long>(num));
+            StringBuilder str = integerToString(arena, num);
+            matches = matches && str == StringView{expected} && stringToInteger(str) == num;
+        }
+        TEST(matches);
     }
 
     // ============================================================================
     // floatToString
     // ============================================================================
     //
-    // Formats an f64 into a base-10 string with a specified number of
-    // decimal places, allocated from an arena.
+    // Formats an f64 into the shortest base-10 string that parses back to the
+    // same value, or with a specified number of decimal places rounded to
+    // nearest, allocated from an arena.
     //
     // Functions covered:
+    // - floatToString(Arena*, f64)
     // - floatToString(Arena*, f64, u32 decimalCount)
 
+    // ------------------------------------------------------------------
+    // Shortest
+    // ------------------------------------------------------------------
+
+    // Zero keeps its sign
+    {
+        ArenaScope arena = getScratch();
+        TEST(floatToString(arena, 0.0) == "0.0");
+        TEST(floatToString(arena, -0.0) == "-0.0");
+    }
+
+    // Positional notation
+    {
+        ArenaScope arena = getScratch();
+        TEST(floatToString(arena, 1.0) == "1.0");
+        TEST(floatToString(arena, 120.0) == "120.0");
+        TEST(floatToString(arena, 0.1) == "0.1");
+        TEST(floatToString(arena, -3.14) == "-3.14");
+        TEST(floatToString(arena, 0.00001) == "0.00001");
+        TEST(floatToString(arena, 1e16) == "10000000000000000.0");
+    }
+
+    // Exponent notation
+    {
+        ArenaScope arena = getScratch();
+        TEST(floatToString(arena, 1e17) == "1e17");
+        TEST(floatToString(arena, 1e-6) == "1e-6");
+        TEST(floatToString(arena, -2.5e-10) == "-2.5e-10");
+        TEST(floatToString(arena, DBL_MAX) == "1.7976931348623157e308");
+        TEST(floatToString(arena, DBL_TRUE_MIN) == "5e-324");
+    }
+
+    // Non-finite values
+    {
+        ArenaScope arena = getScratch();
+        TEST(floatToString(arena, INFINITY) == "inf");
+        TEST(floatToString(arena, -INFINITY) == "-inf");
+        TEST(floatToString(arena, NAN) == "nan");
+    }
+
+    // Random values round-trip with the fewest digits printf needs
+    {
+        ArenaScope arena = getScratch();
+        Rng rng{1234};
+        bool roundTrips = true;
+        bool shortest = true;
+        for (u32 i = 0; i < 10000; ++i)
+        {
+            u64 bits = rng.next64();
+            if (i % 2 == 0)
+                bits = (bits & 0x800fffffffffffff) | (static_cast<u64>(rng.next() % 120 + 963) << 52);
+            f64 num;
+            memcpy(&num, &bits, sizeof(num));
+            if (std::isnan(num) || std::isinf(num))
+                continue;
+
+            StringBuilder str = floatToString(arena, num);
+            f64 parsed = strtod(cString(arena, str), nullptr);
+            f64 reparsed = stringToFloat(str);
+            roundTrips = roundTrips && isFloat(str)
+                && memcmp(&num, &parsed, sizeof(f64)) == 0
+                && memcmp(&num, &reparsed, sizeof(f64)) == 0;
+
+            u32 digitCount = 0;
+            u32 trailingZeros = 0;
+            for (u64 j = 0; j < str.length && str[j] != 'e'; ++j)
+            {
+                if (!isNumeral(str[j]) || (digitCount == 0 && str[j] == '0'))
+                    continue;
+                ++digitCount;
+                trailingZeros = str[j] == '0' ? trailingZeros + 1 : 0;
+            }
+            digitCount -= trailingZeros;
+
+            u32 precision = 1;
+            char expected[40];
+            for (; precision < 17; ++precision)
+            {
+                snprintf(expected, sizeof(expected), "%.*e", static_cast<i32>(precision) - 1, num);
+                if (strtod(expected, nullptr) == num)
+                    break;
+            }
+            shortest = shortest && digitCount == precision;
+        }
+        TEST(roundTrips);
+        TEST(shortest);
+    }
+
+    // ------------------------------------------------------------------
+    // Fixed decimals
+    // ------------------------------------------------------------------
+
     // Zero
     {
         ArenaScope arena = getScratch();
@@ -970,5 +1172,301 @@ void testStrings()
         TEST(floatToString(arena, 0.0, 0) == "0.0");
         TEST(floatToString(arena, 100.0, 0) == "100.");
     }
-}
 
+    // Decimals are rounded from the exact value, with ties to even
+    {
+        ArenaScope arena = getScratch();
+        TEST(floatToString(arena, 0.999, 2) == "1.00");
+        TEST(floatToString(arena, 1.0 / 3.0, 5) == "0.33333");
+        TEST(floatToString(arena, -0.0001, 2) == "-0.00");
+        TEST(floatToString(arena, 2.675, 2) == "2.67");
+        TEST(floatToString(arena, 0.045, 2) == "0.04");
+        TEST(floatToString(arena, 1.115, 2) == "1.11");
+        TEST(floatToString(arena, -10033.785, 2) == "-10033.78");
+        TEST(floatToString(arena, 2.25, 1) == "2.2");
+        TEST(floatToString(arena, 2.75, 1) == "2.8");
+        TEST(floatToString(arena, -0.5, 0) == "-0.");
+        TEST(floatToString(arena, 1.5, 0) == "2.");
+        TEST(floatToString(arena, 0.125, 25) == "0.1250000000000000000000000");
+    }
+
+    // Random values match printf, across every way of scaling them
+    {
+        ArenaScope arena = getScratch();
+        Rng rng{4321};
+        bool matches = true;
+        char expected[1200];
+        for (u32 i = 0; i < 20000; ++i)
+        {
+            u64 bits = rng.next64();
+            if (i % 4 != 0)
+                bits = (bits & 0x800fffffffffffff) | (static_cast<u64>(rng.next() % 160 + 943) << 52);
+            f64 num;
+            memcpy(&num, &bits, sizeof(num));
+            if (std::isnan(num) || std::isinf(num) || num == 0.0)
+                continue;
+
+            // Halves of small decimals land on exact ties
+            if (i % 8 == 1)
+                num = static_cast<f64>(static_cast<i64>(rng.next() % 20000) - 10000) / 8.0;
+
+            u32 decimalCount = i % 3 == 0 ? rng.next() % 40 : rng.next() % 8;
+            snprintf(expected, sizeof(expected), "%#.*f", static_cast<i32>(decimalCount), num);
+            matches = matches && floatToString(arena, num, decimalCount) == StringView{expected};
+        }
+        TEST(matches);
+    }
+
+    // Values too large to scale keep every integer digit
+    {
+        ArenaScope arena = getScratch();
+        TEST(floatToString(arena, 1e20, 2) == "100000000000000000000.00");
+        TEST(floatToString(arena, -1.5e19, 0) == "-15000000000000000000.");
+    }
+
+    // ============================================================================
+    // UTF-8
+    // ============================================================================
+    //
+    // Validation, decoding and encoding of UTF-8 text, and the scanning
+    // helpers used by text parsing. The vector paths handle 16 bytes per step,
+    // so inputs are shifted across block boundaries to reach the scalar tails.
+
+    // Validation by decoding one codepoint at a time, to compare against
+    auto decodesCleanly = [](StringView str)
+    {
+        u64 head = 0;
+        while (head < str.length)
+        {
+            u64 begin = head;
+            if (utf8Next(str, &head) == utf8Replacement && head == begin + 1)
+                return false;
+        }
+        return true;
+    };
+
+    // Pads a sequence with ASCII on both sides so it lands at every block offset
+    auto validAtEveryOffset = [](StringView seq, bool expected)
+    {
+        char chars[64];
+        for (u64 offset = 0; offset < 32; ++offset)
+        {
+            memset(chars, 'a', sizeof(chars));
+            memcpy(chars + offset, seq.chars, seq.length);
+            if (isUtf8({chars, offset + seq.length}) != expected)
+                return false;
+            if (isUtf8({chars, sizeof(chars)}) != expected)
+                return false;
+        }
+        return true;
+    };
+
+    // ------------------------------------------------------------------
+    // Validation
+    // ------------------------------------------------------------------
+
+    // ASCII
+    {
+        TEST(isAscii(""));
+        TEST(isAscii("hello"));
+        TEST(isAscii("the quick brown fox jumps over the lazy dog"));
+        TEST(!isAscii("the quick brown fox jumps over the lazy d\xc3\xb6g"));
+        TEST(!isAscii("caf\xc3\xa9"));
+        TEST(isUtf8(""));
+        TEST(isUtf8("the quick brown fox jumps over the lazy dog"));
+    }
+
+    // Valid sequences of every length
+    {
+        TEST(validAtEveryOffset("\xc3\xa9", true));
+        TEST(validAtEveryOffset("\xe2\x82\xac", true));
+        TEST(validAtEveryOffset("\xf0\x9f\x98\x80", true));
+        TEST(validAtEveryOffset("\xc2\x80\xdf\xbf\xe0\xa0\x80\xef\xbf\xbf", true));
+        TEST(validAtEveryOffset("\xed\x9f\xbf\xee\x80\x80\xf0\x90\x80\x80\xf4\x8f\xbf\xbf", true));
+    }
+
+    // Overlong encodings are invalid
+    {
+        TEST(validAtEveryOffset("\xc0\xaf", false));
+        TEST(validAtEveryOffset("\xc1\xbf", false));
+        TEST(validAtEveryOffset("\xe0\x80\xaf", false));
+        TEST(validAtEveryOffset("\xe0\x9f\xbf", false));
+        TEST(validAtEveryOffset("\xf0\x80\x80\xaf", false));
+        TEST(validAtEveryOffset("\xf0\x8f\xbf\xbf", false));
+    }
+
+    // Surrogates and codepoints past U+10FFFF are invalid
+    {
+        TEST(validAtEveryOffset("\xed\xa0\x80", false));
+        TEST(validAtEveryOffset("\xed\xbf\xbf", false));
+        TEST(validAtEveryOffset("\xf4\x90\x80\x80", false));
+        TEST(validAtEveryOffset("\xf5\x80\x80\x80", false));
+        TEST(validAtEveryOffset("\xff", false));
+    }
+
+    // Truncated sequences and stray continuation bytes are invalid
+    {
+        TEST(validAtEveryOffset("\xc3", false));
+        TEST(validAtEveryOffset("\xe2\x82", false));
+        TEST(validAtEveryOffset("\xf0\x9f\x98", false));
+        TEST(validAtEveryOffset("\x80", false));
+        TEST(validAtEveryOffset("\xc3\xa9\xa9", false));
+        TEST(validAtEveryOffset("\xe2\x82\xac\x80", false));
+        TEST(!isUtf8("abc\xe2\x82"));
+        TEST(!isUtf8("abcdefghijklmn\xf0\x9f"));
+        TEST(!isUtf8("abcdefghijklmno\xf0"));
+    }
+
+    // Random text agrees with decoding one codepoint at a time
+    {
+        Rng rng{31};
+        static constexpr u8 alphabet[] = {'a', ' ', 0x7f, 0x80, 0x9f, 0xa0, 0xbf, 0xc2, 0xdf, 0xe0, 0xed, 0xef, 0xf0, 0xf4, 0xf5};
+
+        bool agree = true;
+        u32 valid = 0;
+        char chars[48];
+        for (u32 i = 0; i < 200000; ++i)
+        {
+            u64 length = rng.next() % sizeof(chars);
+            for (u64 j = 0; j < length; ++j)
+                chars[j] = static_cast<char>(alphabet[rng.next() % sizeof(alphabet)]);
+
+            StringView str{chars, length};
+            bool expected = decodesCleanly(str);
+            agree = agree && isUtf8(str) == expected;
+            valid += expected;
+        }
+        TEST(agree);
+        TEST(valid > 1000);
+    }
+
+    // ------------------------------------------------------------------
+    // Decoding and encoding
+    // ------------------------------------------------------------------
+
+    // Length counts codepoints
+    {
+        TEST(utf8Length("") == 0);
+        TEST(utf8Length("hello") == 5);
+        TEST(utf8Length("caf\xc3\xa9") == 4);
+        TEST(utf8Length("\xe2\x82\xac\xf0\x9f\x98\x80 the quick brown fox \xc3\xa9") == 24);
+    }
+
+    // Next decodes one codepoint and skips invalid bytes
+    {
+        StringView str = "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\xff\xe2\x82";
+        u64 head = 0;
+        TEST(utf8Next(str, &head) == 'a' && head == 1);
+        TEST(utf8Next(str, &head) == 0xe9 && head == 3);
+        TEST(utf8Next(str, &head) == 0x20ac && head == 6);
+        TEST(utf8Next(str, &head) == 0x1f600 && head == 10);
+        TEST(utf8Next(str, &head) == utf8Replacement && head == 11);
+        TEST(utf8Next(str, &head) == utf8Replacement && head == 12);
+        TEST(utf8Next(str, &head) == utf8Replacement && head == 13);
+    }
+
+    // Decode handles runs of ASCII mixed with multibyte codepoints
+    {
+        StringView str = "The quick brown fox \xe2\x82\xac jumps over the lazy \xf0\x9f\x98\x80 dog";
+        u32 codepoints[64];
+        u64 count = utf8Decode(str, codepoints);
+        TEST(count == utf8Length(str));
+        TEST(codepoints[0] == 'T');
+        TEST(codepoints[20] == 0x20ac);
+        TEST(codepoints[42] == 0x1f600);
+        TEST(codepoints[count - 1] == 'g');
+    }
+
+    // Encode round trips through decode
+    {
+        bool roundTrips = true;
+        char chars[4];
+        for (u32 codepoint = 0; codepoint <= 0x10ffff; ++codepoint)
+        {
+            if (codepoint >= 0xd800 && codepoint <= 0xdfff)
+                continue;
+
+            u32 length = utf8Encode(codepoint, chars);
+            u64 head = 0;
+            roundTrips = roundTrips && utf8Next({chars, length}, &head) == codepoint && head == length;
+        }
+        TEST(roundTrips);
+    }
+
+    // Encode replaces codepoints that cannot be encoded
+    {
+        char chars[4];
+        TEST(utf8Encode(0xd800, chars) == 3);
+        TEST(StringView(chars, 3) == "\xef\xbf\xbd");
+        TEST(utf8Encode(0x110000, chars) == 3);
+        TEST(StringView(chars, 3) == "\xef\xbf\xbd");
+    }
+
+    // ------------------------------------------------------------------
+    // Scanning
+    // ------------------------------------------------------------------
+
+    // Find char
+    {
+        StringView str = "the quick brown fox jumps over the lazy dog";
+        TEST(findChar(str, 't') == 0);
+        TEST(findChar(str, 't', 1) == 31);
+        TEST(findChar(str, 'z') == 37);
+        TEST(findChar(str, 'g') == 42);
+        TEST(findChar(str, '!') == str.length);
+        TEST(findChar(str, 'g', str.length) == str.length);
+    }
+
+    // Find newline
+    {
+        StringView str = "first line of text\nsecond\n";
+        TEST(findNewline(str) == 18);
+        TEST(findNewline(str, 19) == 25);
+        TEST(findNewline(str, 26) == str.length);
+        TEST(findNewline("no newline") == 10);
+    }
+
+    // Find and skip whitespace
+    {
+        StringView str = "identifier_longer_than_sixteen\t \r\n  value";
+        TEST(findWhitespace(str) == 30);
+        TEST(skipWhitespace(str, 30) == 36);
+        TEST(findWhitespace(str, 36) == str.length);
+        TEST(skipWhitespace(str) == 0);
+        TEST(skipWhitespace("                    ") == 20);
+        TEST(findWhitespace("") == 0);
+    }
+
+    // Scanning agrees with a byte at a time search
+    {
+        Rng rng{32};
+        static constexpr char alphabet[] = {'a', 'b', ' ', '\t', '\n', '\r', '\v'};
+
+        bool agree = true;
+        char chars[80];
+        for (u32 i = 0; i < 20000; ++i)
+        {
+            u64 length = rng.next() % sizeof(chars);
+            for (u64 j = 0; j < length; ++j)
+                chars[j] = rng.next() % 4 == 0 ? alphabet[rng.next() % sizeof(alphabet)] : 'a';
+
+            StringView str{chars, length};
+            u64 begin = length == 0 ? 0 : rng.next() % length;
+
+            u64 newline = begin;
+            while (newline < length && chars[newline] != '\n')
+                ++newline;
+            u64 space = begin;
+            while (space < length && !isWhitespace(chars[space]))
+                ++space;
+            u64 word = begin;
+            while (word < length && isWhitespace(chars[word]))
+                ++word;
+
+            agree = agree && findNewline(str, begin) == newline;
+            agree = agree && findWhitespace(str, begin) == space;
+            agree = agree && skipWhitespace(str, begin) == word;
+        }
+        TEST(agree);
+    }
+}
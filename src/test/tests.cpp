@@ -26,18 +26,23 @@ int main()
     testGeometry3D();
     testNoise();
     testStrings();
+    testAtom();
     testBinary();
     testSmartPtr();
     testArray();
     testQueue();
+    testHeap();
     testSet();
     testMap();
+    testCache();
     testPool();
+    testTimer();
     testAssets();
     testSerialization();
     testGpu();
     testRender2D();
     testEcs();
+    testTransform();
 
     // Asset<TextureData> pixelFont = load<TextureData>("pixel-font.png");
     //
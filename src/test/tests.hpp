@@ -167,16 +167,21 @@ void testGeometry2D();
 void testGeometry3D();
 void testNoise();
 void testStrings();
+void testAtom();
 void testBinary();
 void testSmartPtr();
 void testArray();
 void testQueue();
+void testHeap();
 void testSet();
 void testMap();
+void testCache();
 void testPool();
+void testTimer();
 void testAssets();
 void testSerialization();
 void testGpu();
 void testRender2D();
 void testEcs();
+void testTransform();
 
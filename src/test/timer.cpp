@@ -0,0 +1,238 @@
+#include "tests.hpp"
+#include "hg/timer.hpp"
+
+static void timerCount(void* data)
+{
+    ++*static_cast<u32*>(data);
+}
+
+static void timerCountAtomic(void* data)
+{
+    static_cast<std::atomic<u32>*>(data)->fetch_add(1);
+}
+
+void testTimer()
+{
+    // ============================================================================
+    // TimerWheel
+    // ============================================================================
+    //
+    // TimerWheel is a hierarchical timer wheel. Timers are scheduled in seconds,
+    // quantized to ticks, and fire when the wheel is advanced past them.
+
+    // ------------------------------------------------------------------
+    // Schedule and fire
+    // ------------------------------------------------------------------
+
+    // Timer fires once its delay has elapsed
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        Timer t = wheel.schedule(3.0, &count, timerCount);
+        TEST(wheel.scheduled(t));
+        TEST(wheel.advance(2.0) == 0);
+        TEST(count == 0);
+        TEST(wheel.advance(1.0) == 1);
+        TEST(count == 1);
+        TEST(!wheel.scheduled(t));
+    }
+
+    // Zero delay fires on the next tick
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        wheel.schedule(0.0, &count, timerCount);
+        TEST(wheel.tick() == 1);
+        TEST(count == 1);
+    }
+
+    // Partial ticks accumulate
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        wheel.schedule(1.0, &count, timerCount);
+        wheel.advance(0.5);
+        TEST(count == 0);
+        wheel.advance(0.5);
+        TEST(count == 1);
+    }
+
+    // Exact multiples of the tick length do not round up
+    {
+        TimerWheel wheel{1.0 / 60.0};
+        u32 count = 0;
+        wheel.schedule(0.05, &count, timerCount);
+        wheel.tick();
+        wheel.tick();
+        TEST(count == 0);
+        wheel.tick();
+        TEST(count == 1);
+    }
+
+    // Several timers in the same tick fire together
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        for (u32 i = 0; i < 10; ++i)
+            wheel.schedule(5.0, &count, timerCount);
+        TEST(wheel.advance(5.0) == 10);
+        TEST(count == 10);
+    }
+
+    // remaining reports the time left
+    {
+        TimerWheel wheel{0.5};
+        u32 count = 0;
+        Timer t = wheel.schedule(2.0, &count, timerCount);
+        TEST(std::abs(wheel.remaining(t) - 2.0) < 1e-9);
+        wheel.advance(0.75);
+        TEST(std::abs(wheel.remaining(t) - 1.25) < 1e-9);
+    }
+
+    // ------------------------------------------------------------------
+    // Cancel
+    // ------------------------------------------------------------------
+
+    // Cancelled timer never fires
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        Timer t = wheel.schedule(2.0, &count, timerCount);
+        TEST(wheel.cancel(t));
+        TEST(!wheel.scheduled(t));
+        wheel.advance(10.0);
+        TEST(count == 0);
+    }
+
+    // Cancel after firing returns false
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        Timer t = wheel.schedule(1.0, &count, timerCount);
+        wheel.advance(1.0);
+        TEST(!wheel.cancel(t));
+        TEST(!wheel.cancel(nullTimer));
+    }
+
+    // Cancel one timer among several in the same slot
+    {
+        TimerWheel wheel{1.0};
+        u32 a = 0;
+        u32 b = 0;
+        u32 c = 0;
+        wheel.schedule(4.0, &a, timerCount);
+        Timer tb = wheel.schedule(4.0, &b, timerCount);
+        wheel.schedule(4.0, &c, timerCount);
+        wheel.cancel(tb);
+        wheel.advance(4.0);
+        TEST(a == 1);
+        TEST(b == 0);
+        TEST(c == 1);
+    }
+
+    // Reused handle slots get a new generation
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        Timer a = wheel.schedule(1.0, &count, timerCount);
+        wheel.cancel(a);
+        Timer b = wheel.schedule(1.0, &count, timerCount);
+        TEST(a.handle.idx() == b.handle.idx());
+        TEST(a != b);
+        TEST(!wheel.cancel(a));
+        TEST(wheel.scheduled(b));
+    }
+
+    // ------------------------------------------------------------------
+    // Repeat
+    // ------------------------------------------------------------------
+
+    // Repeating timer fires every interval until cancelled
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        Timer t = wheel.schedule(2.0, &count, timerCount, 3.0);
+        wheel.advance(2.0);
+        TEST(count == 1);
+        wheel.advance(3.0);
+        TEST(count == 2);
+        wheel.advance(6.0);
+        TEST(count == 4);
+        TEST(wheel.scheduled(t));
+        wheel.cancel(t);
+        wheel.advance(6.0);
+        TEST(count == 4);
+    }
+
+    // ------------------------------------------------------------------
+    // Cascading
+    // ------------------------------------------------------------------
+
+    // Timers in higher levels fire on the exact tick
+    {
+        TimerWheel wheel{1.0};
+        u64 delays[] = {63, 64, 65, 100, 4095, 4096, 4097, 300000};
+        u32 counts[8] = {};
+        for (u32 i = 0; i < 8; ++i)
+            wheel.schedule(static_cast<f64>(delays[i]), &counts[i], timerCount);
+
+        bool exact = true;
+        for (u64 now = 1; now <= 300000; ++now)
+        {
+            wheel.tick();
+            for (u32 i = 0; i < 8; ++i)
+                exact = exact && counts[i] == (now >= delays[i] ? 1u : 0u);
+        }
+        TEST(exact);
+    }
+
+    // Timers beyond the wheel range are parked and still fire on time
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        f64 far = static_cast<f64>((u64)1 << (TimerWheel::wheelBits * TimerWheel::wheelLevels)) + 10.0;
+        wheel.schedule(far, &count, timerCount);
+        wheel.advance(far - 1.0);
+        TEST(count == 0);
+        wheel.advance(1.0);
+        TEST(count == 1);
+    }
+
+    // Starting from a non-zero tick still fires on time
+    {
+        TimerWheel wheel{1.0};
+        wheel.advance(4000.0);
+        u32 count = 0;
+        wheel.schedule(200.0, &count, timerCount);
+        wheel.advance(199.0);
+        TEST(count == 0);
+        wheel.advance(1.0);
+        TEST(count == 1);
+    }
+
+    // ------------------------------------------------------------------
+    // Dispatch
+    // ------------------------------------------------------------------
+
+    // Large batches are dispatched to the thread pool
+    {
+        TimerWheel wheel{1.0};
+        wheel.parallelThreshold = 16;
+        std::atomic<u32> count = 0;
+        for (u32 i = 0; i < 1000; ++i)
+            wheel.schedule(2.0, &count, timerCountAtomic);
+        TEST(wheel.advance(2.0) == 1000);
+        TEST(count.load() == 1000);
+    }
+
+    // reset cancels all timers
+    {
+        TimerWheel wheel{1.0};
+        u32 count = 0;
+        Timer t = wheel.schedule(1.0, &count, timerCount);
+        wheel.reset();
+        TEST(!wheel.scheduled(t));
+        wheel.advance(5.0);
+        TEST(count == 0);
+    }
+}
@@ -0,0 +1,169 @@
+#include "tests.hpp"
+#include "hg/transform.hpp"
+#include "hg/noise.hpp"
+
+static bool matNear(const Mat4& a, const Mat4& b)
+{
+    const f32* x = &a.x.x;
+    const f32* y = &b.x.x;
+    for (u32 i = 0; i < 16; ++i)
+    {
+        if (std::abs(x[i] - y[i]) > 1e-4f)
+            return false;
+    }
+    return true;
+}
+
+static Mat4 matTranslate(f32 x, f32 y, f32 z)
+{
+    return matModel3D({x, y, z}, {1.0f, 1.0f, 1.0f}, Quat{1.0f});
+}
+
+void testTransform()
+{
+    // ============================================================================
+    // TransformHierarchy
+    // ============================================================================
+    //
+    // Local transforms are propagated to world transforms through the parents,
+    // level by level, recomputing only the subtrees that changed.
+
+    // ------------------------------------------------------------------
+    // Propagation
+    // ------------------------------------------------------------------
+
+    // Children are ordered after their parents, level by level
+    {
+        TransformHierarchy h{};
+        Entity root{Handle{0}};
+        Entity a{Handle{1}};
+        Entity b{Handle{2}};
+        Entity c{Handle{3}};
+
+        // Added in reverse, the order is fixed by propagate
+        h.add(c, b, matTranslate(0.0f, 0.0f, 1.0f));
+        h.add(b, root, matTranslate(0.0f, 1.0f, 0.0f));
+        h.add(a, root, matTranslate(2.0f, 0.0f, 0.0f));
+        h.add(root, nullEntity, matTranslate(10.0f, 0.0f, 0.0f));
+        TEST(h.stale);
+        h.propagate();
+
+        TEST(!h.stale);
+        TEST(h.depth() == 3);
+        TEST(h.entities[0] == root);
+        TEST(h.entities[3] == c);
+        TEST(h.parents[0] == (u32)-1);
+        TEST(h.parents[3] == h.indices.get(b.handle.idx()));
+        TEST(h.dirtyCount == 0);
+
+        TEST(matNear(h.getWorld(root), matTranslate(10.0f, 0.0f, 0.0f)));
+        TEST(matNear(h.getWorld(a), matTranslate(12.0f, 0.0f, 0.0f)));
+        TEST(matNear(h.getWorld(b), matTranslate(10.0f, 1.0f, 0.0f)));
+        TEST(matNear(h.getWorld(c), matTranslate(10.0f, 1.0f, 1.0f)));
+
+        // A change carries down its subtree only
+        h.setLocal(b, matTranslate(0.0f, 5.0f, 0.0f));
+        h.worlds[h.indices.get(a.handle.idx())] = Mat4{0.0f};
+        h.propagate();
+        TEST(matNear(h.getWorld(c), matTranslate(10.0f, 5.0f, 1.0f)));
+        TEST(matNear(h.getWorld(a), Mat4{0.0f}));
+
+        // Rotation and scale compose like the matrix product
+        Quat rot = quatAxisAngle({0.0f, 0.0f, 1.0f}, 0.5f);
+        h.setLocal3D(root, {1.0f, 2.0f, 3.0f}, {2.0f, 2.0f, 2.0f}, rot);
+        h.propagate();
+        Mat4 rootWorld = matModel3D({1.0f, 2.0f, 3.0f}, {2.0f, 2.0f, 2.0f}, rot);
+        TEST(matNear(h.getWorld(root), rootWorld));
+        TEST(matNear(h.getWorld(c), rootWorld * matTranslate(0.0f, 5.0f, 0.0f) * matTranslate(0.0f, 0.0f, 1.0f)));
+
+        h.setLocal2D(a, {1.0f, 1.0f, 0.0f}, {3.0f, 3.0f}, 1.0f);
+        h.propagate();
+        TEST(matNear(h.getWorld(a), rootWorld * matModel2D({1.0f, 1.0f, 0.0f}, {3.0f, 3.0f}, 1.0f)));
+    }
+
+    // ------------------------------------------------------------------
+    // Structure
+    // ------------------------------------------------------------------
+
+    // Reparenting and removal
+    {
+        TransformHierarchy h{};
+        Entity a{Handle{0}};
+        Entity b{Handle{1}};
+        Entity c{Handle{2}};
+        h.add(a, nullEntity, matTranslate(1.0f, 0.0f, 0.0f));
+        h.add(b, nullEntity, matTranslate(0.0f, 1.0f, 0.0f));
+        h.add(c, a, matTranslate(0.0f, 0.0f, 1.0f));
+        h.propagate();
+        TEST(matNear(h.getWorld(c), matTranslate(1.0f, 0.0f, 1.0f)));
+
+        h.setParent(c, b);
+        TEST(h.getParent(c) == b);
+        h.propagate();
+        TEST(matNear(h.getWorld(c), matTranslate(0.0f, 1.0f, 1.0f)));
+
+        // Children of a removed node become roots
+        h.remove(b);
+        TEST(!h.has(b));
+        h.propagate();
+        TEST(h.getParent(c) == nullEntity);
+        TEST(matNear(h.getWorld(c), matTranslate(0.0f, 0.0f, 1.0f)));
+        TEST(h.depth() == 1);
+
+        // Dead entities are pruned with a pool
+        HandlePool pool{};
+        Entity d{pool.alloc()};
+        Entity e{pool.alloc()};
+        h.reset();
+        h.add(d);
+        h.add(e, d);
+        pool.free(d.handle);
+        h.removeDead(pool);
+        TEST(!h.has(d));
+        TEST(h.has(e));
+        h.propagate();
+        TEST(h.getParent(e) == nullEntity);
+    }
+
+    // A deep and wide random graph matches recursing through the parents
+    {
+        TransformHierarchy h{};
+        Rng rng{99};
+        static constexpr u32 n = 5000;
+        for (u32 i = 0; i < n; ++i)
+        {
+            Entity parent = i == 0 || rng.next() % 16 == 0 ? nullEntity : Entity{Handle{rng.next() % i}};
+            f32 angle = (f32)(rng.next() % 100) * 0.01f;
+            Mat4 local = matModel3D({1.0f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, quatAxisAngle({0.0f, 1.0f, 0.0f}, angle));
+            h.add(Entity{Handle{i}}, parent, local);
+        }
+        h.propagate();
+
+        // Move some nodes and change others between propagations
+        for (u32 i = 0; i < 200; ++i)
+        {
+            Entity e{Handle{rng.next() % n}};
+            if (i % 2 == 0)
+                h.setLocal(e, matTranslate((f32)i, 0.0f, 0.0f));
+            else if (e.handle.idx() > 0)
+                h.setParent(e, Entity{Handle{rng.next() % e.handle.idx()}});
+        }
+        h.propagate();
+
+        bool matches = true;
+        for (u32 i = 0; i < n; ++i)
+        {
+            Entity e{Handle{i}};
+            Mat4 expected = h.getLocal(e);
+            for (Entity p = h.getParent(e); p != nullEntity; p = h.getParent(p))
+                expected = h.getLocal(p) * expected;
+            matches = matches && matNear(h.getWorld(e), expected);
+        }
+        TEST(matches);
+
+        bool ordered = true;
+        for (u32 i = 0; i < n; ++i)
+            ordered = ordered && (h.parents[i] == (u32)-1 || h.parents[i] < i);
+        TEST(ordered);
+    }
+}
@@ -0,0 +1,205 @@
+#include "hg/timer.hpp"
+#include "hg/concurrency.hpp"
+
+#include <cmath>
+
+namespace hg {
+
+TimerWheel::TimerWheel(f64 tickLengthVal)
+    : tickLength{tickLengthVal}
+{
+    HG_ASSERT(tickLength > 0.0);
+    for (u32& slot : slots)
+    {
+        slot = (u32)-1;
+    }
+}
+
+void TimerWheel::reset()
+{
+    handles.reset();
+    nodes.reset();
+    fired.reset();
+    for (u32& slot : slots)
+    {
+        slot = (u32)-1;
+    }
+}
+
+void TimerWheel::link(u32 idx)
+{
+    Node& node = nodes[idx];
+
+    u64 delta = node.expiry - now;
+    u64 expiry = node.expiry;
+    u32 level = 0;
+    while (level < wheelLevels - 1 && delta >= (u64)1 << (wheelBits * (level + 1)))
+    {
+        ++level;
+    }
+    if (delta >= (u64)1 << (wheelBits * wheelLevels))
+        expiry = now + ((u64)1 << (wheelBits * wheelLevels)) - 1;
+
+    node.slot = level * wheelSize + static_cast<u32>((expiry >> (wheelBits * level)) & (wheelSize - 1));
+    node.prev = (u32)-1;
+    node.next = slots[node.slot];
+    if (node.next != (u32)-1)
+        nodes[node.next].prev = idx;
+    slots[node.slot] = idx;
+}
+
+void TimerWheel::unlink(u32 idx)
+{
+    Node& node = nodes[idx];
+
+    if (node.prev != (u32)-1)
+        nodes[node.prev].next = node.next;
+    else
+        slots[node.slot] = node.next;
+
+    if (node.next != (u32)-1)
+        nodes[node.next].prev = node.prev;
+
+    node.prev = (u32)-1;
+    node.next = (u32)-1;
+    node.slot = (u32)-1;
+}
+
+u64 TimerWheel::secondsToTicks(f64 seconds) const
+{
+    // Bias down slightly so delays that are exact multiples of the tick length
+    // don't round up a whole tick from floating point error
+    f64 ticks = std::ceil(seconds / tickLength - 1e-6);
+    return ticks > 1.0 ? static_cast<u64>(ticks) : 1;
+}
+
+Timer TimerWheel::schedule(f64 delay, void* data, void (*fn)(void* data), f64 interval)
+{
+    HG_ASSERT(fn != nullptr);
+    HG_ASSERT(delay >= 0.0);
+    HG_ASSERT(interval >= 0.0);
+
+    Handle handle = handles.alloc();
+    if (handle.idx() >= nodes.count)
+        nodes.resize(handle.idx() + 1);
+
+    Node& node = nodes[handle.idx()];
+    node.expiry = now + secondsToTicks(delay - accumulated);
+    node.interval = interval > 0.0 ? secondsToTicks(interval) : 0;
+    node.fn = fn;
+    node.data = data;
+    link(handle.idx());
+
+    return {handle};
+}
+
+bool TimerWheel::cancel(Timer timer)
+{
+    if (!handles.alive(timer.handle))
+        return false;
+
+    unlink(timer.handle.idx());
+    handles.free(timer.handle);
+    return true;
+}
+
+bool TimerWheel::scheduled(Timer timer) const
+{
+    return handles.alive(timer.handle);
+}
+
+f64 TimerWheel::remaining(Timer timer) const
+{
+    HG_ASSERT(scheduled(timer));
+    return static_cast<f64>(nodes[timer.handle.idx()].expiry - now) * tickLength - accumulated;
+}
+
+u32 TimerWheel::update()
+{
+    return advance(clock.tick());
+}
+
+u32 TimerWheel::advance(f64 seconds)
+{
+    HG_ASSERT(seconds >= 0.0);
+
+    u32 dispatched = 0;
+    accumulated += seconds;
+    while (accumulated >= tickLength)
+    {
+        accumulated -= tickLength;
+        dispatched += tick();
+    }
+    return dispatched;
+}
+
+u32 TimerWheel::tick()
+{
+    ++now;
+
+    u32 cascadeLevel = 0;
+    while (cascadeLevel < wheelLevels - 1 && (now & (((u64)1 << (wheelBits * (cascadeLevel + 1))) - 1)) == 0)
+    {
+        ++cascadeLevel;
+    }
+
+    for (u32 level = cascadeLevel; level > 0; --level)
+    {
+        u32 slot = level * wheelSize + static_cast<u32>((now >> (wheelBits * level)) & (wheelSize - 1));
+        u32 idx = slots[slot];
+        slots[slot] = (u32)-1;
+        while (idx != (u32)-1)
+        {
+            u32 next = nodes[idx].next;
+            link(idx);
+            idx = next;
+        }
+    }
+
+    u32 slot = static_cast<u32>(now & (wheelSize - 1));
+    u32 idx = slots[slot];
+    slots[slot] = (u32)-1;
+    while (idx != (u32)-1)
+    {
+        Node& node = nodes[idx];
+        u32 next = node.next;
+        HG_ASSERT(node.expiry == now);
+
+        fired.push({node.fn, node.data});
+        if (node.interval > 0)
+        {
+            node.expiry = now + node.interval;
+            link(idx);
+        }
+        else
+        {
+            node.prev = (u32)-1;
+            node.next = (u32)-1;
+            node.slot = (u32)-1;
+            handles.free(handles.handles[idx]);
+        }
+        idx = next;
+    }
+
+    u32 count = static_cast<u32>(fired.count);
+    if (count >= parallelThreshold)
+    {
+        Call* calls = fired.vals;
+        forPar(0, count, [&](u64 i)
+        {
+            calls[i].fn(calls[i].data);
+        });
+    }
+    else
+    {
+        for (u32 i = 0; i < count; ++i)
+        {
+            fired[i].fn(fired[i].data);
+        }
+    }
+    fired.reset();
+
+    return count;
+}
+
+} // namespace hg
@@ -0,0 +1,325 @@
+#include "hg/transform.hpp"
+#include "hg/concurrency.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace hg {
+
+void TransformHierarchy::reset()
+{
+    entities.reset();
+    parentEntities.reset();
+    parents.reset();
+    locals.reset();
+    worlds.reset();
+    dirty.reset();
+    levels.reset();
+    indices.reset();
+    stale = false;
+    dirtyCount = 0;
+}
+
+static void markDirty(TransformHierarchy* h, u32 idx)
+{
+    if (h->dirty[idx] == 0)
+    {
+        h->dirty[idx] = 1;
+        ++h->dirtyCount;
+    }
+}
+
+void TransformHierarchy::add(Entity e, Entity parent, const Mat4& local)
+{
+    HG_ASSERT(!has(e));
+    HG_ASSERT(parent != e);
+
+    indices.set(e.handle.idx(), static_cast<u32>(entities.count));
+    entities.push(e);
+    parentEntities.push(parent);
+    parents.push((u32)-1);
+    locals.push(local);
+    worlds.push(local);
+    dirty.push(0);
+    markDirty(this, static_cast<u32>(entities.count - 1));
+    stale = true;
+}
+
+bool TransformHierarchy::has(Entity e) const
+{
+    u32 idx = indices.get(e.handle.idx());
+    return idx != (u32)-1 && entities[idx] == e;
+}
+
+void TransformHierarchy::remove(Entity e)
+{
+    HG_ASSERT(has(e));
+
+    u32 idx = indices.get(e.handle.idx());
+    indices.set(e.handle.idx(), (u32)-1);
+    if (dirty[idx] != 0)
+        --dirtyCount;
+
+    entities.removeSwap(idx);
+    parentEntities.removeSwap(idx);
+    parents.removeSwap(idx);
+    locals.removeSwap(idx);
+    worlds.removeSwap(idx);
+    dirty.removeSwap(idx);
+    if (idx < entities.count)
+        indices.set(entities[idx].handle.idx(), idx);
+
+    // Children find their parent missing when the order is rebuilt
+    stale = true;
+}
+
+void TransformHierarchy::removeDead(const HandlePool& pool)
+{
+    for (u64 i = entities.count; i-- > 0;)
+    {
+        if (!pool.alive(entities[i].handle))
+            remove(entities[i]);
+    }
+}
+
+void TransformHierarchy::setParent(Entity e, Entity parent)
+{
+    HG_ASSERT(has(e));
+    HG_ASSERT(parent != e);
+
+    u32 idx = indices.get(e.handle.idx());
+    if (parentEntities[idx] == parent)
+        return;
+
+    parentEntities[idx] = parent;
+    markDirty(this, idx);
+    stale = true;
+}
+
+Entity TransformHierarchy::getParent(Entity e) const
+{
+    HG_ASSERT(has(e));
+    return parentEntities[indices.get(e.handle.idx())];
+}
+
+void TransformHierarchy::setLocal(Entity e, const Mat4& local)
+{
+    HG_ASSERT(has(e));
+    u32 idx = indices.get(e.handle.idx());
+    locals[idx] = local;
+    markDirty(this, idx);
+}
+
+void TransformHierarchy::setLocal3D(Entity e, const Vec3& position, const Vec3& scale, const Quat& rotation)
+{
+    setLocal(e, matModel3D(position, scale, rotation));
+}
+
+void TransformHierarchy::setLocal2D(Entity e, Vec3 position, Vec2 scale, f32 rotation)
+{
+    setLocal(e, matModel2D(position, scale, rotation));
+}
+
+const Mat4& TransformHierarchy::getLocal(Entity e) const
+{
+    HG_ASSERT(has(e));
+    return locals[indices.get(e.handle.idx())];
+}
+
+const Mat4& TransformHierarchy::getWorld(Entity e) const
+{
+    HG_ASSERT(has(e));
+    return worlds[indices.get(e.handle.idx())];
+}
+
+u32 TransformHierarchy::depth() const
+{
+    return levels.count == 0 ? 0 : static_cast<u32>(levels.count - 1);
+}
+
+void TransformHierarchy::rebuild()
+{
+    u32 count = static_cast<u32>(entities.count);
+    ArenaScope scratch = getScratch();
+
+    // Parent indices in the current order, nodes with a missing parent become
+    // roots
+    u32* parent = scratch.alloc<u32>(count);
+    u32* childStart = scratch.alloc<u32>(count + 1);
+    memset(childStart, 0, (count + 1) * sizeof(u32));
+    for (u32 i = 0; i < count; ++i)
+    {
+        parent[i] = (u32)-1;
+        Entity p = parentEntities[i];
+        if (p == nullEntity)
+            continue;
+
+        if (has(p))
+        {
+            parent[i] = indices.get(p.handle.idx());
+            ++childStart[parent[i] + 1];
+        }
+        else
+        {
+            parentEntities[i] = nullEntity;
+            markDirty(this, i);
+        }
+    }
+
+    // Children of each node, contiguous in the current order
+    for (u32 i = 0; i < count; ++i)
+    {
+        childStart[i + 1] += childStart[i];
+    }
+    u32* children = scratch.alloc<u32>(count);
+    u32* cursor = scratch.alloc<u32>(count);
+    memcpy(cursor, childStart, count * sizeof(u32));
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (parent[i] != (u32)-1)
+            children[cursor[parent[i]]++] = i;
+    }
+
+    // Breadth first from the roots, one level at a time
+    u32* order = scratch.alloc<u32>(count);
+    u32 ordered = 0;
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (parent[i] == (u32)-1)
+            order[ordered++] = i;
+    }
+
+    levels.reset();
+    levels.push(0);
+    for (u32 begin = 0; begin < ordered;)
+    {
+        u32 end = ordered;
+        levels.push(end);
+        for (u32 i = begin; i < end; ++i)
+        {
+            for (u32 c = childStart[order[i]]; c < childStart[order[i] + 1]; ++c)
+            {
+                order[ordered++] = children[c];
+            }
+        }
+        begin = end;
+    }
+    // Nodes left unordered are in a cycle of parents
+    HG_ASSERT(ordered == count);
+
+    u32* newIdx = scratch.alloc<u32>(count);
+    for (u32 i = 0; i < count; ++i)
+    {
+        newIdx[order[i]] = i;
+    }
+
+    // Only the nodes from the first one that moves are copied
+    u32 unmoved = 0;
+    while (unmoved < count && order[unmoved] == unmoved)
+    {
+        ++unmoved;
+    }
+
+    auto reorder = [&](auto& vals)
+    {
+        using T = std::remove_reference_t<decltype(vals[0])>;
+        T* old = scratch.alloc<T>(count);
+        memcpy(static_cast<void*>(old + unmoved), vals.vals + unmoved, (count - unmoved) * sizeof(T));
+        for (u32 i = unmoved; i < count; ++i)
+        {
+            vals[i] = old[order[i]];
+        }
+    };
+    reorder(entities);
+    reorder(parentEntities);
+    reorder(locals);
+    reorder(worlds);
+    reorder(dirty);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 p = parent[order[i]];
+        parents[i] = p == (u32)-1 ? p : newIdx[p];
+    }
+    for (u32 i = unmoved; i < count; ++i)
+    {
+        indices.set(entities[i].handle.idx(), i);
+    }
+
+    stale = false;
+}
+
+static void transformMul(Mat4* dst, const Mat4& lhs, const Mat4& rhs)
+{
+    __m128 x = _mm_loadu_ps(&lhs.x.x);
+    __m128 y = _mm_loadu_ps(&lhs.y.x);
+    __m128 z = _mm_loadu_ps(&lhs.z.x);
+    __m128 w = _mm_loadu_ps(&lhs.w.x);
+
+    const Vec4* r = &rhs.x;
+    Vec4* d = &dst->x;
+    for (u32 i = 0; i < 4; ++i)
+    {
+        __m128 col = _mm_mul_ps(x, _mm_set1_ps(r[i].x));
+        col = _mm_add_ps(col, _mm_mul_ps(y, _mm_set1_ps(r[i].y)));
+        col = _mm_add_ps(col, _mm_mul_ps(z, _mm_set1_ps(r[i].z)));
+        col = _mm_add_ps(col, _mm_mul_ps(w, _mm_set1_ps(r[i].w)));
+        _mm_storeu_ps(&d[i].x, col);
+    }
+}
+
+static void propagateRange(TransformHierarchy* h, u32 begin, u32 end)
+{
+    const u32* parents = h->parents.vals;
+    const Mat4* locals = h->locals.vals;
+    Mat4* worlds = h->worlds.vals;
+    u8* dirty = h->dirty.vals;
+
+    for (u32 i = begin; i < end; ++i)
+    {
+        u32 p = parents[i];
+        if (p == (u32)-1)
+        {
+            if (dirty[i] != 0)
+                worlds[i] = locals[i];
+        }
+        else if ((dirty[i] | dirty[p]) != 0)
+        {
+            transformMul(&worlds[i], worlds[p], locals[i]);
+            dirty[i] = 1;
+        }
+    }
+}
+
+void TransformHierarchy::propagate()
+{
+    if (stale)
+        rebuild();
+    if (dirtyCount == 0)
+        return;
+
+    // Parents are complete before their level is started, and a dirty flag
+    // carries down to every node under it
+    for (u32 d = 0; d < depth(); ++d)
+    {
+        u32 begin = levels[d];
+        u32 end = levels[d + 1];
+        if (end - begin <= chunkSize)
+        {
+            propagateRange(this, begin, end);
+            continue;
+        }
+
+        forPar(0, (end - begin + chunkSize - 1) / chunkSize, [&](u64 chunk)
+        {
+            u32 chunkBegin = begin + static_cast<u32>(chunk) * chunkSize;
+            propagateRange(this, chunkBegin, std::min(chunkBegin + chunkSize, end));
+        });
+    }
+
+    memset(dirty.vals, 0, dirty.count);
+    dirtyCount = 0;
+}
+
+} // namespace hg